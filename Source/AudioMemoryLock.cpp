@@ -0,0 +1,210 @@
+#include "AudioMemoryLock.h"
+#include <map>
+#include <cerrno>
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <sys/mman.h>
+ #include <sys/resource.h>
+ #include <unistd.h>
+ #define VSTMIC_CAN_LOCK_MEMORY 1
+#else
+ #define VSTMIC_CAN_LOCK_MEMORY 0
+#endif
+
+namespace
+{
+    using Address = juce::pointer_sized_uint;
+
+    // Reclaimed snapshots unlock from the reclaimer thread, so this is shared
+    juce::CriticalSection lock;
+    std::map<Address, int> pageCounts;
+    size_t unlockedBytes = 0;
+    bool limitReported = false;
+
+    size_t getPageSize()
+    {
+       #if VSTMIC_CAN_LOCK_MEMORY
+        static const auto pageSize = (size_t)sysconf(_SC_PAGESIZE);
+        return pageSize;
+       #else
+        return 4096;
+       #endif
+    }
+
+    // Touches every page so it's resident before the audio thread needs it
+    void prefault(const void* data, size_t numBytes)
+    {
+        auto* bytes = static_cast<volatile char*>(const_cast<void*>(data));
+
+        for (size_t offset = 0; offset < numBytes; offset += getPageSize())
+            bytes[offset] = bytes[offset];
+
+        if (numBytes > 0)
+            bytes[numBytes - 1] = bytes[numBytes - 1];
+    }
+
+    bool lockPages(Address start, size_t numBytes)
+    {
+       #if VSTMIC_CAN_LOCK_MEMORY
+        return mlock(reinterpret_cast<void*>(start), numBytes) == 0;
+       #else
+        juce::ignoreUnused(start, numBytes);
+        return false;
+       #endif
+    }
+
+    void unlockPages(Address start, size_t numBytes)
+    {
+       #if VSTMIC_CAN_LOCK_MEMORY
+        munlock(reinterpret_cast<void*>(start), numBytes);
+       #else
+        juce::ignoreUnused(start, numBytes);
+       #endif
+    }
+}
+
+namespace AudioMemoryLock
+{
+    Regions::~Regions()
+    {
+        clear();
+    }
+
+    void Regions::add(const juce::AudioBuffer<float>& buffer)
+    {
+        const auto numChannels = buffer.getNumChannels();
+        if (numChannels == 0 || buffer.getNumSamples() == 0)
+            return;
+
+        // AudioBuffer keeps all its channels in one allocation
+        auto* first = buffer.getReadPointer(0);
+        auto* last = buffer.getReadPointer(numChannels - 1) + buffer.getNumSamples();
+        add(first, (size_t)(last - first) * sizeof(float));
+    }
+
+    void Regions::add(const void* data, size_t numBytes)
+    {
+        if (data == nullptr || numBytes == 0)
+            return;
+
+        prefault(data, numBytes);
+
+        const auto pageSize = getPageSize();
+        const auto start = (Address)data & ~(Address)(pageSize - 1);
+        const auto end = ((Address)data + numBytes + pageSize - 1) & ~(Address)(pageSize - 1);
+        const auto length = (size_t)(end - start);
+
+        const juce::ScopedLock sl(lock);
+
+        // Only pages nobody holds yet need locking; mlock of an already
+        // locked page is harmless, so lock the whole range in one go
+        bool needsLock = false;
+        for (auto page = start; page < end && !needsLock; page += pageSize)
+            needsLock = pageCounts.find(page) == pageCounts.end();
+
+        if (needsLock && !lockPages(start, length))
+        {
+            unlockedBytes += numBytes;
+            failedBytes += numBytes;
+
+            if (!limitReported)
+            {
+                limitReported = true;
+                DBG("Could not lock audio memory (" << (errno == ENOMEM ? "RLIMIT_MEMLOCK reached" : "not permitted")
+                    << "); further buffers are only pre-faulted");
+            }
+
+            return;
+        }
+
+        for (auto page = start; page < end; page += pageSize)
+            ++pageCounts[page];
+
+        ranges.emplace_back(start, length);
+    }
+
+    void Regions::clear()
+    {
+        if (ranges.empty() && failedBytes == 0)
+            return;
+
+        const auto pageSize = getPageSize();
+        const juce::ScopedLock sl(lock);
+
+        unlockedBytes -= failedBytes;
+        failedBytes = 0;
+
+        for (auto& range : ranges)
+        {
+            for (auto page = range.first; page < range.first + range.second; page += pageSize)
+            {
+                auto found = pageCounts.find(page);
+                if (found == pageCounts.end())
+                    continue;
+
+                if (--found->second == 0)
+                {
+                    unlockPages(page, pageSize);
+                    pageCounts.erase(found);
+                }
+            }
+        }
+
+        ranges.clear();
+    }
+
+    //==============================================================================
+    Report getReport()
+    {
+        Report report;
+
+        {
+            const juce::ScopedLock sl(lock);
+            report.lockedBytes = pageCounts.size() * getPageSize();
+            report.unlockedBytes = unlockedBytes;
+        }
+
+       #if VSTMIC_CAN_LOCK_MEMORY
+        rlimit limit {};
+        if (getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+            report.limitBytes = (size_t)limit.rlim_cur;
+       #endif
+
+        return report;
+    }
+
+    juce::String getReportText()
+    {
+        auto report = getReport();
+
+       #if ! VSTMIC_CAN_LOCK_MEMORY
+        return "Audio memory: pre-faulted, locking not supported here\n";
+       #else
+        juce::String text;
+        text << "Audio memory: " << juce::File::descriptionOfSizeInBytes((juce::int64)report.lockedBytes) << " locked";
+
+        if (report.unlockedBytes > 0)
+        {
+            text << ", " << juce::File::descriptionOfSizeInBytes((juce::int64)report.unlockedBytes)
+                 << " only pre-faulted (RLIMIT_MEMLOCK "
+                 << (report.limitBytes > 0 ? juce::File::descriptionOfSizeInBytes((juce::int64)report.limitBytes)
+                                           : juce::String("unlimited"))
+                 << ")";
+        }
+
+        return text + "\n";
+       #endif
+    }
+
+    size_t getResidentBytes()
+    {
+       #if JUCE_LINUX
+        // Second field of statm is the resident page count
+        auto fields = juce::StringArray::fromTokens(juce::File("/proc/self/statm").loadFileAsString(), true);
+        if (fields.size() >= 2)
+            return (size_t)fields[1].getLargeIntValue() * getPageSize();
+       #endif
+
+        return 0;
+    }
+}
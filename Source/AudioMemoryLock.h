@@ -0,0 +1,51 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Keeps the memory the audio thread works in resident. Buffers are
+// pre-faulted and mlock()ed when they're prepared, so the first blocks after
+// a device start or a chain edit don't take page faults. If RLIMIT_MEMLOCK
+// won't stretch that far, the rest is still pre-faulted and the shortfall
+// shows up in the report; nothing fails because of it.
+//
+// Locks are counted per page, so neighbouring buffers sharing a page don't
+// unlock each other.
+namespace AudioMemoryLock
+{
+    // Holds its memory locked until cleared or destroyed. Declare it after
+    // the buffers it covers, so it goes before they do.
+    class Regions
+    {
+    public:
+        Regions() = default;
+        ~Regions();
+
+        void add(const juce::AudioBuffer<float>& buffer);
+        void add(const void* data, size_t numBytes);
+        void clear();
+
+    private:
+        // Page-aligned ranges this object holds a lock count on
+        std::vector<std::pair<juce::pointer_sized_uint, size_t>> ranges;
+
+        // Bytes that could only be pre-faulted
+        size_t failedBytes = 0;
+
+        JUCE_DECLARE_NON_COPYABLE(Regions)
+    };
+
+    struct Report
+    {
+        size_t lockedBytes = 0;
+        size_t unlockedBytes = 0;
+
+        // Soft RLIMIT_MEMLOCK, or 0 if unlimited or unknown
+        size_t limitBytes = 0;
+    };
+
+    Report getReport();
+    juce::String getReportText();
+
+    // Resident set size of the whole process, or 0 where it can't be read.
+    // Sampled around loading a plugin, it's a rough idea of what it costs.
+    size_t getResidentBytes();
+}
@@ -0,0 +1,72 @@
+#include "BlockAdapter.h"
+
+void BlockAdapter::prepare(int numChannels, int blockSizeToUse, int maximumDeviceBlockSize)
+{
+    blockSize = juce::jmax(0, blockSizeToUse);
+    staged = 0;
+    readPosition = 0;
+    memoryLock.clear();
+
+    if (blockSize == 0)
+    {
+        output.setSize(0, 0);
+        numReady = 0;
+        return;
+    }
+
+    // At most one block of latency plus one chunk of device audio is ever waiting
+    maximumChunkSize = juce::jmax(1, maximumDeviceBlockSize);
+    output.setSize(numChannels, blockSize + maximumChunkSize);
+    output.clear();
+    memoryLock.add(output);
+    numReady = blockSize;
+}
+
+void BlockAdapter::pushOutput(const juce::AudioBuffer<float>& source, int numSamples) noexcept
+{
+    const auto capacity = output.getNumSamples();
+    jassert(numReady + numSamples <= capacity);
+
+    const auto writePosition = (readPosition + numReady) % capacity;
+    const auto firstPart = juce::jmin(numSamples, capacity - writePosition);
+
+    for (int channel = 0; channel < output.getNumChannels(); ++channel)
+    {
+        output.copyFrom(channel, writePosition, source, channel, 0, firstPart);
+        if (firstPart < numSamples)
+            output.copyFrom(channel, 0, source, channel, firstPart, numSamples - firstPart);
+    }
+
+    numReady += numSamples;
+}
+
+void BlockAdapter::popOutput(float** outputChannelData, int numOutputChannels, int offset, int numSamples) noexcept
+{
+    const auto capacity = output.getNumSamples();
+    jassert(numSamples <= numReady);
+
+    const auto firstPart = juce::jmin(numSamples, capacity - readPosition);
+
+    for (int channel = 0; channel < numOutputChannels; ++channel)
+    {
+        if (outputChannelData[channel] == nullptr)
+            continue;
+
+        auto* destination = outputChannelData[channel] + offset;
+
+        if (channel < output.getNumChannels())
+        {
+            memcpy(destination, output.getReadPointer(channel, readPosition), sizeof(float) * (size_t)firstPart);
+            if (firstPart < numSamples)
+                memcpy(destination + firstPart, output.getReadPointer(channel),
+                    sizeof(float) * (size_t)(numSamples - firstPart));
+        }
+        else
+        {
+            juce::FloatVectorOperations::clear(destination, numSamples);
+        }
+    }
+
+    readPosition = (readPosition + numSamples) % capacity;
+    numReady -= numSamples;
+}
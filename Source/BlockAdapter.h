@@ -0,0 +1,79 @@
+#pragma once
+#include <JuceHeader.h>
+#include "ProcessingContext.h"
+#include "AudioMemoryLock.h"
+
+// Re-blocks whatever the device delivers into constant blocks of one size,
+// for plugins that misbehave when numSamples changes from call to call.
+// Incoming audio is staged straight into the processing context; every time
+// a full block has gathered, it's processed and queued for output. The
+// output queue starts out holding one block of silence, which is the
+// latency this adds and always enough to answer the device in full.
+class BlockAdapter
+{
+public:
+    // Message thread, before the device starts. A block size of 0 turns it off.
+    void prepare(int numChannels, int blockSizeToUse, int maximumDeviceBlockSize);
+
+    bool isActive() const { return blockSize > 0; }
+    int getBlockSize() const { return blockSize; }
+    int getLatencySamples() const { return blockSize; }
+
+    // Audio thread. Calls processBlock(context, blockSize) for each complete
+    // block, with the audio already in context.audio.
+    template <typename ProcessBlock>
+    void process(ProcessingContext& context,
+        const float** inputChannelData, int numInputChannels,
+        float** outputChannelData, int numOutputChannels,
+        int numSamples, ProcessBlock&& processBlock) noexcept
+    {
+        jassert(context.maximumBlockSize >= blockSize);
+
+        // Taken in chunks no bigger than the output ring was sized for, in
+        // case the driver hands over more than it promised
+        for (int chunkStart = 0; chunkStart < numSamples; chunkStart += maximumChunkSize)
+        {
+            const int chunkEnd = juce::jmin(numSamples, chunkStart + maximumChunkSize);
+
+            for (int offset = chunkStart; offset < chunkEnd;)
+            {
+                const int toStage = juce::jmin(blockSize - staged, chunkEnd - offset);
+
+                for (int channel = 0; channel < context.numChannels; ++channel)
+                {
+                    if (channel < numInputChannels && inputChannelData[channel] != nullptr)
+                        context.audio.copyFrom(channel, staged, inputChannelData[channel] + offset, toStage);
+                    else
+                        context.audio.clear(channel, staged, toStage);
+                }
+
+                staged += toStage;
+                offset += toStage;
+
+                if (staged == blockSize)
+                {
+                    processBlock(context, blockSize);
+                    pushOutput(context.audio, blockSize);
+                    staged = 0;
+                }
+            }
+
+            popOutput(outputChannelData, numOutputChannels, chunkStart, chunkEnd - chunkStart);
+        }
+    }
+
+private:
+    void pushOutput(const juce::AudioBuffer<float>& source, int numSamples) noexcept;
+    void popOutput(float** outputChannelData, int numOutputChannels, int offset, int numSamples) noexcept;
+
+    int blockSize = 0;
+    int maximumChunkSize = 0;
+    int staged = 0;
+
+    // Ring of processed audio waiting to go out
+    juce::AudioBuffer<float> output;
+    int readPosition = 0;
+    int numReady = 0;
+
+    AudioMemoryLock::Regions memoryLock;
+};
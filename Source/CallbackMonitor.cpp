@@ -0,0 +1,111 @@
+#include "CallbackMonitor.h"
+
+void CallbackMonitor::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    ticksPerSecond = (double)juce::Time::getHighResolutionTicksPerSecond();
+    resetRequested = false;
+    clear();
+}
+
+void CallbackMonitor::clear() noexcept
+{
+    lastStartTicks = 0;
+
+    for (auto& bucket : intervalHistogram)
+        bucket.store(0, std::memory_order_relaxed);
+    for (auto& bucket : executionHistogram)
+        bucket.store(0, std::memory_order_relaxed);
+
+    numCallbacks.store(0, std::memory_order_relaxed);
+    numXruns.store(0, std::memory_order_relaxed);
+    numOverruns.store(0, std::memory_order_relaxed);
+    numLateCallbacks.store(0, std::memory_order_relaxed);
+    maxIntervalPercent.store(0.0f, std::memory_order_relaxed);
+    maxExecutionPercent.store(0.0f, std::memory_order_relaxed);
+}
+
+void CallbackMonitor::record(juce::int64 startTicks, juce::int64 endTicks, int numSamples) noexcept
+{
+    if (resetRequested.exchange(false, std::memory_order_acquire))
+        clear();
+
+    if (sampleRate <= 0.0 || numSamples <= 0)
+        return;
+
+    const auto nominalTicks = (double)numSamples / sampleRate * ticksPerSecond;
+    bool xrun = false;
+
+    const auto executionPercent = (float)(100.0 * (double)(endTicks - startTicks) / nominalTicks);
+    increment(executionHistogram[(size_t)bucketFor(executionPercent)]);
+    raise(maxExecutionPercent, executionPercent);
+
+    if (executionPercent > 100.0f)
+    {
+        increment(numOverruns);
+        xrun = true;
+    }
+
+    if (lastStartTicks != 0)
+    {
+        const auto intervalPercent = (float)(100.0 * (double)(startTicks - lastStartTicks) / nominalTicks);
+        increment(intervalHistogram[(size_t)bucketFor(intervalPercent)]);
+        raise(maxIntervalPercent, intervalPercent);
+
+        if (intervalPercent > lateIntervalPercent)
+        {
+            increment(numLateCallbacks);
+            xrun = true;
+        }
+    }
+
+    lastStartTicks = startTicks;
+    increment(numCallbacks);
+
+    if (xrun)
+        increment(numXruns);
+}
+
+CallbackMonitor::Summary CallbackMonitor::getSummary() const
+{
+    Summary summary;
+    summary.numCallbacks = numCallbacks.load(std::memory_order_relaxed);
+    summary.numXruns = numXruns.load(std::memory_order_relaxed);
+    summary.numOverruns = numOverruns.load(std::memory_order_relaxed);
+    summary.numLateCallbacks = numLateCallbacks.load(std::memory_order_relaxed);
+    summary.maxIntervalPercent = maxIntervalPercent.load(std::memory_order_relaxed);
+    summary.maxExecutionPercent = maxExecutionPercent.load(std::memory_order_relaxed);
+    return summary;
+}
+
+bool CallbackMonitor::exportCsv(const juce::File& file) const
+{
+    auto summary = getSummary();
+
+    juce::String csv;
+    csv << "# sample rate," << sampleRate << "\n"
+        << "# callbacks," << (juce::int64)summary.numCallbacks << "\n"
+        << "# xruns," << (juce::int64)summary.numXruns << "\n"
+        << "# overruns," << (juce::int64)summary.numOverruns << "\n"
+        << "# late callbacks," << (juce::int64)summary.numLateCallbacks << "\n"
+        << "# max interval %," << summary.maxIntervalPercent << "\n"
+        << "# max execution %," << summary.maxExecutionPercent << "\n"
+        << "bucket_from_percent,bucket_to_percent,interval_count,execution_count\n";
+
+    for (int i = 0; i <= numBuckets; ++i)
+    {
+        csv << i * bucketPercent << ","
+            << (i < numBuckets ? juce::String((i + 1) * bucketPercent) : juce::String("inf")) << ","
+            << (juce::int64)intervalHistogram[(size_t)i].load(std::memory_order_relaxed) << ","
+            << (juce::int64)executionHistogram[(size_t)i].load(std::memory_order_relaxed) << "\n";
+    }
+
+    if (!file.replaceWithText(csv))
+    {
+        DBG("Failed to write callback timing to " << file.getFullPathName());
+        return false;
+    }
+
+    DBG("Wrote callback timing to " << file.getFullPathName());
+    return true;
+}
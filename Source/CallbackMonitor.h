@@ -0,0 +1,99 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Watches the device callback against its deadline. For every callback it
+// records, as a share of the block's nominal duration (numSamples / sampleRate),
+// how long it has been since the previous callback started and how long this
+// one took. The first tells us about driver jitter, the second about our own
+// overruns. Both go into fixed histograms that the audio thread updates
+// without locks and the message thread can read or export at any time.
+class CallbackMonitor
+{
+public:
+    struct Summary
+    {
+        juce::uint64 numCallbacks = 0;
+        juce::uint64 numXruns = 0;
+        juce::uint64 numOverruns = 0;
+        juce::uint64 numLateCallbacks = 0;
+        float maxIntervalPercent = 0.0f;
+        float maxExecutionPercent = 0.0f;
+    };
+
+    // Times one callback from construction to destruction
+    class ScopedCallback
+    {
+    public:
+        ScopedCallback(CallbackMonitor& monitorToUse, int numSamplesInBlock) noexcept
+            : monitor(monitorToUse), numSamples(numSamplesInBlock),
+            startTicks(juce::Time::getHighResolutionTicks())
+        {
+        }
+
+        ~ScopedCallback() { monitor.record(startTicks, juce::Time::getHighResolutionTicks(), numSamples); }
+
+    private:
+        CallbackMonitor& monitor;
+        const int numSamples;
+        const juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedCallback)
+    };
+
+    // Message thread, before the device starts. Also clears the statistics.
+    void prepare(double sampleRate);
+
+    // Message thread. The audio thread clears everything on its next callback.
+    void reset() { resetRequested = true; }
+
+    Summary getSummary() const;
+    bool exportCsv(const juce::File& file) const;
+
+    // Histogram buckets are this many percent of the nominal block duration wide
+    static constexpr int bucketPercent = 5;
+    static constexpr int numBuckets = 80;
+
+    // A callback starting more than this share of a block late is counted as
+    // an xrun. Drivers routinely wobble by less; a whole extra period is a
+    // missed buffer.
+    static constexpr float lateIntervalPercent = 150.0f;
+
+private:
+    void record(juce::int64 startTicks, juce::int64 endTicks, int numSamples) noexcept;
+    void clear() noexcept;
+
+    static void increment(std::atomic<juce::uint64>& counter) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static void raise(std::atomic<float>& value, float candidate) noexcept
+    {
+        if (candidate > value.load(std::memory_order_relaxed))
+            value.store(candidate, std::memory_order_relaxed);
+    }
+
+    static int bucketFor(float percent) noexcept
+    {
+        return juce::jlimit(0, numBuckets, (int)(percent / (float)bucketPercent));
+    }
+
+    double ticksPerSecond = 1.0;
+    double sampleRate = 0.0;
+
+    // Audio thread only
+    juce::int64 lastStartTicks = 0;
+
+    std::atomic<bool> resetRequested { false };
+
+    // The last bucket collects everything beyond the histogram's range
+    std::array<std::atomic<juce::uint64>, (size_t)numBuckets + 1> intervalHistogram {};
+    std::array<std::atomic<juce::uint64>, (size_t)numBuckets + 1> executionHistogram {};
+
+    std::atomic<juce::uint64> numCallbacks { 0 };
+    std::atomic<juce::uint64> numXruns { 0 };
+    std::atomic<juce::uint64> numOverruns { 0 };
+    std::atomic<juce::uint64> numLateCallbacks { 0 };
+    std::atomic<float> maxIntervalPercent { 0.0f };
+    std::atomic<float> maxExecutionPercent { 0.0f };
+};
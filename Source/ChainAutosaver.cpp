@@ -0,0 +1,330 @@
+#include "ChainAutosaver.h"
+#include "SandboxedPlugin.h"
+
+ChainAutosaver::ChainAutosaver(Settings& settingsToUse, std::vector<std::unique_ptr<ChannelStrip>>& stripsToSave)
+    : juce::Thread("Chain Autosave"),
+    settings(settingsToUse),
+    strips(stripsToSave)
+{
+    startThread();
+    startTimer(checkIntervalMs);
+}
+
+ChainAutosaver::~ChainAutosaver()
+{
+    stopTimer();
+
+    // The thread drains the queue before it exits
+    signalThreadShouldExit();
+    notify();
+    stopThread(-1);
+}
+
+void ChainAutosaver::markChanged(int strip, int scene)
+{
+    syncStripStates();
+    if (strip < 0 || strip >= (int)strips.size() || scene >= ChannelStrip::maxScenes)
+        return;
+
+    auto& state = getState(strip, scene < 0 ? strips[(size_t)strip]->getActiveScene() : scene);
+    state.structureChanged = true;
+    state.lastChange = juce::Time::getMillisecondCounter();
+}
+
+void ChainAutosaver::saveNow(int strip, int scene, std::function<void(bool)> onDone)
+{
+    if (strip < 0 || strip >= (int)strips.size() || !isSaveable(strip, scene))
+    {
+        if (onDone)
+            onDone(false);
+        return;
+    }
+
+    syncStripStates();
+    capture(strip, scene, std::move(onDone));
+}
+
+void ChainAutosaver::flush()
+{
+    if (!paused)
+    {
+        syncStripStates();
+        for (int i = 0; i < (int)strips.size(); ++i)
+        {
+            for (int scene = 0; scene < ChannelStrip::maxScenes; ++scene)
+            {
+                juce::uint32 lastChange = 0;
+                if (isSaveable(i, scene) && isDirty(i, scene, lastChange))
+                    capture(i, scene, nullptr);
+            }
+        }
+    }
+
+    waitUntilWritten();
+    applyWritten();
+}
+
+void ChainAutosaver::reset()
+{
+    // Saves of the old strips refer to plugins that are gone
+    {
+        const juce::ScopedLock sl(queueLock);
+        written.clear();
+    }
+
+    // New strips start out clean; their plugins carry their own dirty flags
+    stripStates.assign(strips.size() * (size_t)ChannelStrip::maxScenes, StripState());
+}
+
+void ChainAutosaver::syncStripStates()
+{
+    if (stripStates.size() != strips.size() * (size_t)ChannelStrip::maxScenes)
+        reset();
+}
+
+ChainAutosaver::StripState& ChainAutosaver::getState(int strip, int scene)
+{
+    return stripStates[(size_t)(strip * ChannelStrip::maxScenes + scene)];
+}
+
+bool ChainAutosaver::isSaveable(int strip, int scene) const
+{
+    // An unloaded scene's empty chain must never overwrite its saved one
+    return strips[(size_t)strip]->isSceneLoaded(scene);
+}
+
+//==============================================================================
+void ChainAutosaver::timerCallback()
+{
+    applyWritten();
+
+    if (paused)
+        return;
+
+    syncStripStates();
+    const auto now = juce::Time::getMillisecondCounter();
+
+    for (int i = 0; i < (int)strips.size(); ++i)
+    {
+        for (int scene = 0; scene < ChannelStrip::maxScenes; ++scene)
+        {
+            juce::uint32 lastChange = 0;
+            if (!isSaveable(i, scene) || !isDirty(i, scene, lastChange))
+                continue;
+
+            auto& state = getState(i, scene);
+            if (state.dirtySince == 0)
+                state.dirtySince = now;
+
+            // Wait for a pause in the changes, but not forever while a knob is being turned
+            if (now - lastChange < quietTimeMs && now - state.dirtySince < maxDelayMs)
+                continue;
+
+            capture(i, scene, nullptr);
+        }
+    }
+}
+
+bool ChainAutosaver::isDirty(int strip, int scene, juce::uint32& lastChange)
+{
+    auto& state = getState(strip, scene);
+    bool dirty = state.structureChanged;
+    lastChange = state.lastChange;
+
+    for (auto& plugin : strips[(size_t)strip]->getChain(scene).getPlugins())
+    {
+        if (plugin->stateDirty.load())
+        {
+            dirty = true;
+            lastChange = juce::jmax(lastChange, plugin->lastStateChange.load());
+        }
+    }
+
+    return dirty;
+}
+
+void ChainAutosaver::capture(int strip, int scene, std::function<void(bool)> onDone)
+{
+    auto& state = getState(strip, scene);
+    state.structureChanged = false;
+    state.dirtySince = 0;
+
+    Job job;
+    job.strip = strip;
+    job.scene = scene;
+    job.epoch = journal != nullptr ? journal->beginEpoch() : 0;
+    job.journalSequence = journal != nullptr ? journal->getCaptureSequence() : 0;
+    int numCaptured = 0;
+
+    for (auto& plugin : strips[(size_t)strip]->getChain(scene).getPlugins())
+    {
+        if (plugin == nullptr || plugin->processor == nullptr)
+            continue;
+
+        // Cleared first, so a change while capturing is caught next time
+        if (plugin->stateDirty.exchange(false))
+        {
+            plugin->lastSavedState.reset();
+            plugin->processor->getStateInformation(plugin->lastSavedState);
+            ++numCaptured;
+
+            // The autosave thread hashes it, and the hash comes back with the
+            // written job, so it's only worked out once
+            plugin->lastSavedBlob = {};
+            plugin->lastSavedBlobBytes = 0;
+            plugin->savedStateId = 0;
+        }
+
+        if (plugin->savedStateId == 0)
+            plugin->savedStateId = ++lastStateId;
+
+        SavedPlugin entry;
+        entry.description = plugin->processor->getPluginDescription();
+        entry.parallelWithPrevious = plugin->parallelWithPrevious;
+        entry.bypassed = plugin->bypassed.load();
+        entry.sandboxed = dynamic_cast<SandboxedPlugin*>(plugin->processor.get()) != nullptr;
+        entry.state = plugin->lastSavedState;
+        entry.stateBlob = plugin->lastSavedBlob;
+
+        job.plugins.push_back(std::move(entry));
+        job.sources.push_back({ plugin.get(), plugin->savedStateId, plugin->journalTag.load() });
+    }
+
+    if (onDone)
+        job.callbacks.push_back(std::move(onDone));
+
+    DBG("Autosave of strip " << strip + 1 << ", scene " << scene + 1 << ": captured " << numCaptured << " of "
+        << (int)job.plugins.size() << " plugin states");
+
+    {
+        const juce::ScopedLock sl(queueLock);
+        const auto chainId = ChannelStrip::getChainId(strip, scene);
+
+        // A newer capture of the same chain supersedes one that hasn't been written yet
+        auto queued = queue.find(chainId);
+        if (queued != queue.end())
+            for (auto& callback : queued->second.callbacks)
+                job.callbacks.push_back(std::move(callback));
+
+        queue[chainId] = std::move(job);
+    }
+
+    notify();
+}
+
+//==============================================================================
+void ChainAutosaver::run()
+{
+    auto lastCollection = juce::Time::getMillisecondCounter();
+
+    while (!threadShouldExit())
+    {
+        wait(collectIntervalMs);
+        writePending();
+
+        // Here, between writes, no chain of ours is about to refer to a new blob
+        const auto now = juce::Time::getMillisecondCounter();
+        if (now - lastCollection >= (juce::uint32)collectIntervalMs)
+        {
+            settings.collectStateBlobs();
+            lastCollection = now;
+        }
+    }
+
+    writePending();
+}
+
+void ChainAutosaver::writePending()
+{
+    for (;;)
+    {
+        Job job;
+        {
+            const juce::ScopedLock sl(queueLock);
+            if (queue.empty())
+                return;
+
+            job = std::move(queue.begin()->second);
+            queue.erase(queue.begin());
+            writing = true;
+        }
+
+        const bool success = settings.writePluginState(job.plugins, job.strip, job.scene, job.epoch);
+        if (success && journal != nullptr)
+        {
+            std::vector<juce::uint64> previousTags;
+            for (auto& source : job.sources)
+                previousTags.push_back(source.journalTag);
+
+            journal->snapshotWritten(ChannelStrip::getChainId(job.strip, job.scene), job.epoch,
+                job.journalSequence, std::move(previousTags));
+        }
+
+        auto callbacks = std::move(job.callbacks);
+
+        // Only the hashes are needed from here on
+        for (auto& entry : job.plugins)
+            entry.state.reset();
+
+        {
+            const juce::ScopedLock sl(queueLock);
+            writing = false;
+
+            if (success)
+                written.push_back(std::move(job));
+        }
+
+        for (auto& callback : callbacks)
+            juce::MessageManager::callAsync([callback, success] { callback(success); });
+    }
+}
+
+void ChainAutosaver::applyWritten()
+{
+    std::vector<Job> jobs;
+    {
+        const juce::ScopedLock sl(queueLock);
+        jobs.swap(written);
+    }
+
+    for (auto& job : jobs)
+    {
+        if (job.strip >= (int)strips.size())
+            continue;
+
+        auto& chain = strips[(size_t)job.strip]->getChain(job.scene);
+
+        for (size_t slot = 0; slot < job.sources.size(); ++slot)
+        {
+            // Skip plugins that have gone, or been captured again since
+            auto* plugin = job.sources[slot].plugin;
+            if (chain.indexOf(plugin) < 0 || plugin->savedStateId != job.sources[slot].stateId)
+                continue;
+
+            // Only now is there a snapshot for the journaled changes to refer to
+            if (journal != nullptr)
+                plugin->journalTag = ParameterJournal::makeTag(job.epoch, (int)slot);
+
+            auto& saved = job.plugins[slot];
+            if (plugin->lastSavedBlob.isEmpty() && saved.stateBlob.isNotEmpty())
+            {
+                plugin->lastSavedBlob = saved.stateBlob;
+                plugin->lastSavedBlobBytes = plugin->lastSavedState.getSize();
+            }
+        }
+    }
+}
+
+void ChainAutosaver::waitUntilWritten()
+{
+    for (;;)
+    {
+        {
+            const juce::ScopedLock sl(queueLock);
+            if (queue.empty() && !writing)
+                return;
+        }
+
+        juce::Thread::sleep(1);
+    }
+}
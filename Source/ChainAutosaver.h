@@ -0,0 +1,112 @@
+#pragma once
+#include <JuceHeader.h>
+#include "Settings.h"
+#include "ChannelStrip.h"
+
+// Saves the chains in the background as they change. Edits to a chain and
+// parameter changes reported by its plugins mark the strip dirty. A strip is
+// saved once it has been quiet for a second, or after a few seconds of
+// continuous changes. Only plugins that reported a change have their state
+// captured again; the rest reuse the state captured last time.
+//
+// Capturing has to happen on the message thread, since that's where plugins
+// expect getStateInformation. Everything after that, hashing large states for
+// the blob store, encoding and writing the file through a temporary file and a
+// rename, happens on the autosave thread.
+// Saves for a strip that queue up while one is being written are merged.
+// Each scene of a strip is saved to a file of its own; scenes that aren't
+// loaded are left alone.
+// Every so often the thread also clears unused blobs out of the blob store.
+class ChainAutosaver : private juce::Timer,
+    private juce::Thread
+{
+public:
+    ChainAutosaver(Settings& settings, std::vector<std::unique_ptr<ChannelStrip>>& strips);
+    ~ChainAutosaver() override;
+
+    // Message thread. A scene's chain was edited; -1 is the strip's active scene.
+    void markChanged(int strip, int scene = -1);
+
+    // Message thread. Saves the scene right away; onDone is called on the
+    // message thread once it's on disk.
+    void saveNow(int strip, int scene, std::function<void(bool)> onDone = nullptr);
+
+    // Message thread. Saves whatever is dirty and waits until it's written,
+    // e.g. before the strips are rebuilt or the app quits.
+    void flush();
+
+    // While paused nothing is saved, e.g. while chains are still being restored
+    void setPaused(bool shouldBePaused) { paused = shouldBePaused; }
+
+    // The strips were rebuilt
+    void reset();
+
+    // Snapshots get an epoch from the journal and, once the snapshot is on
+    // disk, the plugins in them are tagged with their slot, so journaled
+    // changes can find them again
+    void setJournal(ParameterJournal* journalToUse) { journal = journalToUse; }
+
+private:
+    struct StripState
+    {
+        bool structureChanged = false;
+        juce::uint32 lastChange = 0;
+        juce::uint32 dirtySince = 0;
+    };
+
+    // Which plugin, and which of its captured states, each slot was saved
+    // from, and the journal tag it had then
+    struct Source
+    {
+        PluginInstance* plugin = nullptr;
+        juce::uint64 stateId = 0;
+        juce::uint64 journalTag = 0;
+    };
+
+    struct Job
+    {
+        int strip = 0;
+        int scene = 0;
+        juce::uint32 epoch = 0;
+        juce::uint64 journalSequence = 0;
+        std::vector<SavedPlugin> plugins;
+        std::vector<Source> sources;
+        std::vector<std::function<void(bool)>> callbacks;
+    };
+
+    void timerCallback() override;
+    void run() override;
+
+    void syncStripStates();
+    StripState& getState(int strip, int scene);
+    bool isSaveable(int strip, int scene) const;
+    bool isDirty(int strip, int scene, juce::uint32& lastChange);
+    void capture(int strip, int scene, std::function<void(bool)> onDone);
+    void writePending();
+    void waitUntilWritten();
+    void applyWritten();
+
+    Settings& settings;
+    std::vector<std::unique_ptr<ChannelStrip>>& strips;
+    // One per scene slot of every strip
+    std::vector<StripState> stripStates;
+    ParameterJournal* journal = nullptr;
+    bool paused = false;
+
+    // Keyed by chain id
+    juce::CriticalSection queueLock;
+    std::map<int, Job> queue;
+    bool writing = false;
+
+    // Jobs on disk, for the message thread to tag their plugins and note
+    // their blob hashes
+    std::vector<Job> written;
+    juce::uint64 lastStateId = 0;
+
+    static constexpr int checkIntervalMs = 200;
+    static constexpr juce::uint32 quietTimeMs = 1000;
+    static constexpr juce::uint32 maxDelayMs = 5000;
+    static constexpr int collectIntervalMs = 10 * 60 * 1000;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChainAutosaver)
+};
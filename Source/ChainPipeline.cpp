@@ -0,0 +1,317 @@
+#include "ChainPipeline.h"
+#include "PluginChain.h"
+#include "RealtimePolicy.h"
+#include "SandboxedPlugin.h"
+
+//==============================================================================
+bool ChainPipeline::SlotQueue::push(int slot)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+        return false;
+
+    items[(size_t)start1] = slot;
+    fifo.finishedWrite(1);
+    return true;
+}
+
+bool ChainPipeline::SlotQueue::pop(int& slot)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+        return false;
+
+    slot = items[(size_t)start1];
+    fifo.finishedRead(1);
+    return true;
+}
+
+//==============================================================================
+ChainPipeline::SegmentWorker::SegmentWorker(ChainPipeline& owner, int segmentToRun)
+    : juce::Thread("Pipeline Segment " + juce::String(segmentToRun)),
+    pipeline(owner),
+    segment(segmentToRun)
+{
+}
+
+void ChainPipeline::SegmentWorker::run()
+{
+    auto& input = *pipeline.queues[(size_t)segment - 1];
+    auto& output = *pipeline.queues[(size_t)segment];
+
+    while (!threadShouldExit())
+    {
+        if (auto* policy = pipeline.chain.policy)
+            policy->applyToCurrentThread(RealtimePolicy::firstPipelineThread + segment - 1);
+
+        int slot = -1;
+        if (input.pop(slot))
+        {
+            pipeline.processSlot(*pipeline.slots[(size_t)slot], segment);
+            output.push(slot);
+            pipeline.wakeSegment(segment + 1);
+            continue;
+        }
+
+        // Stay hot for a little while; the next block is never far away
+        bool newWork = false;
+        for (int i = 0; i < spinsBeforeSleeping && !newWork; ++i)
+            newWork = !input.isEmpty();
+
+        if (newWork)
+            continue;
+
+        sleeping = true;
+        if (input.isEmpty())
+            wakeUp.wait(50);
+        sleeping = false;
+    }
+}
+
+//==============================================================================
+ChainPipeline::ChainPipeline(PluginChain& owner, int segmentsToUse, int numChannels, int maximumBlockSize)
+    : chain(owner),
+    numSegments(juce::jmax(2, segmentsToUse))
+{
+    // Enough for every block in flight plus a little slack for late workers
+    const auto numSlots = numSegments + 2;
+
+    for (int i = 0; i < numSlots; ++i)
+    {
+        auto slot = std::make_unique<Slot>();
+        slot->audio.setSize(numChannels, maximumBlockSize);
+        slot->dry.setSize(numChannels, maximumBlockSize);
+        slot->midi.ensureSize(ProcessingContext::midiBytesToReserve);
+        memoryLock.add(slot->audio);
+        memoryLock.add(slot->dry);
+        slots.push_back(std::move(slot));
+        freeSlots.push_back(i);
+    }
+
+    finishedSlots.reserve((size_t)numSlots);
+
+    for (int i = 0; i < numSegments; ++i)
+        queues.push_back(std::make_unique<SlotQueue>());
+
+    // Segment 0 runs on the device thread. The workers leave their affinity
+    // alone: the real-time policy pins them, and restores what they started
+    // with when pinning is turned off.
+    for (int segment = 1; segment < numSegments; ++segment)
+        workers.add(new SegmentWorker(*this, segment))->startThread(juce::Thread::realtimeAudioPriority);
+
+    DBG("Pipeline started with " << numSegments << " segments, "
+        << getLatencyInBlocks() << " block(s) of added latency");
+}
+
+ChainPipeline::~ChainPipeline()
+{
+    for (auto* worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->wakeUp.signal();
+    }
+
+    for (auto* worker : workers)
+        worker->stopThread(2000);
+
+    // Let go of the snapshots held by blocks that never came out
+    for (auto& slot : slots)
+        if (slot->snapshot != nullptr)
+            slot->snapshot->pipelineRefs.fetch_sub(1);
+
+    if (feeding != nullptr)
+        feeding->pipelineRefs.fetch_sub(1);
+}
+
+//==============================================================================
+void ChainPipeline::process(ChainSnapshot& snapshot, juce::AudioBuffer<float>& block, int numSamples)
+{
+    const auto sequence = nextSequence++;
+
+    int index = -1;
+    while (queues.back()->pop(index))
+        finishedSlots.push_back(index);
+
+    // Feed the new block in and run the first segment here
+    if (!adopt(snapshot))
+    {
+        // Waiting for the pipeline to drain; this block is dropped
+        lastUnfedSequence = sequence;
+    }
+    else if (!freeSlots.empty())
+    {
+        const auto slotIndex = freeSlots.back();
+        freeSlots.pop_back();
+
+        auto& slot = *slots[(size_t)slotIndex];
+        snapshot.pipelineRefs.fetch_add(1);
+        slot.snapshot = &snapshot;
+        slot.sequence = sequence;
+        slot.numSamples = numSamples;
+        slot.view.setDataToReferTo(slot.audio.getArrayOfWritePointers(), block.getNumChannels(), numSamples);
+
+        for (int channel = 0; channel < block.getNumChannels(); ++channel)
+            slot.view.copyFrom(channel, 0, block, channel, 0, numSamples);
+
+        slot.midi.clear();
+        processSlot(slot, 0);
+
+        queues[0]->push(slotIndex);
+        wakeSegment(1);
+    }
+    else
+    {
+        // Every slot is stuck in a worker that has fallen behind
+        lateBlocks.fetch_add(1);
+    }
+
+    // Hand out exactly the block that is due; anything older arrived too late
+    const auto due = sequence - getLatencyInBlocks();
+    int dueSlot = -1;
+
+    for (auto it = finishedSlots.begin(); it != finishedSlots.end();)
+    {
+        const auto slotSequence = slots[(size_t)*it]->sequence;
+
+        if (slotSequence < due)
+        {
+            recycle(*it);
+            it = finishedSlots.erase(it);
+        }
+        else if (slotSequence == due)
+        {
+            dueSlot = *it;
+            it = finishedSlots.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (dueSlot < 0)
+    {
+        if (due >= 0 && due > lastUnfedSequence)
+            lateBlocks.fetch_add(1);
+
+        block.clear();
+        return;
+    }
+
+    auto& slot = *slots[(size_t)dueSlot];
+    const auto numToCopy = juce::jmin(numSamples, slot.numSamples);
+
+    for (int channel = 0; channel < block.getNumChannels(); ++channel)
+    {
+        block.copyFrom(channel, 0, slot.view, channel, 0, numToCopy);
+
+        if (numToCopy < numSamples)
+            block.clear(channel, numToCopy, numSamples - numToCopy);
+    }
+
+    recycle(dueSlot);
+}
+
+// Blocks already in flight carry on with the snapshot they went in with. A
+// plugin moving to a later segment still sees its blocks in order, but one
+// moving to an earlier segment would get the new block before older ones had
+// reached it. Such a switch waits until nothing is in flight, at the cost of
+// a gap no longer than the pipeline's latency.
+bool ChainPipeline::adopt(ChainSnapshot& snapshot)
+{
+    if (&snapshot == feeding)
+        return true;
+
+    if (feeding != nullptr && getNumInFlight() > 0 && movesPluginEarlier(snapshot))
+        return false;
+
+    if (feeding != nullptr)
+        feeding->pipelineRefs.fetch_sub(1);
+
+    snapshot.pipelineRefs.fetch_add(1);
+    feeding = &snapshot;
+    return true;
+}
+
+bool ChainPipeline::movesPluginEarlier(const ChainSnapshot& next) const
+{
+    auto movesEarlier = [&](const PluginInstance* plugin)
+    {
+        return findSegment(*feeding, plugin) > findSegment(next, plugin);
+    };
+
+    for (auto& stage : next.stages)
+    {
+        if (stage->plugin != nullptr && movesEarlier(stage->plugin))
+            return true;
+
+        for (auto& branch : stage->branches)
+            if (movesEarlier(branch->plugin))
+                return true;
+    }
+
+    return false;
+}
+
+// The segment running the plugin in this snapshot, or -1 if it isn't in it
+int ChainPipeline::findSegment(const ChainSnapshot& snapshot, const PluginInstance* plugin)
+{
+    int segment = 0;
+
+    for (int i = 0; i < (int)snapshot.stages.size(); ++i)
+    {
+        while (segment + 1 < (int)snapshot.segmentStarts.size() - 1 && i >= snapshot.segmentStarts[(size_t)segment + 1])
+            ++segment;
+
+        auto& stage = *snapshot.stages[(size_t)i];
+        if (stage.plugin == plugin)
+            return segment;
+
+        for (auto& branch : stage.branches)
+            if (branch->plugin == plugin)
+                return segment;
+    }
+
+    return -1;
+}
+
+int ChainPipeline::getNumInFlight() const
+{
+    return (int)(slots.size() - freeSlots.size() - finishedSlots.size());
+}
+
+void ChainPipeline::processSlot(Slot& slot, int segment)
+{
+    // Each segment has a block's time of its own, but on the device thread
+    // the callback's deadline comes first
+    const SandboxedPlugin::ScopedDeadline sandboxDeadline(juce::Time::getHighResolutionTicks(),
+        slot.numSamples, chain.getSampleRate());
+    chain.processSegment(*slot.snapshot, segment, slot.view, slot.dry, slot.midi, slot.numSamples);
+}
+
+void ChainPipeline::wakeSegment(int segment)
+{
+    if (segment >= 1 && segment < numSegments)
+    {
+        auto* worker = workers[segment - 1];
+        if (worker->sleeping.load())
+            worker->wakeUp.signal();
+    }
+}
+
+void ChainPipeline::recycle(int slot)
+{
+    auto& s = *slots[(size_t)slot];
+
+    if (s.snapshot != nullptr)
+    {
+        s.snapshot->pipelineRefs.fetch_sub(1);
+        s.snapshot = nullptr;
+    }
+
+    freeSlots.push_back(slot);
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <JuceHeader.h>
+#include "ChainSnapshot.h"
+#include "AudioMemoryLock.h"
+
+// Opt-in pipelining of a long chain across cores. The chain is cut into
+// segments; the device thread runs the first one and every further segment
+// runs on its own pinned worker, with blocks handed along through lock-free
+// queues. The device thread always outputs the block that went in exactly
+// getLatencyInBlocks() callbacks earlier, so the added latency is fixed.
+class ChainPipeline
+{
+public:
+    ChainPipeline(PluginChain& owner, int numSegments, int numChannels, int maximumBlockSize);
+    ~ChainPipeline();
+
+    int getNumSegments() const { return numSegments; }
+    int getLatencyInBlocks() const { return numSegments - 1; }
+    juce::uint64 getNumLateBlocks() const { return lateBlocks.load(); }
+
+    // Device thread. Feeds the block in and replaces its contents with the
+    // output of the block that entered getLatencyInBlocks() callbacks ago.
+    void process(ChainSnapshot& snapshot, juce::AudioBuffer<float>& block, int numSamples);
+
+private:
+    struct Slot
+    {
+        juce::AudioBuffer<float> audio;
+        juce::AudioBuffer<float> view;
+        juce::AudioBuffer<float> dry;
+        juce::MidiBuffer midi;
+        ChainSnapshot* snapshot = nullptr;
+        juce::int64 sequence = 0;
+        int numSamples = 0;
+    };
+
+    // Single producer, single consumer queue of slot indices
+    class SlotQueue
+    {
+    public:
+        bool push(int slot);
+        bool pop(int& slot);
+        bool isEmpty() const { return fifo.getNumReady() == 0; }
+
+    private:
+        static constexpr int capacity = 16;
+        juce::AbstractFifo fifo { capacity };
+        std::array<int, (size_t)capacity> items {};
+    };
+
+    class SegmentWorker : public juce::Thread
+    {
+    public:
+        SegmentWorker(ChainPipeline& owner, int segmentToRun);
+        void run() override;
+
+        std::atomic<bool> sleeping { false };
+        juce::WaitableEvent wakeUp;
+
+    private:
+        ChainPipeline& pipeline;
+        const int segment;
+    };
+
+    bool adopt(ChainSnapshot& snapshot);
+    bool movesPluginEarlier(const ChainSnapshot& next) const;
+    static int findSegment(const ChainSnapshot& snapshot, const PluginInstance* plugin);
+    int getNumInFlight() const;
+
+    void processSlot(Slot& slot, int segment);
+    void wakeSegment(int segment);
+    void recycle(int slot);
+
+    PluginChain& chain;
+    const int numSegments;
+
+    std::vector<std::unique_ptr<Slot>> slots;
+    std::vector<std::unique_ptr<SlotQueue>> queues;
+    juce::OwnedArray<SegmentWorker> workers;
+
+    // Device thread only; both have their capacity reserved up front
+    std::vector<int> freeSlots;
+    std::vector<int> finishedSlots;
+
+    // The snapshot new blocks go in with. The pipeline holds a reference on
+    // it so it can still be compared against the next one.
+    ChainSnapshot* feeding = nullptr;
+
+    juce::int64 nextSequence = 0;
+    juce::int64 lastUnfedSequence = -1;
+    std::atomic<juce::uint64> lateBlocks { 0 };
+
+    // Slot buffers; declared after them so it unlocks before they're freed
+    AudioMemoryLock::Regions memoryLock;
+
+    static constexpr int spinsBeforeSleeping = 20000;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChainPipeline)
+};
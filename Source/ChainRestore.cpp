@@ -0,0 +1,272 @@
+#include "ChainRestore.h"
+
+ChainRestore::ChainRestore(Settings& settingsToUse, juce::AudioPluginFormatManager& formatManagerToUse,
+    PluginScanCache& scanCacheToUse,
+    std::vector<std::unique_ptr<ChannelStrip>>& stripsToRestore,
+    double sampleRateToUse, int blockSizeToUse, bool progressiveRestore, int warmupBlocksToUse)
+    : settings(settingsToUse),
+    formatManager(formatManagerToUse),
+    scanCache(scanCacheToUse),
+    strips(stripsToRestore),
+    sampleRate(sampleRateToUse),
+    blockSize(blockSizeToUse),
+    progressive(progressiveRestore),
+    warmupBlocks(warmupBlocksToUse),
+    readers(juce::jmax(1, (int)stripsToRestore.size()))
+{
+    for (size_t i = 0; i < strips.size(); ++i)
+    {
+        for (int scene = 0; scene < ChannelStrip::maxScenes; ++scene)
+        {
+            if (!strips[i]->isSceneLoaded(scene))
+                continue;
+
+            restores.push_back(std::make_unique<StripRestore>());
+
+            auto* restore = restores.back().get();
+            restore->strip = (int)i;
+            restore->scene = scene;
+            readers.addJob([this, restore]
+            {
+                std::vector<SavedPlugin> saved;
+                settings.readPluginState(saved, restore->strip, restore->scene, &restore->epoch);
+
+                for (auto& entry : saved)
+                {
+                    restore->slots.emplace_back();
+                    restore->slots.back().saved = std::move(entry);
+                }
+
+                restore->read.store(true, std::memory_order_release);
+            });
+        }
+    }
+
+    startTimer(1);
+}
+
+ChainRestore::~ChainRestore()
+{
+    stopTimer();
+    readers.removeAllJobs(true, 10000);
+}
+
+void ChainRestore::finishNow()
+{
+    while (!finished)
+        if (!step())
+            juce::Thread::sleep(1);
+}
+
+int ChainRestore::getNumDone() const
+{
+    int done = 0;
+    for (auto& restore : restores)
+        if (restore->read.load(std::memory_order_acquire))
+            for (auto& slot : restore->slots)
+                done += slot.done ? 1 : 0;
+    return done;
+}
+
+int ChainRestore::getNumSlots() const
+{
+    int slots = 0;
+    for (auto& restore : restores)
+        if (restore->read.load(std::memory_order_acquire))
+            slots += (int)restore->slots.size();
+    return slots;
+}
+
+//==============================================================================
+void ChainRestore::timerCallback()
+{
+    // One step per tick, so the window gets to paint between plugins
+    step();
+}
+
+bool ChainRestore::step()
+{
+    if (finished)
+        return false;
+
+    bool progress = false;
+
+    for (auto& restore : restores)
+    {
+        if (!restore->read.load(std::memory_order_acquire))
+            continue;
+
+        if (!restore->sandboxesSpawned)
+        {
+            spawnSandboxes(*restore);
+            progress = true;
+        }
+
+        progress = pollSandboxes(*restore) || progress;
+    }
+
+    // Only one in-process plugin per step; creating one can take a while
+    if (!progress)
+        progress = createNextPlugin();
+
+    bool allAdded = true;
+    for (auto& stripRestore : restores)
+    {
+        progress = addReadyPlugins(*stripRestore) || progress;
+
+        auto& restore = *stripRestore;
+        allAdded = allAdded && restore.read.load(std::memory_order_acquire)
+                            && restore.nextToAdd == restore.slots.size();
+    }
+
+    if (allAdded)
+    {
+        finish();
+        return true;
+    }
+
+    return progress;
+}
+
+void ChainRestore::spawnSandboxes(StripRestore& restore)
+{
+    restore.sandboxesSpawned = true;
+
+    for (auto& slot : restore.slots)
+    {
+        if (!slot.saved.sandboxed || !SandboxChannel::isSupported())
+            continue;
+
+        juce::String error;
+        juce::MemoryBlock state(slot.saved.getStateData(), slot.saved.getStateSize());
+        slot.sandbox = SandboxedPlugin::spawn(slot.saved.description, state, sampleRate, blockSize, error);
+        if (slot.sandbox == nullptr)
+        {
+            DBG("Failed to start sandbox for " << slot.saved.description.name << ": " << error);
+            slot.done = true;
+        }
+    }
+}
+
+bool ChainRestore::pollSandboxes(StripRestore& restore)
+{
+    bool progress = false;
+
+    for (auto& slot : restore.slots)
+    {
+        if (slot.done || slot.sandbox == nullptr)
+            continue;
+
+        juce::String error;
+        auto startup = slot.sandbox->checkStartup(error);
+        if (startup == SandboxedPlugin::Startup::pending)
+            continue;
+
+        if (startup == SandboxedPlugin::Startup::ready)
+        {
+            slot.plugin = std::make_unique<PluginInstance>();
+            slot.plugin->parallelWithPrevious = slot.saved.parallelWithPrevious;
+            slot.plugin->bypassed = slot.saved.bypassed;
+            slot.plugin->processor = std::move(slot.sandbox);
+            slot.plugin->lastSavedState = slot.saved.state;
+            slot.plugin->lastSavedBlob = slot.saved.isStateAvailable() ? slot.saved.stateBlob : juce::String();
+            slot.plugin->lastSavedBlobBytes = slot.plugin->lastSavedBlob.isNotEmpty() ? slot.saved.getStateSize() : 0;
+            slot.plugin->stateDirty = !slot.saved.isStateAvailable();
+        }
+        else
+        {
+            DBG("Sandbox for " << slot.saved.description.name << " failed: " << error);
+            slot.sandbox = nullptr;
+        }
+
+        slot.done = true;
+        progress = true;
+    }
+
+    return progress;
+}
+
+bool ChainRestore::createNextPlugin()
+{
+    // Earlier strips first, and in chain order, so plugins can join as soon as possible
+    for (auto& restore : restores)
+    {
+        if (!restore->sandboxesSpawned)
+            continue;
+
+        for (auto& slot : restore->slots)
+        {
+            if (slot.done || slot.sandbox != nullptr)
+                continue;
+
+            slot.plugin = Settings::createPlugin(slot.saved, formatManager, scanCache, sampleRate, blockSize);
+            slot.done = true;
+
+            if (slot.plugin != nullptr && warmupBlocks > 0)
+            {
+                slot.warming = true;
+                readers.addJob([this, &slot]
+                {
+                    PluginWarmup::preroll(*slot.plugin, warmupBlocks, blockSize);
+                    slot.warming.store(false, std::memory_order_release);
+                });
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ChainRestore::addReadyPlugins(StripRestore& restore)
+{
+    if (!restore.read.load(std::memory_order_acquire))
+        return false;
+
+    auto& strip = *strips[(size_t)restore.strip];
+    const bool joinNow = progressive && restore.scene == strip.getActiveScene();
+    bool added = false;
+
+    while (restore.nextToAdd < restore.slots.size() && restore.slots[restore.nextToAdd].done
+        && !restore.slots[restore.nextToAdd].warming.load(std::memory_order_acquire))
+    {
+        auto& slot = restore.slots[restore.nextToAdd++];
+        if (slot.plugin == nullptr)
+            continue;
+
+        // Journaled changes since the snapshot refer to it by this
+        slot.plugin->journalTag = ParameterJournal::makeTag(restore.epoch, slot.saved.slot);
+
+        if (joinNow)
+            strip.getChain(restore.scene).addPlugin(std::move(slot.plugin));
+        else
+            restore.loaded.push_back(std::move(slot.plugin));
+
+        added = true;
+    }
+
+    if (added && joinNow && onProgress)
+        onProgress();
+
+    return added;
+}
+
+void ChainRestore::finish()
+{
+    stopTimer();
+    finished = true;
+
+    for (auto& restore : restores)
+    {
+        auto& chain = strips[(size_t)restore->strip]->getChain(restore->scene);
+        if (!restore->loaded.empty())
+            chain.setPlugins(std::move(restore->loaded));
+
+        DBG("Strip " << restore->strip + 1 << ", scene " << restore->scene + 1 << ": restored " << chain.size()
+            << " of " << (int)restore->slots.size() << " plugins");
+    }
+
+    if (onFinished)
+        onFinished();
+}
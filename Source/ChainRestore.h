@@ -0,0 +1,94 @@
+#pragma once
+#include <JuceHeader.h>
+#include "Settings.h"
+#include "ChannelStrip.h"
+#include "SandboxedPlugin.h"
+#include "PluginWarmup.h"
+
+// Brings the saved chains back after the window is already up. The state
+// files are read and decoded on background threads, one per chain: every
+// loaded scene of every strip.
+// Sandboxed plugins are all spawned at once and load in parallel in their own
+// processes. In-process plugins have to be created on the message thread, so
+// they are created one per timer tick, and the UI keeps running in between.
+//
+// Each in-process plugin is warmed up with a few blocks of silence on a reader
+// thread before it's allowed to join.
+//
+// Plugins join their chain in order. In progressive mode each one is added
+// as soon as it and every plugin before it are ready, fading in from the dry
+// signal. Otherwise each chain is handed over complete once every strip is
+// done, and the owner keeps the output silent until then. Standby scenes
+// aren't heard, so they are always handed over complete.
+class ChainRestore : private juce::Timer
+{
+public:
+    ChainRestore(Settings& settings, juce::AudioPluginFormatManager& formatManager, PluginScanCache& scanCache,
+        std::vector<std::unique_ptr<ChannelStrip>>& strips,
+        double sampleRate, int blockSize, bool progressive, int warmupBlocks);
+    ~ChainRestore() override;
+
+    bool isFinished() const { return finished; }
+    bool isProgressive() const { return progressive; }
+
+    // Blocks until everything is restored, e.g. before the strips are rebuilt
+    void finishNow();
+
+    // Slots that have been dealt with, loaded or not, out of those read so far
+    int getNumDone() const;
+    int getNumSlots() const;
+
+    // Called on the message thread as plugins join their chains, and once at the end
+    std::function<void()> onProgress;
+    std::function<void()> onFinished;
+
+private:
+    struct Slot
+    {
+        SavedPlugin saved;
+        std::unique_ptr<SandboxedPlugin> sandbox;
+        std::unique_ptr<PluginInstance> plugin;
+        bool done = false;
+
+        // Set while a reader thread prerolls the plugin; it's off limits until then
+        std::atomic<bool> warming { false };
+    };
+
+    struct StripRestore
+    {
+        int strip = 0;
+        int scene = 0;
+        // A deque, as slots hold an atomic and can't be moved
+        std::deque<Slot> slots;
+        std::atomic<bool> read { false };
+        juce::uint32 epoch = 0;
+        bool sandboxesSpawned = false;
+        size_t nextToAdd = 0;
+        std::vector<std::unique_ptr<PluginInstance>> loaded;
+    };
+
+    void timerCallback() override;
+
+    // Does the next piece of work; false if everything is waiting on something else
+    bool step();
+    void spawnSandboxes(StripRestore& strip);
+    bool pollSandboxes(StripRestore& strip);
+    bool createNextPlugin();
+    bool addReadyPlugins(StripRestore& restore);
+    void finish();
+
+    Settings& settings;
+    juce::AudioPluginFormatManager& formatManager;
+    PluginScanCache& scanCache;
+    std::vector<std::unique_ptr<ChannelStrip>>& strips;
+    const double sampleRate;
+    const int blockSize;
+    const bool progressive;
+    const int warmupBlocks;
+
+    std::vector<std::unique_ptr<StripRestore>> restores;
+    juce::ThreadPool readers;
+    bool finished = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChainRestore)
+};
@@ -0,0 +1,97 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PluginInstance.h"
+#include "RealtimeThreadPool.h"
+#include "AudioMemoryLock.h"
+
+class PluginChain;
+
+// Fixed whole-sample delay, sized off the audio thread. Its line stays locked
+// in memory for as long as it lives, since a delay can outlive the snapshot
+// it was made for.
+struct SampleDelay
+{
+    void prepare(int numChannels, int samples);
+
+    // Whether prepare() with these arguments would leave it as it is
+    bool matches(int numChannels, int samples) const
+    {
+        return samples == delaySamples && (samples == 0 || numChannels == line.getNumChannels());
+    }
+
+    // Delays the buffer in place
+    void process(juce::AudioBuffer<float>& buffer, int numSamples) noexcept;
+
+    // Writes a delayed copy of input into output, leaving input untouched
+    void processInto(const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+        int numSamples) noexcept;
+
+    int getDelay() const { return delaySamples; }
+
+private:
+    juce::AudioBuffer<float> line;
+    int delaySamples = 0;
+    int position = 0;
+
+    // Declared after the line, so it unlocks before the line is freed
+    AudioMemoryLock::Regions memoryLock;
+};
+
+struct ChainBranch
+{
+    PluginInstance* plugin = nullptr;
+    juce::AudioBuffer<float> audio;
+    juce::AudioBuffer<float> view;
+    juce::AudioBuffer<float> dry;
+    juce::MidiBuffer midi;
+
+    // The plugin's input delayed by its latency, for aligned crossfades
+    std::shared_ptr<SampleDelay> dryDelay;
+
+    // A branch with less latency than the slowest one in its split is held
+    // back by the difference so the sum lines up.
+    std::shared_ptr<SampleDelay> compensation;
+};
+
+// Delay lines belong to their plugin rather than the snapshot: a republish
+// carries them over while their length stays the same, so they don't start
+// again from silence. The plugin's inProcess flag guards them like the plugin.
+//
+// A serial stage runs one plugin in place on the chain's buffer. A parallel
+// stage fans its input out to its branches and sums them back together.
+struct ChainStage : public RealtimeThreadPool::Job
+{
+    void run(int index) noexcept override;
+
+    PluginInstance* plugin = nullptr;
+    std::shared_ptr<SampleDelay> dryDelay;
+    std::vector<std::unique_ptr<ChainBranch>> branches;
+    int latencySamples = 0;
+
+    // Arguments for the current run, set by the thread driving the stage
+    PluginChain* chain = nullptr;
+    const juce::AudioBuffer<float>* input = nullptr;
+    int numSamples = 0;
+};
+
+// Its shape is fixed once published: stages, branches and segment boundaries
+// never change. Running it still writes to it - each stage's run arguments and
+// branch buffers - so a stage is only ever driven by the one thread that owns
+// its segment: the audio thread, or that segment's pipeline worker.
+struct ChainSnapshot
+{
+    std::vector<std::unique_ptr<ChainStage>> stages;
+    int latencySamples = 0;
+
+    // Pipeline segment k covers stages [segmentStarts[k], segmentStarts[k + 1]).
+    std::vector<int> segmentStarts;
+
+    // Blocks still travelling through the pipeline that were started with this
+    // snapshot. It can't be reclaimed until they have all come out.
+    std::atomic<int> pipelineRefs { 0 };
+
+    int getNumSegments() const { return juce::jmax(1, (int)segmentStarts.size() - 1); }
+
+    // Covers every stage and branch buffer above; declared last to go first
+    AudioMemoryLock::Regions memoryLock;
+};
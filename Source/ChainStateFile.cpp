@@ -0,0 +1,245 @@
+#include "ChainStateFile.h"
+#include "Settings.h"
+
+namespace
+{
+    const char magic[4] = { 'V', 'M', 'C', 'S' };
+
+    juce::uint32 readUint32(const char* p) { return juce::ByteOrder::littleEndianInt(p); }
+    juce::uint64 readUint64(const char* p) { return juce::ByteOrder::littleEndianInt64(p); }
+}
+
+bool ChainStateFile::write(const juce::File& file, const std::vector<SavedPlugin>& plugins, bool compressState,
+    juce::uint32 snapshotEpoch)
+{
+    // Payloads first, so the table can point at them
+    std::vector<juce::MemoryBlock> descriptions, states;
+    std::vector<juce::uint32> flags;
+    std::vector<juce::uint64> rawSizes;
+
+    for (auto& plugin : plugins)
+    {
+        juce::uint32 pluginFlags = (plugin.parallelWithPrevious ? parallelFlag : 0)
+                                 | (plugin.bypassed ? bypassedFlag : 0)
+                                 | (plugin.sandboxed ? sandboxedFlag : 0);
+
+        juce::String descriptionXml;
+        if (auto xml = plugin.description.createXml())
+            descriptionXml = xml->toString(juce::XmlElement::TextFormat().singleLine().withoutHeader());
+        descriptions.emplace_back(descriptionXml.toRawUTF8(), descriptionXml.getNumBytesAsUTF8());
+
+        juce::MemoryBlock stored;
+        if (plugin.stateBlob.isNotEmpty())
+        {
+            stored.append(plugin.stateBlob.toRawUTF8(), plugin.stateBlob.getNumBytesAsUTF8());
+            pluginFlags |= blobFlag;
+        }
+        else if (compressState && plugin.state.getSize() >= minSizeToCompress)
+        {
+            juce::MemoryBlock compressed;
+            {
+                juce::MemoryOutputStream out(compressed, false);
+                juce::GZIPCompressorOutputStream deflater(out, 1);
+                deflater.write(plugin.state.getData(), plugin.state.getSize());
+            }
+
+            // Already compressed states, e.g. audio files, hardly shrink
+            if (compressed.getSize() < plugin.state.getSize() - plugin.state.getSize() / 8)
+            {
+                stored = std::move(compressed);
+                pluginFlags |= compressedFlag;
+            }
+        }
+
+        if ((pluginFlags & (compressedFlag | blobFlag)) == 0)
+            stored = plugin.state;
+
+        rawSizes.push_back((pluginFlags & compressedFlag) != 0 ? plugin.state.getSize() : stored.getSize());
+        states.push_back(std::move(stored));
+        flags.push_back(pluginFlags);
+    }
+
+    juce::MemoryOutputStream head;
+    head.write(magic, sizeof(magic));
+    head.writeInt((int)currentVersion);
+    head.writeInt((int)plugins.size());
+    head.writeInt((int)snapshotEpoch);
+
+    auto offset = (juce::uint64)headerSize + (juce::uint64)entrySize * plugins.size();
+    for (size_t i = 0; i < plugins.size(); ++i)
+    {
+        head.writeInt64((juce::int64)offset);
+        head.writeInt((int)descriptions[i].getSize());
+        head.writeInt((int)flags[i]);
+        offset += descriptions[i].getSize();
+
+        head.writeInt64((juce::int64)offset);
+        head.writeInt64((juce::int64)states[i].getSize());
+        head.writeInt64((juce::int64)rawSizes[i]);
+        offset += states[i].getSize();
+    }
+
+    // Written beside the target and renamed over it, so a crash mid-write
+    // leaves the previous chain intact
+    juce::TemporaryFile temp(file);
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (out.failedToOpen())
+        {
+            DBG("Failed to open " << temp.getFile().getFullPathName());
+            return false;
+        }
+
+        out.write(head.getData(), head.getDataSize());
+        for (size_t i = 0; i < plugins.size(); ++i)
+        {
+            out.write(descriptions[i].getData(), descriptions[i].getSize());
+            out.write(states[i].getData(), states[i].getSize());
+        }
+
+        out.flush();
+        if (out.getStatus().failed())
+        {
+            DBG("Failed to write chain state: " << out.getStatus().getErrorMessage());
+            return false;
+        }
+    }
+
+    if (!temp.overwriteTargetFileWithTemporary())
+    {
+        DBG("Failed to replace " << file.getFullPathName());
+        return false;
+    }
+
+    DBG("Wrote " << (int)plugins.size() << " plugins to " << file.getFileName()
+        << " (" << (juce::int64)offset << " bytes)");
+    return true;
+}
+
+//==============================================================================
+ChainStateFile::ChainStateFile(const juce::File& file)
+{
+    mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly, false);
+    data = static_cast<const char*>(mapped->getData());
+    size = mapped->getSize();
+
+    if (data == nullptr || size < (size_t)headerSize || std::memcmp(data, magic, sizeof(magic)) != 0)
+    {
+        DBG("Not a chain state file: " << file.getFullPathName());
+        return;
+    }
+
+    // Version 1 is the same without blobs
+    if (readUint32(data + 4) == 0 || readUint32(data + 4) > currentVersion)
+    {
+        DBG("Unsupported chain state version " << (int)readUint32(data + 4));
+        return;
+    }
+
+    numPlugins = (int)readUint32(data + 8);
+    epoch = readUint32(data + 12);
+    if (!isInFile((juce::uint64)headerSize, (juce::uint64)entrySize * (juce::uint64)numPlugins))
+    {
+        DBG("Chain state table is truncated");
+        numPlugins = 0;
+        return;
+    }
+
+    for (int i = 0; i < numPlugins; ++i)
+    {
+        auto entry = getEntry(i);
+        if (!isInFile(entry.descriptionOffset, entry.descriptionSize) || !isInFile(entry.stateOffset, entry.storedSize))
+        {
+            DBG("Chain state entry " << i << " points outside the file");
+            numPlugins = 0;
+            return;
+        }
+    }
+
+    valid = true;
+}
+
+bool ChainStateFile::read(int index, SavedPlugin& plugin, bool withState) const
+{
+    if (!valid || index < 0 || index >= numPlugins)
+        return false;
+
+    auto entry = getEntry(index);
+
+    auto xml = juce::parseXML(juce::String::fromUTF8(data + entry.descriptionOffset, (int)entry.descriptionSize));
+    if (xml == nullptr || !plugin.description.loadFromXml(*xml))
+    {
+        DBG("Failed to decode description of plugin " << index);
+        return false;
+    }
+
+    plugin.parallelWithPrevious = (entry.flags & parallelFlag) != 0;
+    plugin.bypassed = (entry.flags & bypassedFlag) != 0;
+    plugin.sandboxed = (entry.flags & sandboxedFlag) != 0;
+    plugin.state.reset();
+    plugin.stateBlob = {};
+
+    if ((entry.flags & blobFlag) != 0)
+    {
+        plugin.stateBlob = juce::String::fromUTF8(data + entry.stateOffset, (int)entry.storedSize);
+        return true;
+    }
+
+    if (!withState || entry.rawSize == 0)
+        return true;
+
+    if ((entry.flags & compressedFlag) == 0)
+    {
+        plugin.state.replaceWith(data + entry.stateOffset, (size_t)entry.storedSize);
+        return true;
+    }
+
+    juce::MemoryInputStream compressed(data + entry.stateOffset, (size_t)entry.storedSize, false);
+    juce::GZIPDecompressorInputStream inflater(compressed);
+
+    plugin.state.setSize((size_t)entry.rawSize);
+    if (inflater.read(plugin.state.getData(), (int)entry.rawSize) != (int)entry.rawSize)
+    {
+        DBG("Failed to inflate state of plugin " << index);
+        plugin.state.reset();
+        return false;
+    }
+
+    return true;
+}
+
+bool ChainStateFile::readAll(std::vector<SavedPlugin>& plugins) const
+{
+    if (!valid)
+        return false;
+
+    plugins.clear();
+    for (int i = 0; i < numPlugins; ++i)
+    {
+        SavedPlugin plugin;
+        plugin.slot = i;
+        if (read(i, plugin))
+            plugins.push_back(std::move(plugin));
+    }
+
+    return true;
+}
+
+ChainStateFile::Entry ChainStateFile::getEntry(int index) const
+{
+    auto* p = data + headerSize + (size_t)index * entrySize;
+
+    Entry entry;
+    entry.descriptionOffset = readUint64(p);
+    entry.descriptionSize = readUint32(p + 8);
+    entry.flags = readUint32(p + 12);
+    entry.stateOffset = readUint64(p + 16);
+    entry.storedSize = readUint64(p + 24);
+    entry.rawSize = readUint64(p + 32);
+    return entry;
+}
+
+bool ChainStateFile::isInFile(juce::uint64 offset, juce::uint64 length) const
+{
+    return offset <= size && length <= size - offset;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <JuceHeader.h>
+
+struct SavedPlugin;
+
+// Binary container for a saved chain, replacing the XML files with their
+// base64 state. All numbers are little-endian.
+//
+//   header   "VMCS", version, plugin count, epoch         4 x 4 bytes
+//   table    one entry per plugin                          40 bytes each
+//            description offset (8), description size (4), flags (4),
+//            state offset (8), stored state size (8), raw state size (8)
+//   payload  description XML and state bytes, as the table points to
+//
+// State is stored raw, or deflated at the fastest level when that saves
+// enough to be worth it. A plugin whose state lives in the blob store has the
+// blob's hash in place of its state. Reading maps the file and only touches
+// the chunks asked for, so nothing is parsed or copied beyond what's used.
+// The epoch identifies the snapshot to the parameter journal.
+class ChainStateFile
+{
+public:
+    static bool write(const juce::File& file, const std::vector<SavedPlugin>& plugins, bool compressState,
+        juce::uint32 snapshotEpoch = 0);
+
+    // Maps the file and checks the header and table
+    explicit ChainStateFile(const juce::File& file);
+
+    bool isValid() const { return valid; }
+    int getNumPlugins() const { return numPlugins; }
+    juce::uint32 getEpoch() const { return epoch; }
+
+    // Decodes one plugin; the state is only copied out if withState is set.
+    // Blob hashes are always filled in.
+    bool read(int index, SavedPlugin& plugin, bool withState = true) const;
+    bool readAll(std::vector<SavedPlugin>& plugins) const;
+
+private:
+    enum Flags
+    {
+        parallelFlag = 1,
+        bypassedFlag = 2,
+        sandboxedFlag = 4,
+        compressedFlag = 8,
+        blobFlag = 16
+    };
+
+    struct Entry
+    {
+        juce::uint64 descriptionOffset;
+        juce::uint32 descriptionSize;
+        juce::uint32 flags;
+        juce::uint64 stateOffset;
+        juce::uint64 storedSize;
+        juce::uint64 rawSize;
+    };
+
+    Entry getEntry(int index) const;
+    bool isInFile(juce::uint64 offset, juce::uint64 size) const;
+
+    std::unique_ptr<juce::MemoryMappedFile> mapped;
+    const char* data = nullptr;
+    size_t size = 0;
+    int numPlugins = 0;
+    juce::uint32 epoch = 0;
+    bool valid = false;
+
+    static constexpr int headerSize = 16;
+    static constexpr int entrySize = 40;
+    static constexpr juce::uint32 currentVersion = 2;
+
+    // Smaller states aren't worth compressing
+    static constexpr size_t minSizeToCompress = 4096;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChainStateFile)
+};
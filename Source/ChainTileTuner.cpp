@@ -0,0 +1,231 @@
+#include "ChainTileTuner.h"
+#include "PluginChain.h"
+#include "PluginWarmup.h"
+#include "SandboxedPlugin.h"
+#include "TileSizeTuner.h"
+
+ChainTileTuner::ChainTileTuner(juce::AudioPluginFormatManager& formatManagerToUse, PluginScanCache& scanCacheToUse)
+    : juce::Thread("Tile Tuner"),
+    formatManager(formatManagerToUse),
+    scanCache(scanCacheToUse)
+{
+    startThread();
+}
+
+ChainTileTuner::~ChainTileTuner()
+{
+    stopTimer();
+    stopThread(5000);
+}
+
+void ChainTileTuner::chainChanged(PluginChain& chain)
+{
+    const auto now = juce::Time::getMillisecondCounter();
+
+    for (auto& request : requests)
+    {
+        if (request.chain == &chain)
+        {
+            request.time = now;
+            return;
+        }
+    }
+
+    requests.push_back({ &chain, now });
+    startTimer(tickIntervalMs);
+}
+
+void ChainTileTuner::forget(PluginChain& chain)
+{
+    requests.erase(std::remove_if(requests.begin(), requests.end(),
+        [&chain](const Request& request) { return request.chain == &chain; }), requests.end());
+
+    if (job != nullptr && job->chain == &chain)
+    {
+        // Copies still being made can go now; a timing run has to finish first
+        if (stage.load() == Stage::copying)
+            job.reset();
+        else
+            job->chain = nullptr;
+    }
+}
+
+void ChainTileTuner::timerCallback()
+{
+    if (job != nullptr)
+    {
+        switch (stage.load())
+        {
+            case Stage::copying:    copyNext(); break;
+            case Stage::timed:      finish(); break;
+            case Stage::timing:     break;
+        }
+
+        return;
+    }
+
+    // Wait until the chain has been left alone for a moment
+    const auto now = juce::Time::getMillisecondCounter();
+    for (auto it = requests.begin(); it != requests.end(); ++it)
+    {
+        if (now - it->time >= quietTimeMs)
+        {
+            auto& chain = *it->chain;
+            requests.erase(it);
+            start(chain);
+            return;
+        }
+    }
+
+    if (requests.empty())
+        stopTimer();
+}
+
+void ChainTileTuner::start(PluginChain& chain)
+{
+    auto next = std::make_unique<Job>();
+    next->chain = &chain;
+    next->generation = chain.getTuningGeneration();
+    next->sampleRate = chain.getSampleRate();
+    next->blockSize = chain.getMaximumBlockSize();
+    next->numChannels = chain.getNumChannels();
+
+    for (auto& plugin : chain.getPlugins())
+    {
+        if (plugin == nullptr || plugin->processor == nullptr)
+            continue;
+
+        if (dynamic_cast<SandboxedPlugin*>(plugin->processor.get()) != nullptr)
+        {
+            DBG("Not tiling a chain with sandboxed plugins");
+            chain.setTunedTileSize(0, next->generation);
+            return;
+        }
+
+        SavedPlugin saved;
+        saved.description = plugin->processor->getPluginDescription();
+        saved.bypassed = plugin->bypassed.load();
+        plugin->processor->getStateInformation(saved.state);
+        next->saved.push_back(std::move(saved));
+    }
+
+    if (next->saved.empty() || next->blockSize <= 0)
+    {
+        chain.setTunedTileSize(0, next->generation);
+        return;
+    }
+
+    job = std::move(next);
+    stage = Stage::copying;
+}
+
+void ChainTileTuner::copyNext()
+{
+    const auto index = job->copies.size();
+    auto copy = Settings::createPlugin(job->saved[index], formatManager, scanCache, job->sampleRate, job->blockSize);
+
+    if (copy == nullptr)
+    {
+        // Leave the chain with what it had
+        DBG("Couldn't copy " << job->saved[index].description.name << " to tune cache tiles");
+        job.reset();
+        return;
+    }
+
+    job->copies.push_back(std::move(copy));
+
+    if (job->copies.size() == job->saved.size())
+    {
+        stage = Stage::timing;
+        notify();
+    }
+}
+
+void ChainTileTuner::finish()
+{
+    if (job->chain != nullptr)
+    {
+        DBG("Tuned cache tiles to " << job->tileSize << " samples for a " << job->blockSize << " sample block");
+        job->chain->setTunedTileSize(job->tileSize, job->generation);
+    }
+
+    // The copies go here, on the message thread they were made on
+    job.reset();
+    stage = Stage::copying;
+}
+
+void ChainTileTuner::run()
+{
+    while (!threadShouldExit())
+    {
+        if (stage.load() != Stage::timing)
+        {
+            wait(-1);
+            continue;
+        }
+
+        job->tileSize = timeTiles(*job);
+        stage = Stage::timed;
+    }
+}
+
+// The same order of work as PluginChain::processTiles: every plugin over
+// one tile before the next tile starts.
+int ChainTileTuner::timeTiles(Job& timedJob)
+{
+    auto numChannels = juce::jmax(1, timedJob.numChannels);
+    for (auto& copy : timedJob.copies)
+        numChannels = juce::jmax(numChannels, copy->processor->getTotalNumInputChannels(),
+            copy->processor->getTotalNumOutputChannels());
+
+    const auto blockSize = timedJob.blockSize;
+
+    // Silence would flatter plugins that skip work on it
+    juce::AudioBuffer<float> noise(numChannels, blockSize);
+    juce::Random random;
+    for (int channel = 0; channel < numChannels; ++channel)
+        for (int i = 0; i < blockSize; ++i)
+            noise.setSample(channel, i, (random.nextFloat() * 2.0f - 1.0f) * noiseLevel);
+
+    ProcessingContext context;
+    context.prepare(numChannels, blockSize);
+
+    for (auto& copy : timedJob.copies)
+        PluginWarmup::preroll(*copy, warmupBlocks, blockSize);
+
+    TileSizeTuner tuner;
+    tuner.restart();
+
+    const auto deadline = juce::Time::getMillisecondCounterHiRes() + maxTimingMs;
+    while (tuner.isTuning() && juce::Time::getMillisecondCounterHiRes() < deadline && !threadShouldExit())
+    {
+        const auto tileSize = tuner.getTileSize();
+        const auto tileSamples = tileSize > 0 ? tileSize : blockSize;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            context.audio.copyFrom(channel, 0, noise, channel, 0, blockSize);
+
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+
+        for (int offset = 0; offset < blockSize; offset += tileSamples)
+        {
+            auto& tile = context.getTile(offset, juce::jmin(tileSamples, blockSize - offset));
+
+            for (auto& copy : timedJob.copies)
+            {
+                if (copy->bypassed.load())
+                    continue;
+
+                context.midi.clear();
+                copy->processor->processBlock(tile, context.midi);
+            }
+        }
+
+        tuner.addMeasurement(juce::Time::getHighResolutionTicks() - startTicks, blockSize);
+    }
+
+    if (tuner.isTuning())
+        tuner.finish();
+
+    return tuner.getTileSize();
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <JuceHeader.h>
+#include "Settings.h"
+#include "PluginScanCache.h"
+
+class PluginChain;
+
+// Finds the tile size each chain runs fastest at, without going near the
+// chain itself. Once a chain has been left alone for a moment after an edit,
+// its plugins are copied: created afresh with the state the originals have
+// now, on the message thread since that's where in-process plugins have to
+// be made, one per tick so the UI keeps running. A thread of its own then
+// times the copies over tiles of noise at the chain's block size, and the
+// winner goes back to the chain on the message thread. Nothing of this is
+// heard, or shows up in the chain's timing or the watchdog.
+//
+// The copies run one after the other even where the chain runs them side by
+// side; what matters is how a tile fits in cache, which that doesn't change.
+// Chains with sandboxed plugins aren't tiled, since every tile would be a
+// round trip to another process. Chains are tuned one at a time.
+class ChainTileTuner : private juce::Thread,
+    private juce::Timer
+{
+public:
+    ChainTileTuner(juce::AudioPluginFormatManager& formatManager, PluginScanCache& scanCache);
+    ~ChainTileTuner() override;
+
+    // Message thread. The chain's plugins, or what it's prepared for, changed.
+    void chainChanged(PluginChain& chain);
+
+    // Message thread. The chain is going away; a result for it is dropped.
+    void forget(PluginChain& chain);
+
+private:
+    struct Request
+    {
+        PluginChain* chain = nullptr;
+        juce::uint32 time = 0;
+    };
+
+    enum class Stage
+    {
+        copying,
+        timing,
+        timed
+    };
+
+    struct Job
+    {
+        // Null once the chain has been forgotten
+        PluginChain* chain = nullptr;
+        juce::uint64 generation = 0;
+
+        double sampleRate = 0.0;
+        int blockSize = 0;
+        int numChannels = 0;
+
+        std::vector<SavedPlugin> saved;
+        std::vector<std::unique_ptr<PluginInstance>> copies;
+        int tileSize = 0;
+    };
+
+    void timerCallback() override;
+    void run() override;
+
+    void start(PluginChain& chain);
+    void copyNext();
+    void finish();
+    int timeTiles(Job& timedJob);
+
+    juce::AudioPluginFormatManager& formatManager;
+    PluginScanCache& scanCache;
+
+    std::vector<Request> requests;
+    std::unique_ptr<Job> job;
+
+    // The thread has the job to itself while it's timing
+    std::atomic<Stage> stage { Stage::copying };
+
+    static constexpr int tickIntervalMs = 100;
+    static constexpr juce::uint32 quietTimeMs = 1000;
+    static constexpr double maxTimingMs = 1000.0;
+    static constexpr int warmupBlocks = 16;
+    static constexpr float noiseLevel = 0.1f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChainTileTuner)
+};
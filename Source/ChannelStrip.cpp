@@ -0,0 +1,341 @@
+#include "ChannelStrip.h"
+
+ChannelStrip::ChannelStrip(int firstInputChannel, int numInputChannels)
+    : firstInput(juce::jmax(0, firstInputChannel)),
+    numInputs(juce::jmax(0, numInputChannels))
+{
+    for (auto& published : publishedScenes)
+        published.store(nullptr);
+
+    addScene("Main", 0);
+}
+
+void ChannelStrip::prepare(double sampleRate, int maximumBlockSize, int numDeviceChannels)
+{
+    auto numChannels = numInputs == 0 ? numDeviceChannels : juce::jmax(2, numInputs);
+
+    context.prepare(numChannels, maximumBlockSize);
+    standbyContext.prepare(numChannels, maximumBlockSize);
+
+    currentSampleRate = sampleRate;
+    currentBlockSize = maximumBlockSize;
+
+    for (int i = 0; i < maxScenes; ++i)
+    {
+        if (auto& scene = scenes[(size_t)i])
+        {
+            scene->chain.setPipelineActive(i == activeScene);
+            scene->chain.prepare(sampleRate, maximumBlockSize, context.numChannels);
+        }
+    }
+
+    fadeLength = juce::jmax(1, juce::roundToInt(sceneFadeSeconds * sampleRate));
+    fadeCurve.resize((size_t)fadeLength + 1);
+    for (int i = 0; i <= fadeLength; ++i)
+        fadeCurve[(size_t)i] = std::sin(juce::MathConstants<float>::halfPi * (float)i / (float)fadeLength);
+
+    // Whatever was going on before the device stopped is over
+    playingScene = activeScene;
+    requestedScene = activeScene;
+    fadingOutScene = -1;
+    audibleScene = activeScene;
+    audibleFadingOut = -1;
+    prepared = true;
+}
+
+void ChannelStrip::release()
+{
+    prepared = false;
+    audibleScene = activeScene;
+    audibleFadingOut = -1;
+
+    for (auto& scene : scenes)
+        if (scene != nullptr)
+            scene->chain.release();
+}
+
+juce::String ChannelStrip::getName(int index) const
+{
+    juce::String name("Strip " + juce::String(index + 1));
+
+    if (numInputs == 1)
+        name << " (in " << firstInput + 1 << ")";
+    else if (numInputs > 1)
+        name << " (in " << firstInput + 1 << "-" << firstInput + numInputs << ")";
+
+    return name;
+}
+
+//==============================================================================
+void ChannelStrip::setChainSetup(std::function<void(PluginChain&, int)> setup)
+{
+    chainSetup = std::move(setup);
+
+    for (int i = 0; i < maxScenes; ++i)
+        if (scenes[(size_t)i] != nullptr && chainSetup)
+            chainSetup(scenes[(size_t)i]->chain, i);
+}
+
+void ChannelStrip::forEachChain(const std::function<void(PluginChain&)>& callback)
+{
+    for (auto& scene : scenes)
+        if (scene != nullptr)
+            callback(scene->chain);
+}
+
+bool ChannelStrip::isSceneInUse(int scene) const
+{
+    return scene >= 0 && scene < maxScenes && scenes[(size_t)scene] != nullptr && scenes[(size_t)scene]->inUse;
+}
+
+juce::String ChannelStrip::getSceneName(int scene) const
+{
+    return isSceneInUse(scene) ? scenes[(size_t)scene]->name : juce::String();
+}
+
+int ChannelStrip::addScene(const juce::String& name, int slot)
+{
+    if (slot < 0)
+        for (int i = 0; i < maxScenes && slot < 0; ++i)
+            if (!isSceneInUse(i))
+                slot = i;
+
+    if (slot < 0 || slot >= maxScenes || isSceneInUse(slot))
+        return -1;
+
+    // Slots are reused, so a removed scene's chain is already there and hooked up
+    if (scenes[(size_t)slot] == nullptr)
+    {
+        auto scene = std::make_unique<Scene>();
+        if (chainSetup)
+            chainSetup(scene->chain, slot);
+        scene->chain.setPipelineActive(slot == activeScene);
+        if (prepared)
+            scene->chain.prepare(currentSampleRate, currentBlockSize, context.numChannels);
+
+        publishedScenes[(size_t)slot].store(scene.get(), std::memory_order_release);
+        scenes[(size_t)slot] = std::move(scene);
+    }
+
+    auto& scene = *scenes[(size_t)slot];
+    scene.name = name;
+    scene.inUse = true;
+    scene.loaded = true;
+    scene.lastActive = juce::Time::getMillisecondCounter();
+    return slot;
+}
+
+void ChannelStrip::renameScene(int scene, const juce::String& name)
+{
+    if (isSceneInUse(scene) && name.isNotEmpty())
+        scenes[(size_t)scene]->name = name;
+}
+
+void ChannelStrip::removeScene(int scene)
+{
+    if (!isSceneInUse(scene) || scene == activeScene)
+        return;
+
+    unloadScene(scene);
+    scenes[(size_t)scene]->inUse = false;
+    scenes[(size_t)scene]->name = {};
+}
+
+void ChannelStrip::setActiveScene(int scene)
+{
+    if (!isSceneInUse(scene) || scene == activeScene)
+        return;
+
+    jassert(isSceneLoaded(scene));
+
+    const auto now = juce::Time::getMillisecondCounter();
+    scenes[(size_t)activeScene]->lastActive = now;
+    scenes[(size_t)scene]->lastActive = now;
+
+    // Its workers have to be running before the audio thread can see the switch
+    scenes[(size_t)scene]->chain.setPipelineActive(true);
+
+    activeScene = scene;
+    requestedScene.store(scene, std::memory_order_release);
+
+    // Nothing to fade while the device is stopped
+    if (!prepared)
+    {
+        playingScene = scene;
+        audibleScene = scene;
+    }
+}
+
+bool ChannelStrip::isSceneAudible(int scene) const
+{
+    return scene == activeScene || scene == audibleScene.load() || scene == audibleFadingOut.load();
+}
+
+void ChannelStrip::releaseIdlePipelines()
+{
+    for (int i = 0; i < maxScenes; ++i)
+        if (scenes[(size_t)i] != nullptr && !isSceneAudible(i))
+            scenes[(size_t)i]->chain.setPipelineActive(false);
+}
+
+bool ChannelStrip::isSceneLoaded(int scene) const
+{
+    return isSceneInUse(scene) && scenes[(size_t)scene]->loaded;
+}
+
+void ChannelStrip::unloadScene(int scene)
+{
+    if (!isSceneInUse(scene) || scene == activeScene)
+        return;
+
+    auto& chain = scenes[(size_t)scene]->chain;
+    for (auto& plugin : chain.getPlugins())
+        if (plugin->editorWindow != nullptr)
+            delete plugin->editorWindow.getComponent();
+
+    // The plugins are released once the standby passes have faded them out
+    chain.setPlugins({});
+    scenes[(size_t)scene]->loaded = false;
+}
+
+size_t ChannelStrip::getSceneMemoryBytes(int scene) const
+{
+    if (!isSceneInUse(scene))
+        return 0;
+
+    size_t bytes = 0;
+    for (auto& plugin : scenes[(size_t)scene]->chain.getPlugins())
+        bytes += plugin->loadedBytes + juce::jmax(plugin->lastSavedState.getSize(), plugin->lastSavedBlobBytes);
+
+    return bytes;
+}
+
+//==============================================================================
+void ChannelStrip::process(const float** inputChannelData, int numInputChannels,
+    int offset, int numSamples) noexcept
+{
+    for (int channel = 0; channel < context.numChannels; ++channel)
+    {
+        auto input = numInputs == 0 ? channel : firstInput + channel % numInputs;
+
+        if (input < numInputChannels && inputChannelData[input] != nullptr)
+            context.audio.copyFrom(channel, 0, inputChannelData[input] + offset, numSamples);
+        else
+            context.audio.clear(channel, 0, numSamples);
+    }
+
+    processScenes(context, numSamples);
+}
+
+void ChannelStrip::processScenes(ProcessingContext& blockContext, int numSamples) noexcept
+{
+    // Switches land on a block boundary, one fade at a time
+    const auto requested = requestedScene.load(std::memory_order_acquire);
+    if (requested != playingScene && fadingOutScene < 0
+        && publishedScenes[(size_t)requested].load(std::memory_order_acquire) != nullptr)
+    {
+        fadingOutScene = playingScene;
+        playingScene = requested;
+        fadePosition = 0;
+    }
+
+    auto* playing = publishedScenes[(size_t)playingScene].load(std::memory_order_acquire);
+    auto* fadingOut = fadingOutScene >= 0 ? publishedScenes[(size_t)fadingOutScene].load(std::memory_order_acquire)
+                                          : nullptr;
+
+    // The outgoing scene hears the same input until it's faded out
+    if (fadingOut != nullptr)
+        for (int channel = 0; channel < standbyContext.numChannels; ++channel)
+            standbyContext.audio.copyFrom(channel, 0, blockContext.audio, channel, 0, numSamples);
+
+    playing->chain.process(blockContext, numSamples);
+
+    if (fadingOut != nullptr)
+    {
+        fadingOut->chain.process(standbyContext, numSamples);
+        crossfade(blockContext.audio, standbyContext.audio, numSamples);
+    }
+    else
+    {
+        fadingOutScene = -1;
+    }
+
+    keepStandbyWarm(numSamples);
+
+    audibleScene.store(playingScene, std::memory_order_relaxed);
+    audibleFadingOut.store(fadingOutScene, std::memory_order_release);
+}
+
+void ChannelStrip::crossfade(juce::AudioBuffer<float>& incoming, const juce::AudioBuffer<float>& outgoing,
+    int numSamples) noexcept
+{
+    const auto numFadeSamples = juce::jmin(numSamples, fadeLength - fadePosition);
+
+    for (int channel = 0; channel < context.numChannels; ++channel)
+    {
+        auto* in = incoming.getWritePointer(channel);
+        auto* out = outgoing.getReadPointer(channel);
+
+        for (int i = 0; i < numFadeSamples; ++i)
+        {
+            const auto position = fadePosition + i;
+            in[i] = in[i] * fadeCurve[(size_t)position] + out[i] * fadeCurve[(size_t)(fadeLength - position)];
+        }
+    }
+
+    fadePosition += numFadeSamples;
+    if (fadePosition >= fadeLength)
+        fadingOutScene = -1;
+}
+
+// Every few blocks one stage of one standby scene runs over silence, the
+// scenes taking turns. The rest of them only tick over, which is all their
+// chains need to let go of what they've retired.
+void ChannelStrip::keepStandbyWarm(int numSamples) noexcept
+{
+    int warmScene = -1;
+
+    // The standby context is the outgoing scene's while a crossfade runs
+    if (++blocksSinceStandby >= standbyIntervalBlocks && fadingOutScene < 0)
+    {
+        blocksSinceStandby = 0;
+
+        for (int i = 0; i < maxScenes && warmScene < 0; ++i)
+        {
+            const auto scene = (nextStandbyScene + i) % maxScenes;
+            if (scene != playingScene && publishedScenes[(size_t)scene].load(std::memory_order_acquire) != nullptr)
+                warmScene = scene;
+        }
+
+        if (warmScene >= 0)
+            nextStandbyScene = (warmScene + 1) % maxScenes;
+    }
+
+    for (int scene = 0; scene < maxScenes; ++scene)
+    {
+        auto* standby = publishedScenes[(size_t)scene].load(std::memory_order_acquire);
+        if (standby == nullptr || scene == playingScene || scene == fadingOutScene)
+            continue;
+
+        if (scene == warmScene)
+        {
+            for (int channel = 0; channel < standbyContext.numChannels; ++channel)
+                standbyContext.audio.clear(channel, 0, numSamples);
+
+            standby->chain.warmNextStage(standbyContext, numSamples);
+        }
+        else
+        {
+            standby->chain.skipBlock();
+        }
+    }
+}
+
+void ChannelStrip::addToOutput(float** outputChannelData, int numOutputChannels,
+    int offset, int numSamples) const noexcept
+{
+    for (int channel = 0; channel < juce::jmin(numOutputChannels, context.numChannels); ++channel)
+        if (outputChannelData[channel] != nullptr)
+            juce::FloatVectorOperations::add(outputChannelData[channel] + offset,
+                context.audio.getReadPointer(channel), numSamples);
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PluginChain.h"
+#include "ProcessingContext.h"
+
+// One mic's worth of processing: a set of device inputs feeding its own
+// plugin chain. Strips share nothing on the audio thread, so the device
+// callback can run them side by side on the worker pool and mix the results.
+//
+// A strip can hold several named scenes, each a complete chain of its own
+// that stays instantiated and prepared while another one plays. Switching
+// scenes takes effect at the start of the next block with a short
+// equal-power crossfade, the outgoing chain still running on the live input
+// until it's faded out. In between, standby chains are kept warm by running
+// one stage of one of them over a block of silence every few blocks, which
+// also lets them fade out and retire plugins that were removed from them.
+class ChannelStrip
+{
+public:
+    // With numInputChannels of 0 the strip takes every device input, channel
+    // for channel. Otherwise it reads that many inputs from firstInputChannel,
+    // spreading a mono input across a stereo chain.
+    ChannelStrip(int firstInputChannel, int numInputChannels);
+
+    //==============================================================================
+    // Message thread
+    void prepare(double sampleRate, int maximumBlockSize, int numDeviceChannels);
+    void release();
+
+    juce::String getName(int index) const;
+
+    // The active scene's chain, which is the one playing and being edited
+    PluginChain& getChain() { return getChain(activeScene); }
+    PluginChain& getChain(int scene) { return scenes[(size_t)scene]->chain; }
+    ProcessingContext& getContext() { return context; }
+
+    //==============================================================================
+    // Scenes, by slot. Slot 0 always exists and is the strip's original chain.
+    static constexpr int maxScenes = 8;
+
+    // Identifies a scene's chain to the journal; the first scene keeps the strip's index
+    static int getChainId(int strip, int scene) { return strip + (scene << 8); }
+
+    // Hooks up every scene's chain as it's created, including the existing ones
+    void setChainSetup(std::function<void(PluginChain& chain, int scene)> setup);
+    void forEachChain(const std::function<void(PluginChain& chain)>& callback);
+
+    bool isSceneInUse(int scene) const;
+    juce::String getSceneName(int scene) const;
+    int getActiveScene() const { return activeScene; }
+
+    // Returns the slot, or -1 if there's none free. The new scene is empty
+    // and counts as loaded.
+    int addScene(const juce::String& name, int slot = -1);
+    void renameScene(int scene, const juce::String& name);
+
+    // Drops the scene's plugins and frees the slot; the active one can't go
+    void removeScene(int scene);
+
+    // Switches on the next block boundary. A switch asked for while a
+    // crossfade is running waits for it to finish.
+    void setActiveScene(int scene);
+
+    // An unloaded scene keeps its slot and saved chain but has no plugins;
+    // it has to be loaded again before it can play
+    bool isSceneLoaded(int scene) const;
+    void setSceneLoaded(int scene, bool isLoaded) { scenes[(size_t)scene]->loaded = isLoaded; }
+    void unloadScene(int scene);
+
+    // Whether the audio thread may still be running the scene into the
+    // output: it's playing, fading out, or about to be switched to. Such a
+    // scene mustn't be unloaded yet.
+    bool isSceneAudible(int scene) const;
+
+    // Message thread, every now and then. Stops the pipeline workers of scenes
+    // that are no longer heard; a scene gets them back when it's switched to.
+    void releaseIdlePipelines();
+
+    // When the scene last stopped playing, for picking which one to unload
+    juce::uint32 getSceneLastActive(int scene) const { return scenes[(size_t)scene]->lastActive; }
+
+    // Rough memory cost of keeping the scene loaded: what the process grew by
+    // as its plugins loaded, plus their saved state, wherever that's kept
+    size_t getSceneMemoryBytes(int scene) const;
+
+    //==============================================================================
+    // Audio thread. process() may run on any pool thread; addToOutput() is
+    // called by the device thread once every strip has finished.
+    void process(const float** inputChannelData, int numInputChannels, int offset, int numSamples) noexcept;
+    void addToOutput(float** outputChannelData, int numOutputChannels, int offset, int numSamples) const noexcept;
+
+    // Runs the scenes over audio that's already in the context, for callers
+    // that stage the input themselves
+    void processScenes(ProcessingContext& blockContext, int numSamples) noexcept;
+
+private:
+    struct Scene
+    {
+        PluginChain chain;
+        juce::String name;
+        bool inUse = false;
+        bool loaded = true;
+        juce::uint32 lastActive = 0;
+    };
+
+    void crossfade(juce::AudioBuffer<float>& incoming, const juce::AudioBuffer<float>& outgoing,
+        int numSamples) noexcept;
+    void keepStandbyWarm(int numSamples) noexcept;
+
+    const int firstInput;
+    const int numInputs;
+
+    ProcessingContext context;
+
+    // Where the outgoing scene runs during a crossfade, and standby scenes
+    // run their silence otherwise
+    ProcessingContext standbyContext;
+
+    // Created on the message thread and only destroyed with the strip. The
+    // audio thread sees a scene once it's been published, fully set up.
+    std::array<std::unique_ptr<Scene>, maxScenes> scenes;
+    std::array<std::atomic<Scene*>, maxScenes> publishedScenes;
+    std::function<void(PluginChain&, int)> chainSetup;
+
+    int activeScene = 0;
+    std::atomic<int> requestedScene { 0 };
+
+    bool prepared = false;
+    double currentSampleRate = 0.0;
+    int currentBlockSize = 0;
+
+    // Audio thread only, apart from prepare()
+    int playingScene = 0;
+    int fadingOutScene = -1;
+    int fadePosition = 0;
+    int fadeLength = 1;
+    int blocksSinceStandby = 0;
+    int nextStandbyScene = 0;
+
+    // What the audio thread is playing, for the message thread to look at
+    std::atomic<int> audibleScene { 0 };
+    std::atomic<int> audibleFadingOut { -1 };
+
+    // sin over a quarter turn; read backwards it's the matching cos
+    std::vector<float> fadeCurve;
+
+    static constexpr double sceneFadeSeconds = 0.02;
+    static constexpr int standbyIntervalBlocks = 4;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChannelStrip)
+};
@@ -0,0 +1,264 @@
+#include "EngineOptionsComponent.h"
+
+EngineOptionsComponent::EngineOptionsComponent(EngineOptions& optionsToEdit)
+    : options(optionsToEdit)
+{
+    const auto whitish = juce::Colour(230, 230, 230);
+
+    addRow(pipelineLabel, pipelineBox, "Pipeline");
+    pipelineBox.addItem("Off", 1);
+    for (int segments = 2; segments <= 4; ++segments)
+        pipelineBox.addItem(juce::String(segments) + " cores (+" + juce::String(segments - 1) + " block latency)", segments);
+    pipelineBox.setSelectedId(options.pipelineSegments, juce::dontSendNotification);
+    pipelineBox.onChange = [this]
+    {
+        options.pipelineSegments = pipelineBox.getSelectedId();
+        if (onOptionsChanged)
+            onOptionsChanged();
+    };
+
+    // Item ids are the block size, except Off which can't use 0
+    addRow(blockSizeLabel, blockSizeBox, "Fixed block size");
+    blockSizeBox.addItem("Off (device blocks)", 1);
+    for (int size = 32; size <= 1024; size *= 2)
+        blockSizeBox.addItem(juce::String(size) + " samples (+" + juce::String(size) + " latency)", size);
+    blockSizeBox.setSelectedId(options.fixedBlockSize > 0 ? options.fixedBlockSize : 1, juce::dontSendNotification);
+    blockSizeBox.onChange = [this]
+    {
+        auto id = blockSizeBox.getSelectedId();
+        options.fixedBlockSize = id > 1 ? id : 0;
+        if (onOptionsChanged)
+            onOptionsChanged();
+    };
+
+    // Ids: 1 is off, 2 is automatic, anything else is the tile size
+    addRow(tileSizeLabel, tileSizeBox, "Cache tiles");
+    tileSizeBox.addItem("Off (whole blocks)", 1);
+    tileSizeBox.addItem("Automatic", 2);
+    for (int size = 32; size <= 512; size *= 2)
+        tileSizeBox.addItem(juce::String(size) + " samples", size);
+    tileSizeBox.setSelectedId(options.tileSize < 0 ? 2 : options.tileSize > 0 ? options.tileSize : 1,
+        juce::dontSendNotification);
+    tileSizeBox.onChange = [this]
+    {
+        auto id = tileSizeBox.getSelectedId();
+        options.tileSize = id == 2 ? -1 : id > 2 ? id : 0;
+        if (onOptionsChanged)
+            onOptionsChanged();
+    };
+
+    addRow(stripsLabel, stripsBox, "Channel strips");
+    for (int strips = 1; strips <= 4; ++strips)
+        stripsBox.addItem(strips == 1 ? juce::String("1 (all inputs)") : juce::String(strips), strips);
+    stripsBox.setSelectedId(options.numStrips, juce::dontSendNotification);
+    stripsBox.onChange = [this]
+    {
+        options.numStrips = stripsBox.getSelectedId();
+        if (onOptionsChanged)
+            onOptionsChanged();
+    };
+
+    addRow(stripWidthLabel, stripWidthBox, "Inputs per strip");
+    stripWidthBox.addItem("1 (mono mic)", 1);
+    stripWidthBox.addItem("2 (stereo pair)", 2);
+    stripWidthBox.setSelectedId(options.channelsPerStrip, juce::dontSendNotification);
+    stripWidthBox.onChange = [this]
+    {
+        options.channelsPerStrip = stripWidthBox.getSelectedId();
+        if (onOptionsChanged)
+            onOptionsChanged();
+    };
+
+    addRow(standbyLabel, standbyBox, "Standby scenes");
+    standbyBox.addItem("None (load on switch)", 1);
+    for (int scenes = 1; scenes <= 7; ++scenes)
+        standbyBox.addItem(juce::String(scenes) + " per strip", scenes + 1);
+    standbyBox.setSelectedId(options.maxStandbyScenes + 1, juce::dontSendNotification);
+    standbyBox.onChange = [this]
+    {
+        options.maxStandbyScenes = standbyBox.getSelectedId() - 1;
+        if (onOptionsChanged)
+            onOptionsChanged();
+    };
+
+    // Ids are the number of blocks, except Off; engine.xml takes any count
+    addRow(warmupLabel, warmupBox, "Plugin warm-up");
+    warmupBox.addItem("Off", 1);
+    for (int blocks = 4; blocks <= 64; blocks *= 2)
+        warmupBox.addItem(juce::String(blocks) + " silent blocks", blocks);
+    if (options.warmupBlocks > 1 && warmupBox.indexOfItemId(options.warmupBlocks) < 0)
+        warmupBox.addItem(juce::String(options.warmupBlocks) + " silent blocks", options.warmupBlocks);
+    warmupBox.setSelectedId(options.warmupBlocks > 1 ? options.warmupBlocks : 1, juce::dontSendNotification);
+    warmupBox.onChange = [this]
+    {
+        auto id = warmupBox.getSelectedId();
+        options.warmupBlocks = id > 1 ? id : 0;
+        if (onOptionsChanged)
+            onOptionsChanged();
+    };
+
+    // Priorities come from engine.xml; the panel only switches the policy
+    addRow(schedulingLabel, schedulingBox, "Real-time policy");
+    schedulingBox.addItem("Driver default", 1);
+    schedulingBox.addItem("SCHED_FIFO", 2);
+    schedulingBox.addItem("SCHED_FIFO, pinned to cores", 3);
+    schedulingBox.addItem("Driver default, pinned to cores", 4);
+    schedulingBox.setSelectedId(!options.realtime.realtimeScheduling ? (options.realtime.pinThreads ? 4 : 1)
+                                                                     : (options.realtime.pinThreads ? 3 : 2),
+        juce::dontSendNotification);
+    schedulingBox.onChange = [this]
+    {
+        auto id = schedulingBox.getSelectedId();
+        options.realtime.realtimeScheduling = id == 2 || id == 3;
+        options.realtime.pinThreads = id == 3 || id == 4;
+        if (onOptionsChanged)
+            onOptionsChanged();
+    };
+
+    addAndMakeVisible(dmaLatencyToggle);
+    dmaLatencyToggle.setColour(juce::ToggleButton::textColourId, whitish);
+    dmaLatencyToggle.setColour(juce::ToggleButton::tickColourId, whitish);
+    dmaLatencyToggle.setToggleState(options.realtime.holdCpuDmaLatency, juce::dontSendNotification);
+    dmaLatencyToggle.onClick = [this]
+    {
+        options.realtime.holdCpuDmaLatency = dmaLatencyToggle.getToggleState();
+        if (onOptionsChanged)
+            onOptionsChanged();
+    };
+
+    // Otherwise the output stays silent until the whole chain is back
+    addAndMakeVisible(progressiveRestoreToggle);
+    progressiveRestoreToggle.setColour(juce::ToggleButton::textColourId, whitish);
+    progressiveRestoreToggle.setColour(juce::ToggleButton::tickColourId, whitish);
+    progressiveRestoreToggle.setToggleState(options.progressiveRestore, juce::dontSendNotification);
+    progressiveRestoreToggle.onClick = [this]
+    {
+        options.progressiveRestore = progressiveRestoreToggle.getToggleState();
+        if (onOptionsChanged)
+            onOptionsChanged();
+    };
+
+    addAndMakeVisible(compressStateToggle);
+    compressStateToggle.setColour(juce::ToggleButton::textColourId, whitish);
+    compressStateToggle.setColour(juce::ToggleButton::tickColourId, whitish);
+    compressStateToggle.setToggleState(options.compressPluginState, juce::dontSendNotification);
+    compressStateToggle.onClick = [this]
+    {
+        options.compressPluginState = compressStateToggle.getToggleState();
+        if (onOptionsChanged)
+            onOptionsChanged();
+    };
+
+    // Ids are the budget multiple, except Off; strikes come from engine.xml
+    addRow(watchdogLabel, watchdogBox, "Hang watchdog");
+    watchdogBox.addItem("Off", 1);
+    for (int multiple = 2; multiple <= 16; multiple *= 2)
+        watchdogBox.addItem("Calls over " + juce::String(multiple) + "x the block budget", multiple);
+    watchdogBox.setSelectedId(options.watchdog.budgetMultiple > 1 ? options.watchdog.budgetMultiple : 1,
+        juce::dontSendNotification);
+    watchdogBox.onChange = [this]
+    {
+        auto id = watchdogBox.getSelectedId();
+        options.watchdog.budgetMultiple = id > 1 ? id : 0;
+        if (onOptionsChanged)
+            onOptionsChanged();
+    };
+
+    for (auto* button : { &exportTimingButton, &resetTimingButton })
+    {
+        button->setColour(juce::TextButton::buttonColourId, juce::Colour(60, 60, 60));
+        button->setColour(juce::TextButton::textColourOffId, whitish);
+        addAndMakeVisible(button);
+    }
+
+    exportTimingButton.onClick = [this] { if (onExportTiming) onExportTiming(); };
+    resetTimingButton.onClick = [this] { if (onResetTiming) onResetTiming(); };
+
+    addAndMakeVisible(statusLabel);
+    statusLabel.setColour(juce::Label::textColourId, whitish);
+    statusLabel.setJustificationType(juce::Justification::topLeft);
+}
+
+void EngineOptionsComponent::addRow(juce::Label& label, juce::Component& control, const juce::String& name)
+{
+    label.setText(name, juce::dontSendNotification);
+    label.setColour(juce::Label::textColourId, juce::Colour(230, 230, 230));
+    addAndMakeVisible(label);
+    addAndMakeVisible(control);
+
+    if (auto* box = dynamic_cast<juce::ComboBox*>(&control))
+        styleComboBox(*box);
+}
+
+void EngineOptionsComponent::styleComboBox(juce::ComboBox& box)
+{
+    box.setColour(juce::ComboBox::backgroundColourId, juce::Colour(40, 40, 40));
+    box.setColour(juce::ComboBox::textColourId, juce::Colour(230, 230, 230));
+    box.setColour(juce::ComboBox::arrowColourId, juce::Colour(230, 230, 230));
+    box.setColour(juce::ComboBox::outlineColourId, juce::Colour(60, 60, 60));
+}
+
+void EngineOptionsComponent::setStatusText(const juce::String& text)
+{
+    statusLabel.setText(text, juce::dontSendNotification);
+}
+
+void EngineOptionsComponent::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colour(40, 40, 40));
+}
+
+void EngineOptionsComponent::resized()
+{
+    auto area = getLocalBounds().reduced(10);
+
+    auto row = area.removeFromTop(rowHeight);
+    pipelineLabel.setBounds(row.removeFromLeft(150));
+    pipelineBox.setBounds(row.reduced(0, 3));
+
+    row = area.removeFromTop(rowHeight);
+    blockSizeLabel.setBounds(row.removeFromLeft(150));
+    blockSizeBox.setBounds(row.reduced(0, 3));
+
+    row = area.removeFromTop(rowHeight);
+    tileSizeLabel.setBounds(row.removeFromLeft(150));
+    tileSizeBox.setBounds(row.reduced(0, 3));
+
+    row = area.removeFromTop(rowHeight);
+    stripsLabel.setBounds(row.removeFromLeft(150));
+    stripsBox.setBounds(row.reduced(0, 3));
+
+    row = area.removeFromTop(rowHeight);
+    stripWidthLabel.setBounds(row.removeFromLeft(150));
+    stripWidthBox.setBounds(row.reduced(0, 3));
+
+    row = area.removeFromTop(rowHeight);
+    standbyLabel.setBounds(row.removeFromLeft(150));
+    standbyBox.setBounds(row.reduced(0, 3));
+
+    row = area.removeFromTop(rowHeight);
+    warmupLabel.setBounds(row.removeFromLeft(150));
+    warmupBox.setBounds(row.reduced(0, 3));
+
+    row = area.removeFromTop(rowHeight);
+    schedulingLabel.setBounds(row.removeFromLeft(150));
+    schedulingBox.setBounds(row.reduced(0, 3));
+
+    dmaLatencyToggle.setBounds(area.removeFromTop(rowHeight).withTrimmedLeft(150));
+
+    row = area.removeFromTop(rowHeight);
+    watchdogLabel.setBounds(row.removeFromLeft(150));
+    watchdogBox.setBounds(row.reduced(0, 3));
+
+    progressiveRestoreToggle.setBounds(area.removeFromTop(rowHeight).withTrimmedLeft(150));
+    compressStateToggle.setBounds(area.removeFromTop(rowHeight).withTrimmedLeft(150));
+
+    area.removeFromTop(10);
+    auto buttons = area.removeFromTop(rowHeight).reduced(0, 3);
+    exportTimingButton.setBounds(buttons.removeFromLeft(160));
+    buttons.removeFromLeft(10);
+    resetTimingButton.setBounds(buttons.removeFromLeft(110));
+
+    area.removeFromTop(10);
+    statusLabel.setBounds(area);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <JuceHeader.h>
+#include "Settings.h"
+
+// Panel for the engine options. Edits go straight into the EngineOptions it
+// was given; onOptionsChanged tells the owner to save and apply them.
+class EngineOptionsComponent : public juce::Component
+{
+public:
+    explicit EngineOptionsComponent(EngineOptions& optionsToEdit);
+
+    void setStatusText(const juce::String& text);
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+    std::function<void()> onOptionsChanged;
+    std::function<void()> onExportTiming;
+    std::function<void()> onResetTiming;
+
+private:
+    void addRow(juce::Label& label, juce::Component& control, const juce::String& name);
+    void styleComboBox(juce::ComboBox& box);
+
+    EngineOptions& options;
+
+    juce::Label pipelineLabel;
+    juce::ComboBox pipelineBox;
+    juce::Label blockSizeLabel;
+    juce::ComboBox blockSizeBox;
+    juce::Label tileSizeLabel;
+    juce::ComboBox tileSizeBox;
+    juce::Label stripsLabel;
+    juce::ComboBox stripsBox;
+    juce::Label stripWidthLabel;
+    juce::ComboBox stripWidthBox;
+    juce::Label standbyLabel;
+    juce::ComboBox standbyBox;
+    juce::Label warmupLabel;
+    juce::ComboBox warmupBox;
+    juce::Label schedulingLabel;
+    juce::ComboBox schedulingBox;
+    juce::ToggleButton dmaLatencyToggle { "Hold /dev/cpu_dma_latency while audio runs" };
+    juce::Label watchdogLabel;
+    juce::ComboBox watchdogBox;
+    juce::ToggleButton progressiveRestoreToggle { "Bring plugins in one at a time at startup" };
+    juce::ToggleButton compressStateToggle { "Compress large plugin states when saving" };
+
+    juce::TextButton exportTimingButton { "Export Timing CSV..." };
+    juce::TextButton resetTimingButton { "Reset Timing" };
+
+    juce::Label statusLabel;
+
+    static constexpr int rowHeight = 30;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EngineOptionsComponent)
+};
@@ -1,4 +1,6 @@
 #include "MainComponent.h"
+#include "SandboxHost.h"
+#include "PluginScanCache.h"
 
 class MainWindow : public juce::DocumentWindow
 {
@@ -38,18 +40,37 @@ public:
     const juce::String getApplicationName() override { return "VST Host"; }
     const juce::String getApplicationVersion() override { return "1.0.0"; }
 
-    void initialise(const juce::String&) override
+    void initialise(const juce::String& commandLine) override
     {
+        // Launched by the scan cache to look inside one plugin file
+        if (PluginScanCache::isScanCommandLine(commandLine))
+        {
+            setApplicationReturnValue(PluginScanCache::runScanner(commandLine));
+            quit();
+            return;
+        }
+
+        // Launched by the host to run one plugin out of process
+        if (SandboxHost::isSandboxCommandLine(commandLine))
+        {
+            sandboxHost = std::make_unique<SandboxHost>(commandLine);
+            if (!sandboxHost->isRunning())
+                quit();
+            return;
+        }
+
         mainWindow = std::make_unique<MainWindow>();
     }
 
     void shutdown() override
     {
         mainWindow = nullptr;
+        sandboxHost = nullptr;
     }
 
 private:
     std::unique_ptr<MainWindow> mainWindow;
+    std::unique_ptr<SandboxHost> sandboxHost;
 };
 
 START_JUCE_APPLICATION(Application)
\ No newline at end of file
@@ -1,8 +1,11 @@
 #include "MainComponent.h"
+#include "RealtimeAllocationCheck.h"
+#include "SandboxedPlugin.h"
 
 //==============================================================================
 MainComponent::MainComponent()
 {
+    startupTime = juce::Time::getMillisecondCounterHiRes();
     setSize(800, 600);
 
     // Color scheme
@@ -13,7 +16,7 @@ MainComponent::MainComponent()
     const auto highlightGrey = juce::Colour(70, 70, 70);
 
     // Style buttons
-    for (auto* button : { &loadPluginButton, &settingsButton, &saveButton })
+    for (auto* button : { &loadPluginButton, &settingsButton, &saveButton, &engineButton, &sceneButton })
     {
         addAndMakeVisible(button);
         button->setColour(juce::TextButton::buttonColourId, lighterGrey);
@@ -36,28 +39,34 @@ MainComponent::MainComponent()
     settingsButton.setButtonText("Audio Settings");
     settingsButton.onClick = [this] { showAudioSettings(); };
 
+    engineButton.setButtonText("Engine");
+    engineButton.onClick = [this] { showEngineOptions(); };
+
     saveButton.setButtonText("Save Plugin State");
     saveButton.onClick = [this]
     {
         DBG("Save button clicked, saving plugin state...");
-        if (settings.savePluginState(plugins))
-        {
-            DBG("Successfully saved plugin state");
-            juce::AlertWindow::showMessageBoxAsync(
-                juce::AlertWindow::InfoIcon,
-                "Save Successful",
-                "Plugin state has been saved.",
-                "OK");
-        }
-        else
+        autosaver.saveNow(selectedStrip, strips[(size_t)selectedStrip]->getActiveScene(), [](bool success)
         {
-            DBG("Failed to save plugin state");
-            juce::AlertWindow::showMessageBoxAsync(
-                juce::AlertWindow::WarningIcon,
-                "Save Failed",
-                "Failed to save plugin state.",
-                "OK");
-        }
+            if (success)
+            {
+                DBG("Successfully saved plugin state");
+                juce::AlertWindow::showMessageBoxAsync(
+                    juce::AlertWindow::InfoIcon,
+                    "Save Successful",
+                    "Plugin state has been saved.",
+                    "OK");
+            }
+            else
+            {
+                DBG("Failed to save plugin state");
+                juce::AlertWindow::showMessageBoxAsync(
+                    juce::AlertWindow::WarningIcon,
+                    "Save Failed",
+                    "Failed to save plugin state.",
+                    "OK");
+            }
+        });
     };
 
     // Plugin list
@@ -70,7 +79,35 @@ MainComponent::MainComponent()
     pluginList.setColour(juce::ListBox::textColourId, whitish);
     pluginList.setOutlineThickness(1);
 
+    addAndMakeVisible(latencyLabel);
+    latencyLabel.setColour(juce::Label::textColourId, whitish);
+    latencyLabel.setJustificationType(juce::Justification::centredLeft);
+
     formatManager.addDefaultFormats();
+    settings.loadEngineOptions(engineOptions);
+    settings.setCompressPluginState(engineOptions.compressPluginState);
+    realtimePolicy.setOptions(engineOptions.realtime);
+    watchdog.setOptions(engineOptions.watchdog);
+    warmup.setNumBlocks(engineOptions.warmupBlocks);
+    workerPool.setPolicy(&realtimePolicy);
+    autosaver.setJournal(&journal);
+
+    addChildComponent(stripSelector);
+    stripSelector.setColour(juce::ComboBox::backgroundColourId, lighterGrey);
+    stripSelector.setColour(juce::ComboBox::textColourId, whitish);
+    stripSelector.setColour(juce::ComboBox::arrowColourId, whitish);
+    stripSelector.setColour(juce::ComboBox::outlineColourId, lighterGrey);
+    stripSelector.onChange = [this] { selectStrip(stripSelector.getSelectedItemIndex()); };
+
+    addAndMakeVisible(sceneSelector);
+    sceneSelector.setColour(juce::ComboBox::backgroundColourId, lighterGrey);
+    sceneSelector.setColour(juce::ComboBox::textColourId, whitish);
+    sceneSelector.setColour(juce::ComboBox::arrowColourId, whitish);
+    sceneSelector.setColour(juce::ComboBox::outlineColourId, lighterGrey);
+    sceneSelector.onChange = [this] { switchScene(sceneSelector.getSelectedId() - 1); };
+
+    sceneButton.setButtonText("Scenes");
+    sceneButton.onClick = [this] { showSceneMenu(); };
 
     // Main device manager
     auto result = deviceManager.initialiseWithDefaultDevices(2, 2);
@@ -88,36 +125,17 @@ MainComponent::MainComponent()
 
     // Load saved plugins
     DBG("Loading saved plugins");
-    if (auto* device = deviceManager.getCurrentAudioDevice())
-    {
-        DBG("Device available for plugin loading");
-        DBG("Sample rate: " << device->getCurrentSampleRate());
-        DBG("Buffer size: " << device->getCurrentBufferSizeSamples());
-
-        if (!settings.loadPluginState(plugins, formatManager,
-            device->getCurrentSampleRate(),
-            device->getCurrentBufferSizeSamples()))
-        {
-            DBG("Failed to load plugin state");
-        }
-        else
-        {
-            DBG("Successfully loaded plugin state");
-            DBG("Number of plugins loaded: " << plugins.size());
-        }
-        pluginList.updateContent();
-    }
-    else
-    {
-        DBG("No audio device available for plugin loading");
-    }
+    rebuildStrips();
 
     deviceManager.addAudioCallback(this);
+    startTimerHz(4);
     DBG("MainComponent constructor completed");
 }
 
 MainComponent::~MainComponent()
 {
+    stopTimer();
+    chainRestore = nullptr;
     deviceManager.removeAudioCallback(this);
 
     // Stop monitor player
@@ -126,7 +144,10 @@ MainComponent::~MainComponent()
 
     shutdownAudio();
     settings.saveState(deviceManager);
-    plugins.clear();
+    warmup.finishAll();
+    autosaver.flush();
+    for (auto& strip : strips)
+        strip->forEachChain([](PluginChain& chain) { chain.setPlugins({}); });
     DBG("MainComponent destructor completed");
 }
 
@@ -166,20 +187,28 @@ void MainComponent::resized()
     loadPluginButton.setBounds(buttonArea.removeFromLeft(200).reduced(margin, 0));
     settingsButton.setBounds(buttonArea.removeFromLeft(200).reduced(margin, 0));
     saveButton.setBounds(buttonArea.removeFromLeft(200).reduced(margin, 0));
+    engineButton.setBounds(buttonArea.removeFromLeft(200).reduced(margin, 0));
+    stripSelector.setBounds(buttonArea.reduced(margin, 3));
+
+    auto sceneArea = area.removeFromTop(buttonHeight);
+    sceneButton.setBounds(sceneArea.removeFromRight(200).reduced(margin, 0));
+    sceneSelector.setBounds(sceneArea.reduced(margin, 3));
 
+    latencyLabel.setBounds(area.removeFromBottom(buttonHeight).reduced(margin, 0));
     pluginList.setBounds(area.reduced(margin));
 }
 
 //==============================================================================
 int MainComponent::getNumRows()
 {
-    return (int)plugins.size();
+    // The list is hooked up before the strips exist
+    return strips.empty() ? 0 : getChain().size();
 }
 
 void MainComponent::paintListBoxItem(int rowNumber, juce::Graphics& g,
     int width, int height, bool rowIsSelected)
 {
-    if (rowNumber >= 0 && rowNumber < (int)plugins.size())
+    if (auto* instance = getChain().getPlugin(rowNumber))
     {
         if (rowIsSelected)
             g.fillAll(juce::Colour(70, 70, 70));
@@ -190,12 +219,54 @@ void MainComponent::paintListBoxItem(int rowNumber, juce::Graphics& g,
         g.drawLine(0, height, width, height, 1.0f);
 
         auto bounds = juce::Rectangle<int>(0, 0, width, height).reduced(8, 0);
-        auto plugin = plugins[rowNumber]->processor.get();
+        auto plugin = instance->processor.get();
 
-        g.setColour(juce::Colour(230, 230, 230));
+        // Parallel branches are indented behind a bar joining them to the split
+        if (instance->parallelWithPrevious && rowNumber > 0)
+        {
+            g.setColour(juce::Colour(120, 120, 120));
+            g.fillRect(bounds.removeFromLeft(3));
+            bounds.removeFromLeft(8);
+        }
+
+        const bool bypassed = instance->bypassed;
+
+        g.setColour(bypassed ? juce::Colour(120, 120, 120) : juce::Colour(230, 230, 230));
         g.drawText(plugin->getName(), bounds, juce::Justification::centredLeft);
 
-        if (plugins[rowNumber]->isEditorVisible)
+        juce::String details;
+        if (instance->hung)
+        {
+            details << "hung, bypassed (worst " << juce::String(instance->worstOverrunMicros.load() / 1000.0f, 1) << " ms)";
+        }
+        else if (bypassed)
+        {
+            details << "bypassed";
+        }
+        else
+        {
+            auto timing = instance->timing.getSummary();
+            if (timing.numBlocks > 0)
+                details << "avg " << juce::String(timing.meanMicros / 1000.0f, 2)
+                        << "  p99 " << juce::String(timing.p99Micros / 1000.0f, 2)
+                        << "  max " << juce::String(timing.maxMicros / 1000.0f, 2) << " ms  "
+                        << juce::String(timing.budgetPercent, 1) << "%";
+
+            if (auto overruns = instance->overruns.load())
+                details << (details.isEmpty() ? "" : "  ") << overruns << (overruns == 1 ? " overrun" : " overruns");
+        }
+        if (instance->latencySamples > 0)
+            details << (details.isEmpty() ? "" : "  ") << instance->latencySamples << " smp";
+        if (auto* sandboxed = dynamic_cast<SandboxedPlugin*>(plugin))
+            details << (details.isEmpty() ? "" : "  ") << sandboxed->getStatusText();
+
+        if (details.isNotEmpty())
+        {
+            g.setColour(juce::Colour(150, 150, 150));
+            g.drawText(details, bounds.withTrimmedRight(20), juce::Justification::centredRight);
+        }
+
+        if (instance->isEditorVisible)
         {
             g.setColour(juce::Colour(200, 200, 200));
             g.drawEllipse(width - 20, height / 2 - 5, 10, 10, 1.0f);
@@ -208,27 +279,163 @@ void MainComponent::paintListBoxItem(int rowNumber, juce::Graphics& g,
 void MainComponent::deleteSelectedPlugin()
 {
     int selectedRow = pluginList.getSelectedRow();
-    if (selectedRow >= 0 && selectedRow < (int)plugins.size())
+    if (selectedRow >= 0 && selectedRow < getChain().size())
     {
-        plugins.erase(plugins.begin() + selectedRow);
+        getChain().removePlugin(selectedRow);
         pluginList.updateContent();
-        settings.savePluginState(plugins);
+        autosaver.markChanged(selectedStrip);
         DBG("Removed plugin at index " << selectedRow);
     }
 }
 
+void MainComponent::moveSelectedPlugin(int delta)
+{
+    int selectedRow = pluginList.getSelectedRow();
+    int targetRow = selectedRow + delta;
+    if (selectedRow >= 0 && selectedRow < getChain().size()
+        && targetRow >= 0 && targetRow < getChain().size())
+    {
+        getChain().movePlugin(selectedRow, targetRow);
+        pluginList.updateContent();
+        pluginList.selectRow(targetRow);
+        autosaver.markChanged(selectedStrip);
+        DBG("Moved plugin from index " << selectedRow << " to " << targetRow);
+    }
+}
+
+void MainComponent::toggleSelectedPluginParallel()
+{
+    int selectedRow = pluginList.getSelectedRow();
+    if (auto* plugin = getChain().getPlugin(selectedRow))
+    {
+        getChain().setParallelWithPrevious(selectedRow, !plugin->parallelWithPrevious);
+        pluginList.repaint();
+        autosaver.markChanged(selectedStrip);
+        DBG("Plugin " << selectedRow << (plugin->parallelWithPrevious ? " now runs in parallel" : " now runs in series"));
+    }
+}
+
+void MainComponent::toggleSelectedPluginBypass()
+{
+    int selectedRow = pluginList.getSelectedRow();
+    if (auto* plugin = getChain().getPlugin(selectedRow))
+    {
+        getChain().setBypassed(selectedRow, !plugin->bypassed);
+        pluginList.repaint();
+        autosaver.markChanged(selectedStrip);
+        DBG("Plugin " << selectedRow << (plugin->bypassed ? " bypassed" : " active"));
+    }
+}
+
+void MainComponent::toggleSelectedPluginSandbox()
+{
+    int selectedRow = pluginList.getSelectedRow();
+    auto* plugin = getChain().getPlugin(selectedRow);
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (plugin == nullptr || device == nullptr)
+        return;
+
+    auto desc = plugin->processor->getPluginDescription();
+    juce::MemoryBlock state;
+    plugin->processor->getStateInformation(state);
+
+    double sampleRate = device->getCurrentSampleRate();
+    int bufferSize = juce::jmax(device->getCurrentBufferSizeSamples(), getChain().getMaximumBlockSize());
+    const bool wasSandboxed = dynamic_cast<SandboxedPlugin*>(plugin->processor.get()) != nullptr;
+    const auto residentBefore = AudioMemoryLock::getResidentBytes();
+
+    juce::String error;
+    std::unique_ptr<juce::AudioPluginInstance> replacement;
+
+    if (wasSandboxed)
+    {
+        replacement = formatManager.createPluginInstance(desc, sampleRate, bufferSize, error);
+        if (replacement != nullptr)
+        {
+            replacement->setRateAndBufferSizeDetails(sampleRate, bufferSize);
+            if (auto* bus = replacement->getBus(true, 0))
+                bus->enable();
+            if (auto* bus = replacement->getBus(false, 0))
+                bus->enable();
+            replacement->setBusesLayout(replacement->getBusesLayout());
+            replacement->prepareToPlay(sampleRate, bufferSize);
+            replacement->setStateInformation(state.getData(), (int)state.getSize());
+        }
+    }
+    else
+    {
+        replacement = SandboxedPlugin::launch(desc, state, sampleRate, bufferSize, error);
+        if (replacement != nullptr)
+            replacement->prepareToPlay(sampleRate, bufferSize);
+    }
+
+    if (replacement == nullptr)
+    {
+        DBG("Failed to move plugin " << selectedRow << ": " << error);
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon,
+            "Error", wasSandboxed ? "Failed to load the plugin in process: " + error
+                                  : "Failed to start the sandbox: " + error);
+        return;
+    }
+
+    auto instance = std::make_unique<PluginInstance>();
+    instance->processor = std::move(replacement);
+
+    const auto residentAfter = AudioMemoryLock::getResidentBytes();
+    instance->loadedBytes = residentAfter > residentBefore ? residentAfter - residentBefore : 0;
+
+    // The old plugin keeps playing until its replacement is warmed up
+    const auto strip = selectedStrip;
+    const auto scene = strips[(size_t)strip]->getActiveScene();
+    warmup.warmUp(std::move(instance), device->getCurrentBufferSizeSamples(),
+        [this, strip, scene, plugin, wasSandboxed](std::unique_ptr<PluginInstance> warmed)
+        {
+            auto& chain = strips[(size_t)strip]->getChain(scene);
+            auto index = chain.indexOf(plugin);
+            if (!strips[(size_t)strip]->isSceneLoaded(scene) || index < 0)
+            {
+                DBG("Plugin went away while its replacement warmed up");
+                return;
+            }
+
+            chain.replacePlugin(index, std::move(warmed));
+            pluginList.repaint();
+            autosaver.markChanged(strip, scene);
+            DBG("Plugin " << index << (wasSandboxed ? " now runs in process" : " now runs sandboxed"));
+        });
+}
+
 void MainComponent::listBoxItemDoubleClicked(int row, const juce::MouseEvent& event)
 {
     if (event.mods.isRightButtonDown())
     {
         juce::PopupMenu menu;
         menu.addItem(1, "Remove Plugin");
+        menu.addItem(2, "Move Up", row > 0);
+        menu.addItem(3, "Move Down", row < getChain().size() - 1);
+
+        auto* plugin = getChain().getPlugin(row);
+        menu.addItem(4, "Run In Parallel With Previous", row > 0,
+            plugin != nullptr && plugin->parallelWithPrevious);
+        menu.addItem(5, "Bypass", plugin != nullptr, plugin != nullptr && plugin->bypassed);
+        menu.addItem(6, "Run In Sandbox", plugin != nullptr && SandboxChannel::isSupported(),
+            plugin != nullptr && dynamic_cast<SandboxedPlugin*>(plugin->processor.get()) != nullptr);
 
         menu.showMenuAsync(juce::PopupMenu::Options(),
             [this](int result)
             {
                 if (result == 1)
                     deleteSelectedPlugin();
+                else if (result == 2)
+                    moveSelectedPlugin(-1);
+                else if (result == 3)
+                    moveSelectedPlugin(1);
+                else if (result == 4)
+                    toggleSelectedPluginParallel();
+                else if (result == 5)
+                    toggleSelectedPluginBypass();
+                else if (result == 6)
+                    toggleSelectedPluginSandbox();
             });
     }
     else
@@ -244,82 +451,179 @@ void MainComponent::audioDeviceIOCallback(const float** inputChannelData,
     int numOutputChannels,
     int numSamples)
 {
-    // Make sure tempBuffer is large enough
-    if (tempBuffer.getNumChannels() < numOutputChannels || tempBuffer.getNumSamples() < numSamples)
-        tempBuffer.setSize(numOutputChannels, numSamples, false, false, true);
+    const RealtimeAllocationCheck::ScopedRealtimeSection realtimeSection;
+    realtimePolicy.applyToCurrentThread(RealtimePolicy::deviceThread);
+    const CallbackMonitor::ScopedCallback callbackTiming(callbackMonitor, numSamples);
+    const auto callbackStartTicks = juce::Time::getHighResolutionTicks();
+    const SandboxedPlugin::ScopedDeadline sandboxDeadline(callbackStartTicks, numSamples, deviceSampleRate);
 
     // If monitoring is enabled, feed input to the monitor AudioSource
     if (monitoringEnabled && monitorAudioSource)
         monitorAudioSource->writeToFifo(inputChannelData, numInputChannels, numSamples);
 
-    // Copy input to tempBuffer for plugin processing
-    for (int channel = 0; channel < numInputChannels && channel < tempBuffer.getNumChannels(); ++channel)
+    // Only ever prepared with a single strip
+    if (blockAdapter.isActive())
     {
-        if (inputChannelData[channel] != nullptr)
-            tempBuffer.copyFrom(channel, 0, inputChannelData[channel], numSamples);
+        auto& strip = *strips.front();
+        blockAdapter.process(strip.getContext(), inputChannelData, numInputChannels,
+            outputChannelData, numOutputChannels, numSamples,
+            [&strip](ProcessingContext& ctx, int blockSize) { strip.processScenes(ctx, blockSize); });
+        applyOutputFade(outputChannelData, numOutputChannels, numSamples);
+        return;
     }
 
-    // Process through plugins
-    if (!plugins.empty())
+    // Drivers occasionally hand us more than they promised; rather than growing
+    // the buffers here, run the strips over the block in slices that fit.
+    const auto maximumBlockSize = strips.front()->getContext().maximumBlockSize;
+    stripJob.callbackStartTicks = callbackStartTicks;
+    stripJob.callbackSamples = numSamples;
+
+    for (int offset = 0; offset < numSamples; offset += maximumBlockSize)
     {
-        juce::MidiBuffer midiBuffer;
-        for (auto& plugin : plugins)
-        {
-            if (plugin && plugin->processor)
-                plugin->processor->processBlock(tempBuffer, midiBuffer);
-        }
+        const int sliceSize = juce::jmin(maximumBlockSize, numSamples - offset);
+
+        // Every strip runs its chain on the pool; all have joined on return
+        stripJob.inputChannelData = inputChannelData;
+        stripJob.numInputChannels = numInputChannels;
+        stripJob.offset = offset;
+        stripJob.numSamples = sliceSize;
+        workerPool.parallelFor(stripJob, (int)strips.size());
+
+        // Mix the strips into the device outputs
+        for (int channel = 0; channel < numOutputChannels; ++channel)
+            if (outputChannelData[channel] != nullptr)
+                juce::FloatVectorOperations::clear(outputChannelData[channel] + offset, sliceSize);
+
+        for (auto& strip : strips)
+            strip->addToOutput(outputChannelData, numOutputChannels, offset, sliceSize);
     }
 
-    // Output processed audio
+    applyOutputFade(outputChannelData, numOutputChannels, numSamples);
+}
+
+void MainComponent::applyOutputFade(float** outputChannelData, int numOutputChannels, int numSamples) noexcept
+{
+    const auto target = outputMuted.load(std::memory_order_relaxed) ? 0.0f : 1.0f;
+    const auto maxStep = outputGainStepPerSample * (float)numSamples;
+    const auto start = outputGain;
+    const auto end = target > start ? juce::jmin(target, start + maxStep) : juce::jmax(target, start - maxStep);
+    outputGain = end;
+
+    if (end > 0.0f && firstAudioMs.load(std::memory_order_relaxed) < 0.0)
+        firstAudioMs.store(juce::Time::getMillisecondCounterHiRes() - startupTime);
+
+    if (start == 1.0f && end == 1.0f)
+        return;
+
+    const auto step = (end - start) / (float)numSamples;
     for (int channel = 0; channel < numOutputChannels; ++channel)
     {
-        if (outputChannelData[channel] != nullptr)
+        auto* data = outputChannelData[channel];
+        if (data == nullptr)
+            continue;
+
+        if (start == 0.0f && end == 0.0f)
         {
-            if (channel < tempBuffer.getNumChannels())
-            {
-                memcpy(outputChannelData[channel],
-                    tempBuffer.getReadPointer(channel),
-                    sizeof(float) * numSamples);
-            }
-            else
-            {
-                juce::FloatVectorOperations::clear(outputChannelData[channel], numSamples);
-            }
+            juce::FloatVectorOperations::clear(data, numSamples);
+            continue;
         }
+
+        auto gain = start;
+        for (int i = 0; i < numSamples; ++i, gain += step)
+            data[i] *= gain;
     }
 }
 
+void MainComponent::StripJob::run(int index) noexcept
+{
+    // Pool threads don't see the device thread's deadline
+    const SandboxedPlugin::ScopedDeadline sandboxDeadline(callbackStartTicks, callbackSamples, owner.deviceSampleRate);
+    owner.strips[(size_t)index]->process(inputChannelData, numInputChannels, offset, numSamples);
+}
+
 void MainComponent::audioDeviceAboutToStart(juce::AudioIODevice* device)
 {
     DBG("Main device about to start: " << device->getName());
     DBG("Sample rate: " << device->getCurrentSampleRate());
     DBG("Buffer size: " << device->getCurrentBufferSizeSamples());
 
-    tempBuffer.setSize(2, device->getCurrentBufferSizeSamples());
+    // Size everything for the worst case the device can throw at us, so the
+    // callback never has to grow a buffer.
+    auto maximumBlockSize = device->getCurrentBufferSizeSamples();
+    for (auto size : device->getAvailableBufferSizes())
+        maximumBlockSize = juce::jmax(maximumBlockSize, size);
 
-    for (auto& plugin : plugins)
+    auto numChannels = juce::jmax(2,
+        device->getActiveInputChannels().countNumberOfSetBits(),
+        device->getActiveOutputChannels().countNumberOfSetBits());
+
+    // With a fixed block size the chain never sees anything else. The adapter
+    // drives a single chain, so it stays out of the way of multiple strips.
+    blockAdapter.prepare(numChannels, strips.size() == 1 ? engineOptions.fixedBlockSize : 0, maximumBlockSize);
+    if (blockAdapter.isActive())
     {
-        if (plugin && plugin->processor)
-        {
-            plugin->processor->prepareToPlay(device->getCurrentSampleRate(),
-                device->getCurrentBufferSizeSamples());
-            DBG("Prepared plugin: " << plugin->processor->getName());
-        }
+        maximumBlockSize = blockAdapter.getBlockSize();
+        DBG("Re-blocking to " << maximumBlockSize << " samples, adding "
+            << blockAdapter.getLatencySamples() << " samples of latency");
+    }
+
+    // Tiling would undo the constant block size and doesn't mix with pipelining
+    const bool canTile = !blockAdapter.isActive() && engineOptions.pipelineSegments <= 1;
+    for (auto& strip : strips)
+    {
+        strip->forEachChain([&](PluginChain& chain) { chain.setTileSize(canTile ? engineOptions.tileSize : 0); });
+        strip->prepare(device->getCurrentSampleRate(), maximumBlockSize, numChannels);
     }
+
+    startedOptions = engineOptions;
+    deviceSampleRate = device->getCurrentSampleRate();
+
+    DBG("Processing " << strips.size() << " strip(s), " << numChannels << " device channels, "
+        << maximumBlockSize << " samples");
+    DBG(AudioMemoryLock::getReportText().trimEnd());
+    callbackMonitor.prepare(device->getCurrentSampleRate());
+    realtimePolicy.audioStarted();
+
+    // Every start fades in rather than switching on mid-waveform
+    outputGain = 0.0f;
+    outputGainStepPerSample = (float)(1.0 / (outputFadeSeconds * device->getCurrentSampleRate()));
 }
 
 void MainComponent::audioDeviceStopped()
 {
     DBG("Main device stopped");
-    for (auto& plugin : plugins)
-    {
-        if (plugin && plugin->processor)
-            plugin->processor->releaseResources();
-    }
+    for (auto& strip : strips)
+        strip->release();
+    realtimePolicy.audioStopped();
 }
 
 //==============================================================================
 void MainComponent::loadPlugin()
+{
+    if (pluginBrowserWindow == nullptr)
+    {
+        pluginBrowserWindow = std::make_unique<SettingsWindow>("Add Plugin");
+
+        auto* browser = new PluginBrowserComponent(scanCache);
+        browser->onPluginChosen = [this](const juce::PluginDescription& description)
+        {
+            pluginBrowserWindow->setVisible(false);
+            addPlugin(description);
+        };
+        browser->onBrowseForFile = [this] { addPluginFromFile(); };
+        browser->setSize(500, 600);
+
+        pluginBrowserWindow->setContentOwned(browser, true);
+        pluginBrowserWindow->setBackgroundColour(juce::Colour(40, 40, 40));
+        pluginBrowserWindow->setResizable(true, false);
+        pluginBrowserWindow->centreWithSize(500, 600);
+    }
+
+    pluginBrowserWindow->setVisible(true);
+    pluginBrowserWindow->toFront(true);
+}
+
+void MainComponent::addPluginFromFile()
 {
     chooser = std::make_unique<juce::FileChooser>("Select a VST3 plugin",
         juce::File::getSpecialLocation(juce::File::userHomeDirectory),
@@ -346,88 +650,128 @@ void MainComponent::loadPlugin()
                 return;
             }
 
+            juce::String scanError;
             juce::OwnedArray<juce::PluginDescription> descriptions;
-            format->findAllTypesForFile(descriptions, result.getFullPathName());
-
-            if (descriptions.isEmpty())
+            if (!scanCache.getDescriptions(*format, result.getFullPathName(), descriptions, scanError))
             {
-                DBG("No plugin descriptions found");
+                DBG("No plugin descriptions found: " << scanError);
+                juce::AlertWindow::showMessageBoxAsync(
+                    juce::AlertWindow::WarningIcon,
+                    "Error", "Couldn't load " + result.getFileName() + ": " + scanError);
                 return;
             }
 
             DBG("Found plugin: " << descriptions[0]->name);
 
-            auto* device = deviceManager.getCurrentAudioDevice();
-            if (device == nullptr)
-            {
-                DBG("No main audio device available");
-                return;
-            }
+            // Keep an eye on wherever the user gets plugins from
+            directoryWatcher.addDirectory(result.getParentDirectory());
 
-            auto instance = std::make_unique<PluginInstance>();
+            if (pluginBrowserWindow != nullptr)
+                pluginBrowserWindow->setVisible(false);
 
-            double sampleRate = device->getCurrentSampleRate();
-            int bufferSize = device->getCurrentBufferSizeSamples();
+            addPlugin(*descriptions[0]);
+        });
+}
 
-            DBG("Creating plugin instance with sample rate: " << sampleRate
-                << " and buffer size: " << bufferSize);
+void MainComponent::addPlugin(const juce::PluginDescription& description)
+{
+    juce::AudioPluginFormat* format = nullptr;
+    for (auto* f : formatManager.getFormats())
+        if (f->getName() == description.pluginFormatName)
+            format = f;
 
-            auto pluginInstance = format->createInstanceFromDescription(*descriptions[0], sampleRate, bufferSize);
-            if (pluginInstance == nullptr)
-            {
-                DBG("Failed to create plugin instance");
-                juce::AlertWindow::showMessageBoxAsync(
-                    juce::AlertWindow::WarningIcon,
-                    "Error", "Failed to create plugin instance");
-                return;
-            }
+    if (format == nullptr)
+    {
+        DBG("No plugin format found for " << description.pluginFormatName);
+        return;
+    }
 
-            DBG("Plugin instance created successfully");
-            instance->processor = std::move(pluginInstance);
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (device == nullptr)
+    {
+        DBG("No main audio device available");
+        return;
+    }
 
-            // Configure the plugin
-            DBG("Configuring plugin with sample rate: " << sampleRate
-                << " and buffer size: " << bufferSize);
-            instance->processor->setRateAndBufferSizeDetails(sampleRate, bufferSize);
+    auto instance = std::make_unique<PluginInstance>();
+    const auto residentBefore = AudioMemoryLock::getResidentBytes();
 
-            if (auto* bus = instance->processor->getBus(true, 0))
-            {
-                bus->enable();
-                DBG("Enabled input bus");
-            }
-            if (auto* bus = instance->processor->getBus(false, 0))
-            {
-                bus->enable();
-                DBG("Enabled output bus");
-            }
+    double sampleRate = device->getCurrentSampleRate();
+    // Prepare for the largest block the chain may hand the plugin
+    int bufferSize = juce::jmax(device->getCurrentBufferSizeSamples(), getChain().getMaximumBlockSize());
+
+    DBG("Creating plugin instance with sample rate: " << sampleRate
+        << " and buffer size: " << bufferSize);
+
+    auto pluginInstance = format->createInstanceFromDescription(description, sampleRate, bufferSize);
+    if (pluginInstance == nullptr)
+    {
+        DBG("Failed to create plugin instance");
+        juce::AlertWindow::showMessageBoxAsync(
+            juce::AlertWindow::WarningIcon,
+            "Error", "Failed to create plugin instance");
+        return;
+    }
+
+    DBG("Plugin instance created successfully");
+    instance->processor = std::move(pluginInstance);
+
+    // Configure the plugin
+    DBG("Configuring plugin with sample rate: " << sampleRate
+        << " and buffer size: " << bufferSize);
+    instance->processor->setRateAndBufferSizeDetails(sampleRate, bufferSize);
 
-            auto layout = instance->processor->getBusesLayout();
-            if (!instance->processor->setBusesLayout(layout))
+    if (auto* bus = instance->processor->getBus(true, 0))
+    {
+        bus->enable();
+        DBG("Enabled input bus");
+    }
+    if (auto* bus = instance->processor->getBus(false, 0))
+    {
+        bus->enable();
+        DBG("Enabled output bus");
+    }
+
+    auto layout = instance->processor->getBusesLayout();
+    if (!instance->processor->setBusesLayout(layout))
+    {
+        DBG("Failed to set plugin bus layout");
+        juce::AlertWindow::showMessageBoxAsync(
+            juce::AlertWindow::WarningIcon,
+            "Error", "Failed to set plugin bus layout");
+        return;
+    }
+
+    instance->processor->prepareToPlay(sampleRate, bufferSize);
+    DBG("Plugin prepared to play");
+
+    const auto residentAfter = AudioMemoryLock::getResidentBytes();
+    instance->loadedBytes = residentAfter > residentBefore ? residentAfter - residentBefore : 0;
+
+    // Add plugin to chain once it's warmed up, if the scene is still there
+    const auto strip = selectedStrip;
+    const auto scene = strips[(size_t)strip]->getActiveScene();
+    warmup.warmUp(std::move(instance), device->getCurrentBufferSizeSamples(),
+        [this, strip, scene](std::unique_ptr<PluginInstance> plugin)
+        {
+            if (!strips[(size_t)strip]->isSceneLoaded(scene))
             {
-                DBG("Failed to set plugin bus layout");
-                juce::AlertWindow::showMessageBoxAsync(
-                    juce::AlertWindow::WarningIcon,
-                    "Error", "Failed to set plugin bus layout");
+                DBG("Scene was unloaded while the plugin warmed up, dropping it");
                 return;
             }
 
-            instance->processor->prepareToPlay(sampleRate, bufferSize);
-            DBG("Plugin prepared to play");
-
-            // Add plugin to chain
-            plugins.push_back(std::move(instance));
+            auto* lastPlugin = plugin->processor.get();
+            strips[(size_t)strip]->getChain(scene).addPlugin(std::move(plugin));
             pluginList.updateContent();
             DBG("Plugin added successfully to chain");
 
-            auto* lastPlugin = plugins.back()->processor.get();
             DBG("Final plugin state:");
             DBG("Name: " << lastPlugin->getName());
             DBG("Input channels: " << lastPlugin->getTotalNumInputChannels());
             DBG("Output channels: " << lastPlugin->getTotalNumOutputChannels());
             DBG("Latency samples: " << lastPlugin->getLatencySamples());
 
-            // Save plugin state
-            settings.savePluginState(plugins);
+            autosaver.markChanged(strip, scene);
         });
 }
 
@@ -482,6 +826,234 @@ void MainComponent::showAudioSettings()
     settingsWindow->setVisible(true);
 }
 
+void MainComponent::showEngineOptions()
+{
+    if (engineWindow == nullptr)
+    {
+        engineWindow = std::make_unique<SettingsWindow>("Engine");
+
+        engineOptionsComponent = new EngineOptionsComponent(engineOptions);
+        engineOptionsComponent->onOptionsChanged = [this] { applyEngineOptions(); };
+        engineOptionsComponent->onExportTiming = [this] { exportCallbackTiming(); };
+        engineOptionsComponent->onResetTiming = [this] { callbackMonitor.reset(); };
+        engineOptionsComponent->setSize(500, 700);
+
+        engineWindow->setContentOwned(engineOptionsComponent, true);
+        engineWindow->setBackgroundColour(juce::Colour(40, 40, 40));
+        engineWindow->centreWithSize(500, 700);
+    }
+
+    engineOptionsComponent->setStatusText(getEngineStatusText());
+    engineWindow->setVisible(true);
+}
+
+void MainComponent::applyEngineOptions()
+{
+    settings.saveEngineOptions(engineOptions);
+    settings.setCompressPluginState(engineOptions.compressPluginState);
+    realtimePolicy.setOptions(engineOptions.realtime);
+    watchdog.setOptions(engineOptions.watchdog);
+    warmup.setNumBlocks(engineOptions.warmupBlocks);
+
+    // Pipeline workers, block sizes and tiling are only set up when the device
+    // starts, and strips can only come and go while it's stopped. Anything
+    // else applies live, without a gap in the audio.
+    const bool layoutChanged = (int)strips.size() != engineOptions.numStrips
+                            || builtChannelsPerStrip != engineOptions.channelsPerStrip;
+    const bool restart = deviceManager.getCurrentAudioDevice() != nullptr
+                      && (layoutChanged
+                          || startedOptions.pipelineSegments != engineOptions.pipelineSegments
+                          || startedOptions.fixedBlockSize != engineOptions.fixedBlockSize
+                          || startedOptions.tileSize != engineOptions.tileSize);
+    if (restart)
+    {
+        DBG("Restarting audio device to apply engine options");
+        deviceManager.closeAudioDevice();
+    }
+
+    if (layoutChanged)
+        rebuildStrips();
+
+    for (auto& strip : strips)
+        strip->forEachChain([this](PluginChain& chain) { chain.setPipelineSegments(engineOptions.pipelineSegments); });
+
+    // A lower limit unloads scenes right away
+    if (!isRestoring())
+        for (int i = 0; i < (int)strips.size(); ++i)
+            enforceStandbyLimit(i);
+
+    if (restart)
+        deviceManager.restartLastAudioDevice();
+}
+
+juce::String MainComponent::getEngineStatusText()
+{
+    juce::String text;
+
+    auto latencyBlocks = getChain().getPipelineLatencyInBlocks();
+    if (latencyBlocks > 0)
+    {
+        text << "Pipeline: " << (latencyBlocks + 1) << " segments, +" << latencyBlocks
+             << " block(s) latency, " << (juce::int64)getChain().getPipelineLateBlocks() << " late blocks\n";
+    }
+    else
+    {
+        text << "Pipeline: off\n";
+    }
+
+    if (blockAdapter.isActive())
+        text << "Fixed blocks: " << blockAdapter.getBlockSize() << " samples, +"
+             << blockAdapter.getLatencySamples() << " samples latency\n";
+    else
+        text << "Fixed blocks: off\n";
+
+    if (getChain().getTileSize() > 0)
+        text << "Cache tiles: " << getChain().getTileSize() << " samples\n";
+    else
+        text << "Cache tiles: off\n";
+
+    text << "Channel strips: " << (int)strips.size() << ", showing " << getChain().size()
+         << " plugins of strip " << selectedStrip + 1 << "\n";
+
+    auto& strip = *strips[(size_t)selectedStrip];
+    text << "Scenes:";
+    for (int scene = 0; scene < ChannelStrip::maxScenes; ++scene)
+    {
+        if (!strip.isSceneInUse(scene))
+            continue;
+
+        text << " " << strip.getSceneName(scene);
+        if (!strip.isSceneLoaded(scene))
+            text << " (unloaded)";
+        else
+            text << " (" << (scene == strip.getActiveScene() ? "active" : "standby") << ", "
+                 << juce::File::descriptionOfSizeInBytes((juce::int64)strip.getSceneMemoryBytes(scene)) << ")";
+    }
+    text << ", up to " << engineOptions.maxStandbyScenes << " on standby\n";
+    text << "DSP workers: " << workerPool.getNumWorkers() << "\n";
+
+    text << "Startup: first audio "
+         << (firstAudioMs.load() < 0.0 ? juce::String("pending") : juce::String(firstAudioMs.load(), 0) + " ms")
+         << ", full chain "
+         << (fullChainMs < 0.0 ? juce::String("pending") : juce::String(fullChainMs, 0) + " ms")
+         << (engineOptions.progressiveRestore ? " (progressive)\n" : "\n");
+    if (PluginDirectoryWatcher::isSupported())
+        text << "Plugin folders: watched, " << directoryWatcher.getNumUpdates() << " bundles updated\n";
+    else
+        text << "Plugin folders: not watched\n";
+    text << realtimePolicy.getReport();
+    text << AudioMemoryLock::getReportText();
+
+    auto timing = callbackMonitor.getSummary();
+    text << "Callbacks: " << (juce::int64)timing.numCallbacks
+         << ", xruns: " << (juce::int64)timing.numXruns
+         << " (" << (juce::int64)timing.numOverruns << " overruns, "
+         << (juce::int64)timing.numLateCallbacks << " late)\n"
+         << "Worst interval: " << juce::String(timing.maxIntervalPercent, 0)
+         << "% of a block, worst callback: " << juce::String(timing.maxExecutionPercent, 0) << "%\n";
+    return text;
+}
+
+void MainComponent::exportCallbackTiming()
+{
+    chooser = std::make_unique<juce::FileChooser>("Export callback timing",
+        juce::File::getSpecialLocation(juce::File::userHomeDirectory).getChildFile("callback-timing.csv"),
+        "*.csv");
+
+    auto flags = juce::FileBrowserComponent::saveMode |
+        juce::FileBrowserComponent::warnAboutOverwriting;
+
+    chooser->launchAsync(flags, [this](const juce::FileChooser& fc)
+        {
+            auto result = fc.getResult();
+            if (result == juce::File{})
+                return;
+
+            if (!callbackMonitor.exportCsv(result))
+                juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon,
+                    "Error", "Could not write " + result.getFullPathName());
+        });
+}
+
+MainComponent::LatencyReport MainComponent::getLatencyReport()
+{
+    LatencyReport report;
+
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (device == nullptr)
+        return report;
+
+    report.sampleRate = device->getCurrentSampleRate();
+
+    auto chainBlockSize = blockAdapter.isActive() ? blockAdapter.getBlockSize()
+                                                  : device->getCurrentBufferSizeSamples();
+    auto chainLatency = getChain().getLatencySamples()
+        + getChain().getPipelineLatencyInBlocks() * chainBlockSize
+        + (blockAdapter.isActive() ? blockAdapter.getLatencySamples() : 0);
+
+    report.inputToOutputSamples = device->getInputLatencyInSamples()
+        + chainLatency
+        + device->getOutputLatencyInSamples();
+
+    // The monitor is fed straight from the input, ahead of the chain
+    report.inputToMonitorSamples = device->getInputLatencyInSamples();
+    if (monitorAudioSource != nullptr)
+        report.inputToMonitorSamples += monitorAudioSource->getNumBufferedSamples();
+    if (auto* monitorDevice = monitorDeviceManager.getCurrentAudioDevice())
+        report.inputToMonitorSamples += monitorDevice->getOutputLatencyInSamples();
+
+    return report;
+}
+
+void MainComponent::timerCallback()
+{
+    if (engineWindow != nullptr && engineWindow->isVisible())
+        engineOptionsComponent->setStatusText(getEngineStatusText());
+
+    auto report = getLatencyReport();
+    juce::String text;
+    text << "Latency in > out: " << report.inputToOutputSamples << " samples ("
+         << juce::String(report.toMilliseconds(report.inputToOutputSamples), 1) << " ms)";
+
+    if (monitoringEnabled)
+        text << "    in > monitor: " << report.inputToMonitorSamples << " samples ("
+             << juce::String(report.toMilliseconds(report.inputToMonitorSamples), 1) << " ms)";
+
+    if (isRestoring())
+        text = "Restoring plugins: " + juce::String(chainRestore->getNumDone()) + " of "
+             + juce::String(chainRestore->getNumSlots()) + "    " + text;
+
+    latencyLabel.setText(text, juce::dontSendNotification);
+
+    if (report.inputToOutputSamples != lastReportedLatency)
+    {
+        lastReportedLatency = report.inputToOutputSamples;
+        DBG("End-to-end latency: " << report.inputToOutputSamples << " samples, "
+            << report.toMilliseconds(report.inputToOutputSamples) << " ms");
+    }
+
+    // Threads report their effective policy as they pick it up
+    auto policy = realtimePolicy.getReport();
+    if (policy != lastLoggedPolicy)
+    {
+        lastLoggedPolicy = policy;
+        DBG("Effective real-time policy:\n" << policy);
+    }
+
+    for (auto& strip : strips)
+        strip->releaseIdlePipelines();
+
+    if (standbyLimitDeferred)
+    {
+        standbyLimitDeferred = false;
+        for (int i = 0; i < (int)strips.size(); ++i)
+            enforceStandbyLimit(i);
+    }
+
+    // Keeps the per-plugin timings current
+    pluginList.repaint();
+}
+
 void MainComponent::styleAudioSettings(juce::AudioDeviceSelectorComponent& selector)
 {
     const auto darkGrey = juce::Colour(40, 40, 40);
@@ -523,6 +1095,523 @@ void MainComponent::styleAudioSettings(juce::AudioDeviceSelectorComponent& selec
 }
 
 //==============================================================================
+void MainComponent::rebuildStrips()
+{
+    // A half-restored chain would be saved without its missing plugins
+    if (chainRestore != nullptr)
+    {
+        chainRestore->finishNow();
+        chainRestore = nullptr;
+    }
+
+    // Plugins still warming up belong to the old chains, and unsaved changes
+    // have to be on disk before the chains are restored again
+    warmup.finishAll();
+    autosaver.flush();
+
+    // Only while no device is calling back, or before it's attached
+    for (auto& strip : strips)
+    {
+        strip->forEachChain([](PluginChain& chain)
+        {
+            for (auto& plugin : chain.getPlugins())
+                if (plugin->editorWindow != nullptr)
+                    delete plugin->editorWindow.getComponent();
+
+            chain.setPlugins({});
+        });
+    }
+
+    strips.clear();
+
+    const auto numStrips = juce::jmax(1, engineOptions.numStrips);
+    const auto width = engineOptions.channelsPerStrip;
+
+    for (int i = 0; i < numStrips; ++i)
+    {
+        // A single strip keeps the original behaviour of taking every input
+        auto strip = numStrips == 1 ? std::make_unique<ChannelStrip>(0, 0)
+                                    : std::make_unique<ChannelStrip>(i * width, width);
+
+        strip->setChainSetup([this, i](PluginChain& chain, int scene)
+        {
+            chain.setThreadPool(&workerPool);
+            chain.setRealtimePolicy(&realtimePolicy);
+            chain.setWatchdog(&watchdog);
+            chain.setTileTuner(&tileTuner);
+            chain.setJournal(&journal, ChannelStrip::getChainId(i, scene));
+            chain.onPluginHung = [this, i, scene](int, const juce::String& report)
+            {
+                if (i == selectedStrip)
+                    pluginList.repaint();
+
+                autosaver.markChanged(i, scene);
+                juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon,
+                    "Plugin Bypassed", report + "\n\nRe-enable it from the plugin's menu to try again.");
+            };
+            chain.setPipelineSegments(engineOptions.pipelineSegments);
+
+            // Scenes added while the device runs miss audioDeviceAboutToStart()
+            chain.setTileSize(!blockAdapter.isActive() && engineOptions.pipelineSegments <= 1 ? engineOptions.tileSize : 0);
+        });
+
+        strips.push_back(std::move(strip));
+    }
+
+    // Scenes come back empty; the restore fills the ones that stay loaded
+    std::vector<StripScenes> savedScenes;
+    settings.loadScenes(savedScenes);
+
+    for (int i = 0; i < numStrips && i < (int)savedScenes.size(); ++i)
+    {
+        auto& strip = *strips[(size_t)i];
+        auto& names = savedScenes[(size_t)i].names;
+
+        for (int scene = 0; scene < names.size() && scene < ChannelStrip::maxScenes; ++scene)
+        {
+            if (names[scene].isEmpty())
+                continue;
+
+            if (scene == 0)
+                strip.renameScene(0, names[0]);
+            else
+                strip.addScene(names[scene], scene);
+        }
+
+        if (strip.isSceneInUse(savedScenes[(size_t)i].active))
+            strip.setActiveScene(savedScenes[(size_t)i].active);
+    }
+
+    builtChannelsPerStrip = width;
+    autosaver.reset();
+
+    stripSelector.clear(juce::dontSendNotification);
+    for (int i = 0; i < numStrips; ++i)
+        stripSelector.addItem(strips[(size_t)i]->getName(i), i + 1);
+    stripSelector.setVisible(numStrips > 1);
+
+    selectStrip(juce::jlimit(0, numStrips - 1, selectedStrip));
+
+    // Only the scenes that stay loaded are restored
+    for (int i = 0; i < numStrips; ++i)
+        enforceStandbyLimit(i);
+
+    startRestore();
+}
+
+void MainComponent::startRestore()
+{
+    // The setup outlives the device, so this also works while it's restarting
+    auto* device = deviceManager.getCurrentAudioDevice();
+    auto setup = deviceManager.getAudioDeviceSetup();
+    auto sampleRate = device != nullptr ? device->getCurrentSampleRate() : setup.sampleRate;
+    auto bufferSize = device != nullptr ? device->getCurrentBufferSizeSamples() : setup.bufferSize;
+
+    if (sampleRate <= 0.0 || bufferSize <= 0)
+    {
+        DBG("No audio device available for plugin loading");
+        return;
+    }
+
+    const auto progressive = engineOptions.progressiveRestore;
+    outputMuted = !progressive;
+    setChainEditingEnabled(false);
+
+    // A half-restored chain must not overwrite the saved one
+    autosaver.setPaused(true);
+
+    chainRestore = std::make_unique<ChainRestore>(settings, formatManager, scanCache, strips, sampleRate, bufferSize, progressive, engineOptions.warmupBlocks);
+    chainRestore->onProgress = [this] { pluginList.updateContent(); };
+    chainRestore->onFinished = [this]
+    {
+        outputMuted = false;
+        setChainEditingEnabled(true);
+        replayJournal();
+        autosaver.setPaused(false);
+        pluginList.updateContent();
+
+        if (fullChainMs < 0.0)
+        {
+            fullChainMs = juce::Time::getMillisecondCounterHiRes() - startupTime;
+            DBG("Startup: full chain after " << juce::String(fullChainMs, 0) << " ms, first audio "
+                << (firstAudioMs.load() < 0.0 ? juce::String("not yet")
+                                              : "after " + juce::String(firstAudioMs.load(), 0) + " ms"));
+        }
+    };
+}
+
+void MainComponent::replayJournal()
+{
+    // Changes made after the last save before the previous run ended. Setting
+    // them marks the plugins dirty, so the next autosave folds them into the
+    // snapshot and the journal can let go of them.
+    // Scenes left unloaded get theirs when they're loaded.
+    int numReplayed = 0;
+    for (int i = 0; i < (int)strips.size(); ++i)
+        for (int scene = 0; scene < ChannelStrip::maxScenes; ++scene)
+            if (strips[(size_t)i]->isSceneLoaded(scene))
+                numReplayed += replayJournal(i, scene);
+
+    if (numReplayed > 0)
+        DBG("Replayed " << numReplayed << " journaled parameter changes");
+}
+
+int MainComponent::replayJournal(int stripIndex, int scene)
+{
+    const auto chainId = ChannelStrip::getChainId(stripIndex, scene);
+
+    int numReplayed = 0;
+    for (auto& plugin : strips[(size_t)stripIndex]->getChain(scene).getPlugins())
+    {
+        if (plugin->processor == nullptr)
+            continue;
+
+        auto& parameters = plugin->processor->getParameters();
+        for (auto& record : journal.getReplayRecords(chainId, plugin->journalTag.load()))
+        {
+            if (auto* parameter = parameters[record.parameter])
+            {
+                parameter->setValueNotifyingHost(record.value);
+                ++numReplayed;
+            }
+        }
+    }
+
+    journal.finishReplay(chainId);
+    return numReplayed;
+}
+
+void MainComponent::setChainEditingEnabled(bool shouldBeEnabled)
+{
+    pluginList.setEnabled(shouldBeEnabled);
+    loadPluginButton.setEnabled(shouldBeEnabled);
+    saveButton.setEnabled(shouldBeEnabled);
+    sceneSelector.setEnabled(shouldBeEnabled);
+    sceneButton.setEnabled(shouldBeEnabled);
+}
+
+void MainComponent::selectStrip(int index)
+{
+    if (index < 0 || index >= (int)strips.size())
+        return;
+
+    selectedStrip = index;
+    stripSelector.setSelectedItemIndex(index, juce::dontSendNotification);
+    updateSceneSelector();
+    pluginList.deselectAllRows();
+    pluginList.updateContent();
+    pluginList.repaint();
+}
+
+void MainComponent::updateSceneSelector()
+{
+    auto& strip = *strips[(size_t)selectedStrip];
+
+    sceneSelector.clear(juce::dontSendNotification);
+    for (int scene = 0; scene < ChannelStrip::maxScenes; ++scene)
+        if (strip.isSceneInUse(scene))
+            sceneSelector.addItem(strip.getSceneName(scene)
+                + (strip.isSceneLoaded(scene) ? ""
+                   : loadingScenes.count(ChannelStrip::getChainId(selectedStrip, scene)) > 0 ? " (loading)"
+                   : " (unloaded)"), scene + 1);
+
+    sceneSelector.setSelectedId(strip.getActiveScene() + 1, juce::dontSendNotification);
+}
+
+void MainComponent::showSceneMenu()
+{
+    auto& strip = *strips[(size_t)selectedStrip];
+
+    int numScenes = 0;
+    for (int scene = 0; scene < ChannelStrip::maxScenes; ++scene)
+        if (strip.isSceneInUse(scene))
+            ++numScenes;
+
+    juce::PopupMenu menu;
+    menu.addItem(1, "New Scene...", numScenes < ChannelStrip::maxScenes);
+    menu.addItem(2, "Rename Scene...");
+    menu.addItem(3, "Remove Scene", strip.getActiveScene() != 0);
+
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(&sceneButton),
+        [this](int result)
+        {
+            if (result == 1)
+                addScene();
+            else if (result == 2)
+                renameScene();
+            else if (result == 3)
+                removeScene();
+        });
+}
+
+void MainComponent::switchScene(int scene, std::function<void()> onSwitched)
+{
+    auto& strip = *strips[(size_t)selectedStrip];
+    if (!strip.isSceneInUse(scene) || scene == strip.getActiveScene())
+    {
+        pendingSwitchScene = -1;
+        pendingSwitchDone = nullptr;
+
+        if (onSwitched)
+            onSwitched();
+        return;
+    }
+
+    // Standby scenes switch straight away; an unloaded one has to load first
+    if (!strip.isSceneLoaded(scene))
+    {
+        pendingSwitchStrip = selectedStrip;
+        pendingSwitchScene = scene;
+        pendingSwitchDone = std::move(onSwitched);
+
+        if (!loadScene(selectedStrip, scene))
+        {
+            pendingSwitchScene = -1;
+            pendingSwitchDone = nullptr;
+            juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon,
+                "Error", "Failed to load scene " + strip.getSceneName(scene));
+        }
+
+        updateSceneSelector();
+        return;
+    }
+
+    // Picking a scene that's ready overrides one still loading
+    pendingSwitchScene = -1;
+    pendingSwitchDone = nullptr;
+
+    // Editors only make sense for the chain the list shows
+    for (auto& plugin : getChain().getPlugins())
+    {
+        if (auto* window = plugin->editorWindow.getComponent())
+        {
+            window->setVisible(false);
+            delete window;
+        }
+    }
+
+    DBG("Switching strip " << selectedStrip + 1 << " to scene " << strip.getSceneName(scene));
+    strip.setActiveScene(scene);
+    enforceStandbyLimit(selectedStrip);
+    saveScenes();
+
+    updateSceneSelector();
+    pluginList.deselectAllRows();
+    pluginList.updateContent();
+    pluginList.repaint();
+
+    if (onSwitched)
+        onSwitched();
+}
+
+// Plugins are created here, since in-process ones have to be made on the
+// message thread, and warmed up on the warmup thread like any new plugin.
+// The scene is only filled once the last of them is back.
+bool MainComponent::loadScene(int stripIndex, int scene)
+{
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (device == nullptr)
+    {
+        DBG("No main audio device available");
+        return false;
+    }
+
+    const auto chainId = ChannelStrip::getChainId(stripIndex, scene);
+    if (loadingScenes.count(chainId) > 0)
+        return true;
+
+    auto& chain = strips[(size_t)stripIndex]->getChain(scene);
+    auto bufferSize = juce::jmax(device->getCurrentBufferSizeSamples(), chain.getMaximumBlockSize());
+
+    // A scene that was never saved simply comes back empty
+    std::vector<std::unique_ptr<PluginInstance>> plugins;
+    if (!settings.loadPluginState(plugins, formatManager, scanCache, device->getCurrentSampleRate(), bufferSize,
+            stripIndex, scene))
+        DBG("Nothing to load for scene " << scene << " of strip " << stripIndex + 1);
+
+    if (plugins.empty())
+    {
+        finishSceneLoad(stripIndex, scene, {});
+        return true;
+    }
+
+    loadingScenes.insert(chainId);
+
+    auto warmed = std::make_shared<std::vector<std::unique_ptr<PluginInstance>>>();
+    const auto numPlugins = plugins.size();
+
+    for (auto& plugin : plugins)
+    {
+        warmup.warmUp(std::move(plugin), device->getCurrentBufferSizeSamples(),
+            [this, stripIndex, scene, warmed, numPlugins](std::unique_ptr<PluginInstance> warm)
+            {
+                // They come back in the order they were handed in
+                warmed->push_back(std::move(warm));
+                if (warmed->size() == numPlugins)
+                    finishSceneLoad(stripIndex, scene, std::move(*warmed));
+            });
+    }
+
+    return true;
+}
+
+void MainComponent::finishSceneLoad(int stripIndex, int scene, std::vector<std::unique_ptr<PluginInstance>> plugins)
+{
+    loadingScenes.erase(ChannelStrip::getChainId(stripIndex, scene));
+
+    auto& strip = *strips[(size_t)stripIndex];
+    if (!strip.isSceneInUse(scene) || strip.isSceneLoaded(scene))
+    {
+        DBG("Scene " << scene << " of strip " << stripIndex + 1 << " changed while it loaded, dropping it");
+        return;
+    }
+
+    strip.getChain(scene).setPlugins(std::move(plugins));
+    strip.setSceneLoaded(scene, true);
+
+    // Tags come from the file's epoch, so changes from before a crash still match
+    if (auto numReplayed = replayJournal(stripIndex, scene))
+        DBG("Replayed " << numReplayed << " journaled parameter changes for scene " << scene);
+
+    if (pendingSwitchStrip == stripIndex && pendingSwitchScene == scene && selectedStrip == stripIndex)
+    {
+        pendingSwitchScene = -1;
+        switchScene(scene, std::move(pendingSwitchDone));
+        return;
+    }
+
+    // Nobody wants it any more; it stays as a standby scene
+    enforceStandbyLimit(stripIndex);
+    if (stripIndex == selectedStrip)
+        updateSceneSelector();
+}
+
+void MainComponent::addScene()
+{
+    auto* window = new juce::AlertWindow("New Scene", "Name of the new scene:", juce::AlertWindow::NoIcon);
+    window->addTextEditor("name", "Scene");
+    window->addButton("Create", 1, juce::KeyPress(juce::KeyPress::returnKey));
+    window->addButton("Cancel", 0, juce::KeyPress(juce::KeyPress::escapeKey));
+
+    window->enterModalState(true, juce::ModalCallbackFunction::create([this, window](int result)
+        {
+            auto name = window->getTextEditorContents("name").trim();
+            if (result == 0 || name.isEmpty())
+                return;
+
+            auto scene = strips[(size_t)selectedStrip]->addScene(name);
+            if (scene < 0)
+                return;
+
+            // New scenes start empty, ready to be built up
+            switchScene(scene);
+        }), true);
+}
+
+void MainComponent::renameScene()
+{
+    auto& strip = *strips[(size_t)selectedStrip];
+
+    auto* window = new juce::AlertWindow("Rename Scene", "New name for the scene:", juce::AlertWindow::NoIcon);
+    window->addTextEditor("name", strip.getSceneName(strip.getActiveScene()));
+    window->addButton("Rename", 1, juce::KeyPress(juce::KeyPress::returnKey));
+    window->addButton("Cancel", 0, juce::KeyPress(juce::KeyPress::escapeKey));
+
+    const auto scene = strip.getActiveScene();
+    window->enterModalState(true, juce::ModalCallbackFunction::create([this, window, scene](int result)
+        {
+            auto name = window->getTextEditorContents("name").trim();
+            if (result == 0 || name.isEmpty())
+                return;
+
+            strips[(size_t)selectedStrip]->renameScene(scene, name);
+            saveScenes();
+            updateSceneSelector();
+        }), true);
+}
+
+void MainComponent::removeScene()
+{
+    auto& strip = *strips[(size_t)selectedStrip];
+    const auto scene = strip.getActiveScene();
+    if (scene == 0)
+        return;
+
+    // The first scene always exists, so there's somewhere to go. It may have
+    // to load first, so the rest waits for the switch.
+    const auto stripIndex = selectedStrip;
+    switchScene(0, [this, stripIndex, scene]
+    {
+        auto& switched = *strips[(size_t)stripIndex];
+        if (switched.getActiveScene() == scene)
+            return;
+
+        switched.removeScene(scene);
+
+        // A save still being written would bring the file back
+        autosaver.flush();
+        settings.deletePluginState(stripIndex, scene);
+        saveScenes();
+
+        if (stripIndex == selectedStrip)
+            updateSceneSelector();
+    });
+}
+
+void MainComponent::enforceStandbyLimit(int stripIndex)
+{
+    auto& strip = *strips[(size_t)stripIndex];
+
+    // A scene switched away from keeps playing until its fade is over, so
+    // it's only counted once the timer finds it silent
+    std::vector<int> standby;
+    for (int scene = 0; scene < ChannelStrip::maxScenes; ++scene)
+    {
+        if (scene == strip.getActiveScene() || !strip.isSceneLoaded(scene))
+            continue;
+
+        if (strip.isSceneAudible(scene))
+            standbyLimitDeferred = true;
+        else
+            standby.push_back(scene);
+    }
+
+    if ((int)standby.size() <= engineOptions.maxStandbyScenes)
+        return;
+
+    // Most recently played first; the rest are unloaded
+    std::stable_sort(standby.begin(), standby.end(), [&strip](int a, int b)
+        { return strip.getSceneLastActive(a) > strip.getSceneLastActive(b); });
+
+    // Unloaded scenes come back from disk, so their changes have to be there
+    autosaver.flush();
+
+    for (size_t i = (size_t)engineOptions.maxStandbyScenes; i < standby.size(); ++i)
+    {
+        DBG("Unloading scene " << strip.getSceneName(standby[i]) << " of strip " << stripIndex + 1);
+        strip.unloadScene(standby[i]);
+    }
+
+    if (stripIndex == selectedStrip)
+        updateSceneSelector();
+}
+
+void MainComponent::saveScenes()
+{
+    std::vector<StripScenes> scenes(strips.size());
+
+    for (size_t i = 0; i < strips.size(); ++i)
+    {
+        for (int scene = 0; scene < ChannelStrip::maxScenes; ++scene)
+            scenes[i].names.add(strips[i]->getSceneName(scene));
+
+        scenes[i].active = strips[i]->getActiveScene();
+    }
+
+    if (!settings.saveScenes(scenes))
+        DBG("Failed to save scenes");
+}
+
 void MainComponent::changeListenerCallback(juce::ChangeBroadcaster*)
 {
     DBG("Audio settings changed, saving...");
@@ -531,25 +1620,32 @@ void MainComponent::changeListenerCallback(juce::ChangeBroadcaster*)
 
 void MainComponent::removePlugin(int index)
 {
-    if (index >= 0 && index < (int)plugins.size())
+    if (index >= 0 && index < getChain().size())
     {
-        plugins.erase(plugins.begin() + index);
+        getChain().removePlugin(index);
         pluginList.updateContent();
     }
 }
 
 void MainComponent::togglePluginWindow(int index)
 {
-    if (index >= 0 && index < (int)plugins.size())
+    if (auto* plugin = getChain().getPlugin(index))
     {
-        auto& plugin = plugins[index];
+        // Sandboxed plugins have no editor in this process
+        if (!plugin->processor->hasEditor())
+            return;
 
         if (!plugin->isEditorVisible)
         {
-            juce::MessageManager::callAsync([this, &plugin]()
+            juce::MessageManager::callAsync([this, plugin]()
                 {
+                    // The plugin may have been removed before this ran
+                    if (getChain().indexOf(plugin) < 0)
+                        return;
+
                     auto* window = new PluginEditorWindow(*plugin->processor, *plugin);
                     plugin->isEditorVisible = true;
+                    plugin->editorWindow = window;
                     window->setVisible(true);
                     pluginList.repaint();
                 });
@@ -579,10 +1675,15 @@ MainComponent::PluginEditorWindow::PluginEditorWindow(juce::AudioProcessor& proc
 void MainComponent::PluginEditorWindow::closeButtonPressed()
 {
     setVisible(false);
-    juce::MessageManager::callAsync([this]()
+    juce::Component::SafePointer<juce::DocumentWindow> safeThis(this);
+    juce::MessageManager::callAsync([safeThis]()
         {
-            ownerPlugin.isEditorVisible = false;
-            delete this;
+            // The chain deletes the window itself if the plugin is removed first
+            if (auto* window = safeThis.getComponent())
+            {
+                static_cast<PluginEditorWindow*>(window)->ownerPlugin.isEditorVisible = false;
+                delete window;
+            }
         });
 }
 
@@ -592,8 +1693,8 @@ void MainComponent::PluginEditorWindow::componentVisibilityChanged(juce::Compone
         ownerPlugin.isEditorVisible = false;
 }
 
-MainComponent::SettingsWindow::SettingsWindow()
-    : DocumentWindow("Audio Settings",
+MainComponent::SettingsWindow::SettingsWindow(const juce::String& title)
+    : DocumentWindow(title,
         juce::Colours::lightgrey,
         DocumentWindow::closeButton)
 {
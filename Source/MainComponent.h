@@ -2,13 +2,28 @@
 
 #include <JuceHeader.h>
 #include "PluginInstance.h"
+#include "PluginChain.h"
+#include "ChannelStrip.h"
+#include "ProcessingContext.h"
+#include "RealtimeThreadPool.h"
+#include "RealtimePolicy.h"
+#include "CallbackMonitor.h"
+#include "BlockAdapter.h"
+#include "ChainRestore.h"
+#include "ChainAutosaver.h"
+#include "PluginWarmup.h"
+#include "ChainTileTuner.h"
+#include "PluginDirectoryWatcher.h"
+#include "PluginBrowserComponent.h"
+#include "EngineOptionsComponent.h"
 #include "Settings.h"
 #include "MonitorAudioSource.h" // <--- Include the new audio source
 
 class MainComponent : public juce::AudioAppComponent,
     public juce::ListBoxModel,
     public juce::AudioIODeviceCallback,
-    public juce::ChangeListener
+    public juce::ChangeListener,
+    private juce::Timer
 {
 public:
     MainComponent();
@@ -46,6 +61,26 @@ public:
     // ChangeListener
     void changeListenerCallback(juce::ChangeBroadcaster*) override;
 
+    //==============================================================================
+    // Timer
+    void timerCallback() override;
+
+    //==============================================================================
+    // End-to-end latency, for lining up lip-sync offsets in streaming software
+    struct LatencyReport
+    {
+        int inputToOutputSamples = 0;
+        int inputToMonitorSamples = 0;
+        double sampleRate = 0.0;
+
+        double toMilliseconds(int samples) const
+        {
+            return sampleRate > 0.0 ? 1000.0 * samples / sampleRate : 0.0;
+        }
+    };
+
+    LatencyReport getLatencyReport();
+
 private:
     //==============================================================================
     // Plugin Editor Window (unchanged from your code)
@@ -62,11 +97,11 @@ private:
     };
 
     //==============================================================================
-    // Settings Window (unchanged)
+    // Settings Window, also used for the engine options
     class SettingsWindow : public juce::DocumentWindow
     {
     public:
-        SettingsWindow();
+        explicit SettingsWindow(const juce::String& title = "Audio Settings");
         void closeButtonPressed() override;
     private:
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SettingsWindow)
@@ -75,10 +110,41 @@ private:
     //==============================================================================
     // Private methods
     void loadPlugin();
+    void addPluginFromFile();
+    void addPlugin(const juce::PluginDescription& description);
     void showAudioSettings();
+    void showEngineOptions();
+    void applyEngineOptions();
+    void exportCallbackTiming();
+    void rebuildStrips();
+    void startRestore();
+    void replayJournal();
+    int replayJournal(int stripIndex, int scene);
+    bool isRestoring() const { return chainRestore != nullptr && !chainRestore->isFinished(); }
+    void setChainEditingEnabled(bool shouldBeEnabled);
+    void applyOutputFade(float** outputChannelData, int numOutputChannels, int numSamples) noexcept;
+    void selectStrip(int index);
+    void updateSceneSelector();
+    void showSceneMenu();
+    // An unloaded scene is loaded first, and switched to once its plugins are
+    // warm, if nothing else has been picked by then. onSwitched follows the switch.
+    void switchScene(int scene, std::function<void()> onSwitched = nullptr);
+    bool loadScene(int stripIndex, int scene);
+    void finishSceneLoad(int stripIndex, int scene, std::vector<std::unique_ptr<PluginInstance>> plugins);
+    void addScene();
+    void renameScene();
+    void removeScene();
+    void enforceStandbyLimit(int stripIndex);
+    void saveScenes();
+    PluginChain& getChain() { return strips[(size_t)selectedStrip]->getChain(); }
+    juce::String getEngineStatusText();
     void removePlugin(int index);
     void togglePluginWindow(int index);
     void deleteSelectedPlugin();
+    void moveSelectedPlugin(int delta);
+    void toggleSelectedPluginParallel();
+    void toggleSelectedPluginBypass();
+    void toggleSelectedPluginSandbox();
     void styleAudioSettings(juce::AudioDeviceSelectorComponent& selector);
 
     //==============================================================================
@@ -86,18 +152,93 @@ private:
 
     // Audio + plugin stuff
     Settings settings;
+    EngineOptions engineOptions;
     std::unique_ptr<juce::FileChooser> chooser;
     juce::AudioPluginFormatManager formatManager;
-    juce::AudioBuffer<float> tempBuffer;
-    std::vector<std::unique_ptr<PluginInstance>> plugins;
+    PluginScanCache scanCache;
+    PluginDirectoryWatcher directoryWatcher { scanCache };
+    RealtimePolicy realtimePolicy;
+    PluginWatchdog watchdog;
+    ParameterJournal journal;
+    PluginWarmup warmup;
+    ChainTileTuner tileTuner { formatManager, scanCache };
+    RealtimeThreadPool workerPool { juce::jlimit(0, 7, juce::SystemStats::getNumCpus() - 1) };
+
+    // Runs one strip per job index over the current slice of the device block
+    struct StripJob : public RealtimeThreadPool::Job
+    {
+        explicit StripJob(MainComponent& ownerToUse) : owner(ownerToUse) {}
+        void run(int index) noexcept override;
+
+        MainComponent& owner;
+        const float** inputChannelData = nullptr;
+        int numInputChannels = 0;
+        int offset = 0;
+        int numSamples = 0;
+
+        // The whole device callback, which sandboxed plugins on every strip
+        // have to answer within
+        juce::int64 callbackStartTicks = 0;
+        int callbackSamples = 0;
+    };
+
+    // Only replaced while the device is stopped. The list edits the selected one.
+    std::vector<std::unique_ptr<ChannelStrip>> strips;
+    StripJob stripJob { *this };
+    int selectedStrip = 0;
+    bool standbyLimitDeferred = false;
+
+    // Scenes whose plugins are warming up, by chain id, and the one to switch
+    // to once it's ready
+    std::set<int> loadingScenes;
+    int pendingSwitchStrip = -1;
+    int pendingSwitchScene = -1;
+    std::function<void()> pendingSwitchDone;
+    int builtChannelsPerStrip = 0;
+
+    // What the running device was prepared with, to tell which option changes
+    // need a restart
+    EngineOptions startedOptions;
+    double deviceSampleRate = 0.0;
+    CallbackMonitor callbackMonitor;
+    BlockAdapter blockAdapter;
+
+    // Loads the saved chains in the background; refers to the strips above
+    std::unique_ptr<ChainRestore> chainRestore;
+
+    // Saves the chains above as they change
+    ChainAutosaver autosaver { settings, strips };
+
+    // Output fade, so audio comes in smoothly once a restore allows it. The
+    // gain belongs to the audio thread.
+    std::atomic<bool> outputMuted { false };
+    float outputGain = 0.0f;
+    float outputGainStepPerSample = 1.0f;
+
+    // Startup timings in ms since the component was created
+    double startupTime = 0.0;
+    std::atomic<double> firstAudioMs { -1.0 };
+    double fullChainMs = -1.0;
+
+    static constexpr double outputFadeSeconds = 0.05;
 
     // UI
     juce::TextButton loadPluginButton;
     juce::TextButton settingsButton;
     juce::TextButton saveButton;
+    juce::TextButton engineButton;
+    juce::ComboBox stripSelector;
+    juce::ComboBox sceneSelector;
+    juce::TextButton sceneButton;
     juce::ListBox pluginList;
+    juce::Label latencyLabel;
+    int lastReportedLatency = -1;
+    juce::String lastLoggedPolicy;
     std::unique_ptr<juce::AudioDeviceSelectorComponent> audioSettings;
     std::unique_ptr<SettingsWindow> settingsWindow;
+    std::unique_ptr<SettingsWindow> engineWindow;
+    std::unique_ptr<SettingsWindow> pluginBrowserWindow;
+    EngineOptionsComponent* engineOptionsComponent = nullptr;
 
     //==============================================================================
     // Monitoring via AudioSource
@@ -1,5 +1,6 @@
 #pragma once
 #include <JuceHeader.h>
+#include "AudioMemoryLock.h"
 
 // A simple AudioSource that stores incoming audio in a lock-free FIFO.
 // We'll read from it on the monitor device side.
@@ -11,6 +12,7 @@ public:
     {
         // For safety, 2 channels of stereo, 32768 samples
         buffer.setSize (2, 32768);
+        memoryLock.add (buffer);
     }
 
     // Writer: called by the main device callback
@@ -45,6 +47,12 @@ public:
         fifo.finishedWrite (size1 + size2);
     }
 
+    // Samples written but not yet played, i.e. the FIFO's share of the monitor latency
+    int getNumBufferedSamples() const
+    {
+        return fifo.getNumReady();
+    }
+
     //==============================================================================
     // AudioSource overrides
     void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override
@@ -96,6 +104,7 @@ public:
 private:
     juce::AudioSampleBuffer buffer;
     juce::AbstractFifo fifo;
+    AudioMemoryLock::Regions memoryLock;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MonitorAudioSource)
 };
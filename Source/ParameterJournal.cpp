@@ -0,0 +1,325 @@
+#include "ParameterJournal.h"
+
+namespace
+{
+    const char magic[4] = { 'V', 'M', 'P', 'J' };
+    const int headerSize = 8;
+    const juce::uint32 journalVersion = 1;
+
+    // Epochs count tenths of a second from here, so they keep increasing
+    // across runs without having to be stored anywhere but the snapshots
+    const juce::int64 epochOrigin = 1577836800000; // 2020-01-01
+
+    void writeRecord(juce::OutputStream& out, const ParameterJournal::Record& record)
+    {
+        out.writeShort((short)record.strip);
+        out.writeShort((short)record.slot);
+        out.writeInt((int)record.epoch);
+        out.writeInt(record.parameter);
+        out.writeFloat(record.value);
+    }
+}
+
+ParameterJournal::ParameterJournal()
+    : juce::Thread("Parameter Journal")
+{
+    auto appDataDir = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("VSTMIC");
+    appDataDir.createDirectory();
+    journalFile = appDataDir.getChildFile("parameters.journal");
+
+    cells.reset(new Cell[queueSize]);
+    for (size_t i = 0; i < queueSize; ++i)
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+
+    load();
+    compact();
+
+    startThread();
+}
+
+ParameterJournal::~ParameterJournal()
+{
+    stopThread(1000);
+    drain();
+}
+
+//==============================================================================
+void ParameterJournal::record(int strip, juce::uint64 tag, int parameter, float value) noexcept
+{
+    if (tag == 0)
+        return;
+
+    Record record;
+    record.strip = (juce::uint16)strip;
+    record.slot = (juce::uint16)((tag & 0xffff) - 1);
+    record.epoch = (juce::uint32)(tag >> 32);
+    record.parameter = parameter;
+    record.value = value;
+
+    // The plugin is marked dirty as well, so a dropped change is still saved
+    if (!push(record))
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+juce::uint32 ParameterJournal::beginEpoch()
+{
+    auto now = (juce::uint32)((juce::Time::currentTimeMillis() - epochOrigin) / 100);
+    lastEpoch = juce::jmax(lastEpoch + 1, now);
+    return lastEpoch;
+}
+
+void ParameterJournal::snapshotWritten(int strip, juce::uint32 epoch, juce::uint64 capturedAt,
+    std::vector<juce::uint64> previousTags)
+{
+    const juce::ScopedLock sl(snapshotLock);
+    writtenSnapshots.push_back({ strip, epoch, capturedAt, std::move(previousTags) });
+}
+
+std::vector<ParameterJournal::Record> ParameterJournal::getReplayRecords(int strip, juce::uint64 tag) const
+{
+    std::vector<Record> records;
+    for (auto& record : replayRecords)
+        if (record.strip == strip && makeTag(record.epoch, record.slot) == tag)
+            records.push_back(record);
+    return records;
+}
+
+void ParameterJournal::finishReplay(int strip)
+{
+    replayRecords.erase(std::remove_if(replayRecords.begin(), replayRecords.end(),
+        [strip](const Record& record) { return record.strip == strip; }), replayRecords.end());
+}
+
+//==============================================================================
+bool ParameterJournal::push(const Record& record) noexcept
+{
+    auto position = enqueuePosition.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+        auto& cell = cells[position & (queueSize - 1)];
+        auto sequence = cell.sequence.load(std::memory_order_acquire);
+        auto difference = (std::ptrdiff_t)sequence - (std::ptrdiff_t)position;
+
+        if (difference == 0)
+        {
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                cell.record = record;
+                cell.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (difference < 0)
+        {
+            return false;
+        }
+        else
+        {
+            position = enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool ParameterJournal::pop(Record& record) noexcept
+{
+    auto& cell = cells[dequeuePosition & (queueSize - 1)];
+    auto sequence = cell.sequence.load(std::memory_order_acquire);
+    if ((std::ptrdiff_t)sequence - (std::ptrdiff_t)(dequeuePosition + 1) < 0)
+        return false;
+
+    record = cell.record;
+    cell.sequence.store(dequeuePosition + queueSize, std::memory_order_release);
+    ++dequeuePosition;
+    return true;
+}
+
+//==============================================================================
+void ParameterJournal::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(drainIntervalMs);
+        drain();
+
+        std::vector<WrittenSnapshot> written;
+        {
+            const juce::ScopedLock sl(snapshotLock);
+            written.swap(writtenSnapshots);
+        }
+
+        if (written.empty())
+            continue;
+
+        for (auto& snapshot : written)
+            supersede(snapshot);
+
+        compact();
+    }
+}
+
+void ParameterJournal::drain()
+{
+    Record record;
+    int numWritten = 0;
+
+    while (pop(record))
+    {
+        retag(record);
+        latest[Key(record.strip, record.epoch, record.slot, record.parameter)] = { record.value, (juce::uint64)dequeuePosition };
+
+        if (output != nullptr)
+            writeRecord(*output, record);
+        ++numWritten;
+    }
+
+    // Into the OS, so it survives the process going down
+    if (numWritten > 0 && output != nullptr)
+        output->flush();
+}
+
+// Records from before the capture are in the snapshot and can go. Later ones
+// follow their plugin to its slot in the snapshot, unless it's no longer in it.
+void ParameterJournal::supersede(const WrittenSnapshot& snapshot)
+{
+    for (auto it = newerTags.begin(); it != newerTags.end();)
+        it = it->first.first == snapshot.strip ? newerTags.erase(it) : std::next(it);
+
+    for (size_t slot = 0; slot < snapshot.previousTags.size(); ++slot)
+        if (snapshot.previousTags[slot] != 0)
+            newerTags[{ snapshot.strip, snapshot.previousTags[slot] }] = makeTag(snapshot.epoch, (int)slot);
+
+    for (auto it = latest.begin(); it != latest.end();)
+    {
+        if (std::get<0>(it->first) != snapshot.strip || std::get<1>(it->first) >= snapshot.epoch)
+        {
+            ++it;
+            continue;
+        }
+
+        if (it->second.sequence >= snapshot.capturedAt)
+        {
+            Record record;
+            record.strip = (juce::uint16)snapshot.strip;
+            record.epoch = std::get<1>(it->first);
+            record.slot = (juce::uint16)std::get<2>(it->first);
+            record.parameter = std::get<3>(it->first);
+            record.value = it->second.value;
+
+            retag(record);
+            if (record.epoch == snapshot.epoch)
+            {
+                // The new slot may already hold something newer, straight from the queue
+                auto& target = latest[Key(record.strip, record.epoch, record.slot, record.parameter)];
+                if (it->second.sequence > target.sequence)
+                    target = it->second;
+            }
+        }
+
+        it = latest.erase(it);
+    }
+}
+
+void ParameterJournal::retag(Record& record) const
+{
+    auto newer = newerTags.find({ (int)record.strip, makeTag(record.epoch, record.slot) });
+    if (newer == newerTags.end())
+        return;
+
+    record.epoch = (juce::uint32)(newer->second >> 32);
+    record.slot = (juce::uint16)((newer->second & 0xffff) - 1);
+}
+
+void ParameterJournal::load()
+{
+    juce::MemoryBlock data;
+    if (!journalFile.existsAsFile() || !journalFile.loadFileAsData(data))
+        return;
+
+    if (data.getSize() < (size_t)headerSize || std::memcmp(data.getData(), magic, sizeof(magic)) != 0
+        || juce::ByteOrder::littleEndianInt(static_cast<const char*>(data.getData()) + 4) != journalVersion)
+    {
+        DBG("Ignoring unreadable parameter journal");
+        return;
+    }
+
+    // A record cut short by a crash is simply left out
+    juce::MemoryInputStream in(data, false);
+    in.setPosition(headerSize);
+
+    while (in.getNumBytesRemaining() >= recordSize)
+    {
+        Record record;
+        record.strip = (juce::uint16)in.readShort();
+        record.slot = (juce::uint16)in.readShort();
+        record.epoch = (juce::uint32)in.readInt();
+        record.parameter = in.readInt();
+        record.value = in.readFloat();
+
+        latest[Key(record.strip, record.epoch, record.slot, record.parameter)] = { record.value, 0 };
+        lastEpoch = juce::jmax(lastEpoch, record.epoch);
+    }
+
+    for (auto& entry : latest)
+    {
+        Record record;
+        record.strip = (juce::uint16)std::get<0>(entry.first);
+        record.epoch = std::get<1>(entry.first);
+        record.slot = (juce::uint16)std::get<2>(entry.first);
+        record.parameter = std::get<3>(entry.first);
+        record.value = entry.second.value;
+        replayRecords.push_back(record);
+    }
+
+    DBG("Parameter journal: " << (int)replayRecords.size() << " changes to replay");
+}
+
+void ParameterJournal::compact()
+{
+    output = nullptr;
+
+    juce::TemporaryFile temp(journalFile);
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (out.failedToOpen())
+        {
+            DBG("Failed to compact parameter journal");
+            openForAppend();
+            return;
+        }
+
+        out.write(magic, sizeof(magic));
+        out.writeInt((int)journalVersion);
+
+        for (auto& entry : latest)
+        {
+            Record record;
+            record.strip = (juce::uint16)std::get<0>(entry.first);
+            record.epoch = std::get<1>(entry.first);
+            record.slot = (juce::uint16)std::get<2>(entry.first);
+            record.parameter = std::get<3>(entry.first);
+            record.value = entry.second.value;
+            writeRecord(out, record);
+        }
+    }
+
+    if (!temp.overwriteTargetFileWithTemporary())
+        DBG("Failed to replace parameter journal");
+
+    openForAppend();
+}
+
+bool ParameterJournal::openForAppend()
+{
+    // FileOutputStream appends to an existing file
+    output = std::make_unique<juce::FileOutputStream>(journalFile);
+    if (output->failedToOpen())
+    {
+        DBG("Failed to open parameter journal");
+        output = nullptr;
+        return false;
+    }
+
+    return true;
+}
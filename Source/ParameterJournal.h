@@ -0,0 +1,138 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Append-only log of parameter changes, so tweaks made since the last chain
+// save survive a crash. Each record is strip, slot, snapshot epoch, parameter
+// index and value, 16 bytes in parameters.journal next to the other settings.
+//
+// "Strip" here is the chain id, which also covers the scenes of a strip.
+// A slot is a plugin's position in the saved snapshot of its strip, and every
+// snapshot gets a new epoch, which is stored in the snapshot file. A plugin
+// carries the tag of the last snapshot of it known to be on disk, so its
+// records keep pointing at the right slot even if the chain has been
+// rearranged since. Plugins that haven't been saved yet aren't journaled;
+// the next save picks them up.
+//
+// record() is safe on any thread, including the audio thread: it's a few
+// atomics and a copy into a lock-free queue. The journal thread drains the
+// queue into the file every few milliseconds. When a new snapshot of a strip
+// is on disk, the records it supersedes are dropped and the file is rewritten
+// with only the latest value of each remaining parameter.
+//
+// A snapshot only supersedes records queued before it was captured. Changes
+// made after that still carry the plugin's old tag, at least until the
+// message thread gets round to tagging it afresh. They're kept and moved over
+// to the plugin's slot in the new snapshot, and so are any that arrive under
+// the old tag later on.
+//
+// At startup the records left in the file are read back; once the chains are
+// restored, getReplayRecords() hands out those matching each plugin's tag.
+// Records of a scene that isn't loaded wait until it is.
+class ParameterJournal : private juce::Thread
+{
+public:
+    struct Record
+    {
+        juce::uint16 strip = 0;
+        juce::uint16 slot = 0;
+        juce::uint32 epoch = 0;
+        juce::int32 parameter = 0;
+        float value = 0.0f;
+    };
+
+    ParameterJournal();
+    ~ParameterJournal() override;
+
+    // Tags as stored on plugins; 0 means not journaled
+    static juce::uint64 makeTag(juce::uint32 epoch, int slot) noexcept
+    {
+        return ((juce::uint64)epoch << 32) | (juce::uint64)(slot + 1);
+    }
+
+    // Any thread. Drops the change if the plugin has no tag or the queue is full.
+    void record(int strip, juce::uint64 tag, int parameter, float value) noexcept;
+
+    // Message thread. A fresh epoch for a snapshot about to be captured.
+    juce::uint32 beginEpoch();
+
+    // Message thread, just before a snapshot is captured. Records queued from
+    // here on may not be in it.
+    juce::uint64 getCaptureSequence() const noexcept { return enqueuePosition.load() + 1; }
+
+    // Any thread. The snapshot of the strip with this epoch, captured at the
+    // given sequence, is on disk. previousTags holds the tag each of its slots'
+    // plugins carried when it was captured.
+    void snapshotWritten(int strip, juce::uint32 epoch, juce::uint64 capturedAt,
+        std::vector<juce::uint64> previousTags);
+
+    // Message thread. Records read at startup for the plugin with this tag,
+    // kept until the strip's chain has been replayed.
+    std::vector<Record> getReplayRecords(int strip, juce::uint64 tag) const;
+    void finishReplay(int strip);
+
+    juce::uint64 getNumDropped() const { return numDropped.load(); }
+
+private:
+    using Key = std::tuple<int, juce::uint32, int, int>;
+
+    // A value and the sequence of the record it came from, counting queue
+    // positions from 1. Records read back at startup have sequence 0.
+    struct Value
+    {
+        float value = 0.0f;
+        juce::uint64 sequence = 0;
+    };
+
+    struct WrittenSnapshot
+    {
+        int strip = 0;
+        juce::uint32 epoch = 0;
+        juce::uint64 capturedAt = 0;
+        std::vector<juce::uint64> previousTags;
+    };
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence { 0 };
+        Record record;
+    };
+
+    bool push(const Record& record) noexcept;
+    bool pop(Record& record) noexcept;
+
+    void run() override;
+    void load();
+    void drain();
+    void supersede(const WrittenSnapshot& snapshot);
+    void retag(Record& record) const;
+    void compact();
+    bool openForAppend();
+
+    juce::File journalFile;
+    std::unique_ptr<juce::FileOutputStream> output;
+
+    // Latest value of every journaled parameter; the file compacts down to this
+    std::map<Key, Value> latest;
+
+    // Journal thread. Old tags of plugins in each strip's newest snapshot on
+    // disk, and the tag of their slot in it.
+    std::map<std::pair<int, juce::uint64>, juce::uint64> newerTags;
+    std::vector<Record> replayRecords;
+
+    // Bounded multi-producer queue, drained by the journal thread
+    std::unique_ptr<Cell[]> cells;
+    std::atomic<size_t> enqueuePosition { 0 };
+    size_t dequeuePosition = 0;
+    std::atomic<juce::uint64> numDropped { 0 };
+
+    juce::CriticalSection snapshotLock;
+    std::vector<WrittenSnapshot> writtenSnapshots;
+
+    juce::uint32 lastEpoch = 0;
+
+    static constexpr size_t queueSize = 8192;
+    static constexpr int drainIntervalMs = 20;
+    static constexpr int recordSize = 16;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParameterJournal)
+};
@@ -0,0 +1,149 @@
+#include "PluginBrowserComponent.h"
+
+PluginBrowserComponent::PluginBrowserComponent(PluginScanCache& scanCacheToUse)
+    : scanCache(scanCacheToUse)
+{
+    const auto whitish = juce::Colour(230, 230, 230);
+
+    searchBox.setTextToShowWhenEmpty("Search name, manufacturer, category or tag", juce::Colour(120, 120, 120));
+    searchBox.setColour(juce::TextEditor::backgroundColourId, juce::Colour(30, 30, 30));
+    searchBox.setColour(juce::TextEditor::textColourId, whitish);
+    searchBox.setColour(juce::TextEditor::outlineColourId, juce::Colour(60, 60, 60));
+    searchBox.onTextChange = [this] { updateResults(); };
+    searchBox.onReturnKey = [this] { chooseRow(juce::jmax(0, resultList.getSelectedRow())); };
+    addAndMakeVisible(searchBox);
+
+    resultList.setModel(this);
+    resultList.setRowHeight(40);
+    resultList.setColour(juce::ListBox::backgroundColourId, juce::Colour(45, 45, 45));
+    addAndMakeVisible(resultList);
+
+    statusLabel.setColour(juce::Label::textColourId, juce::Colour(150, 150, 150));
+    addAndMakeVisible(statusLabel);
+
+    addButton.onClick = [this] { chooseRow(resultList.getSelectedRow()); };
+    addAndMakeVisible(addButton);
+
+    browseButton.onClick = [this]
+    {
+        if (onBrowseForFile)
+            onBrowseForFile();
+    };
+    addAndMakeVisible(browseButton);
+
+    scanCache.getChangeBroadcaster().addChangeListener(this);
+    rebuildIndex();
+}
+
+PluginBrowserComponent::~PluginBrowserComponent()
+{
+    scanCache.getChangeBroadcaster().removeChangeListener(this);
+}
+
+void PluginBrowserComponent::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colour(40, 40, 40));
+}
+
+void PluginBrowserComponent::resized()
+{
+    auto area = getLocalBounds().reduced(10);
+
+    searchBox.setBounds(area.removeFromTop(28));
+    area.removeFromTop(8);
+
+    auto buttons = area.removeFromBottom(28);
+    browseButton.setBounds(buttons.removeFromRight(110));
+    buttons.removeFromRight(10);
+    addButton.setBounds(buttons.removeFromRight(80));
+    statusLabel.setBounds(buttons);
+
+    area.removeFromBottom(8);
+    resultList.setBounds(area);
+}
+
+void PluginBrowserComponent::visibilityChanged()
+{
+    if (isShowing())
+        searchBox.grabKeyboardFocus();
+}
+
+//==============================================================================
+int PluginBrowserComponent::getNumRows()
+{
+    return (int)results.size();
+}
+
+void PluginBrowserComponent::paintListBoxItem(int rowNumber, juce::Graphics& g,
+    int width, int height, bool rowIsSelected)
+{
+    if (rowNumber < 0 || rowNumber >= (int)results.size())
+        return;
+
+    g.fillAll(rowIsSelected ? juce::Colour(70, 70, 70) : juce::Colour(45, 45, 45));
+    g.setColour(juce::Colour(35, 35, 35));
+    g.drawLine(0, (float)height, (float)width, (float)height, 1.0f);
+
+    const auto& description = index.getDescription(results[(size_t)rowNumber]);
+    auto bounds = juce::Rectangle<int>(0, 0, width, height).reduced(8, 4);
+
+    g.setColour(juce::Colour(230, 230, 230));
+    g.setFont(15.0f);
+    g.drawText(description.name, bounds.removeFromTop(bounds.getHeight() / 2), juce::Justification::centredLeft);
+
+    juce::String details = description.manufacturerName;
+    if (description.category.isNotEmpty())
+        details << "  -  " << description.category.replace("|", ", ");
+
+    g.setColour(juce::Colour(150, 150, 150));
+    g.setFont(12.0f);
+    g.drawText(details, bounds, juce::Justification::centredLeft);
+}
+
+void PluginBrowserComponent::listBoxItemDoubleClicked(int row, const juce::MouseEvent&)
+{
+    chooseRow(row);
+}
+
+void PluginBrowserComponent::returnKeyPressed(int lastRowSelected)
+{
+    chooseRow(lastRowSelected);
+}
+
+void PluginBrowserComponent::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    // The watcher found new or changed plugins
+    rebuildIndex();
+}
+
+//==============================================================================
+void PluginBrowserComponent::rebuildIndex()
+{
+    index.rebuild(scanCache.getKnownTypes());
+    updateResults();
+}
+
+void PluginBrowserComponent::updateResults()
+{
+    const auto start = juce::Time::getHighResolutionTicks();
+    index.search(searchBox.getText(), results);
+    const auto elapsedMs = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0;
+
+    resultList.updateContent();
+    resultList.selectRow(0);
+    resultList.repaint();
+
+    statusLabel.setText(juce::String((int)results.size()) + " of " + juce::String(index.size())
+        + " plugins (" + juce::String(elapsedMs, 2) + " ms)", juce::dontSendNotification);
+}
+
+void PluginBrowserComponent::chooseRow(int row)
+{
+    if (row < 0 || row >= (int)results.size())
+        return;
+
+    // Copied, since the index may be rebuilt while the plugin loads
+    auto description = index.getDescription(results[(size_t)row]);
+    if (onPluginChosen)
+        onPluginChosen(description);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PluginIndex.h"
+#include "PluginScanCache.h"
+
+// Picks a plugin to add from everything the scan cache knows about. The list
+// filters as you type; the ListBox only paints the rows in view, so the whole
+// library scrolls smoothly. Plugins the cache hasn't seen yet can still be
+// added from a file, as before.
+class PluginBrowserComponent : public juce::Component,
+    private juce::ListBoxModel,
+    private juce::ChangeListener
+{
+public:
+    explicit PluginBrowserComponent(PluginScanCache& scanCache);
+    ~PluginBrowserComponent() override;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+    void visibilityChanged() override;
+
+    std::function<void(const juce::PluginDescription&)> onPluginChosen;
+    std::function<void()> onBrowseForFile;
+
+private:
+    int getNumRows() override;
+    void paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected) override;
+    void listBoxItemDoubleClicked(int row, const juce::MouseEvent&) override;
+    void returnKeyPressed(int lastRowSelected) override;
+    void changeListenerCallback(juce::ChangeBroadcaster*) override;
+
+    void rebuildIndex();
+    void updateResults();
+    void chooseRow(int row);
+
+    PluginScanCache& scanCache;
+    PluginIndex index;
+    std::vector<int> results;
+
+    juce::TextEditor searchBox;
+    juce::ListBox resultList;
+    juce::Label statusLabel;
+    juce::TextButton addButton { "Add" };
+    juce::TextButton browseButton { "From File..." };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginBrowserComponent)
+};
@@ -0,0 +1,1080 @@
+#include "PluginChain.h"
+#include "RealtimeAllocationCheck.h"
+#include "ChainTileTuner.h"
+#include <limits>
+#include <map>
+#include <thread>
+
+//==============================================================================
+PluginChain::Reclaimer::Reclaimer(PluginChain& owner)
+    : juce::Thread("Chain Reclaimer"),
+    chain(owner)
+{
+    startThread();
+}
+
+PluginChain::Reclaimer::~Reclaimer()
+{
+    stopThread(2000);
+    reclaim(true);
+}
+
+void PluginChain::Reclaimer::retire(std::unique_ptr<ChainSnapshot> snapshot,
+    std::vector<std::unique_ptr<PluginInstance>> retiredPlugins)
+{
+    Entry entry;
+    entry.snapshot = std::move(snapshot);
+    entry.plugins = std::move(retiredPlugins);
+
+    // Any block that loaded the old snapshot has either finished already or
+    // finishes by bumping the counter past this value.
+    entry.epoch = chain.completedBlocks.load();
+
+    const juce::ScopedLock sl(lock);
+    entries.push_back(std::move(entry));
+    notify();
+}
+
+void PluginChain::Reclaimer::run()
+{
+    while (!threadShouldExit())
+    {
+        reclaim(false);
+        wait(20);
+    }
+}
+
+void PluginChain::Reclaimer::reclaim(bool force)
+{
+    std::vector<Entry> expired;
+
+    {
+        const juce::ScopedLock sl(lock);
+        const bool audioStopped = !chain.audioRunning.load();
+        const auto blocks = chain.completedBlocks.load();
+
+        // Entries are freed strictly in order, so a plugin is never destroyed
+        // while an older snapshot that references it is still alive.
+        size_t numExpired = 0;
+        while (numExpired < entries.size())
+        {
+            auto& entry = entries[numExpired];
+            // Blocks still in the pipeline hold on to their snapshot even
+            // after audio has stopped, until the pipeline lets go of them
+            const bool inPipeline = entry.snapshot != nullptr && entry.snapshot->pipelineRefs.load() > 0;
+
+            if (!(force || ((audioStopped || blocks > entry.epoch) && !inPipeline)))
+                break;
+
+            ++numExpired;
+        }
+
+        for (size_t i = 0; i < numExpired; ++i)
+            expired.push_back(std::move(entries[i]));
+
+        entries.erase(entries.begin(), entries.begin() + (std::ptrdiff_t)numExpired);
+    }
+
+    for (auto& entry : expired)
+    {
+        for (auto& plugin : entry.plugins)
+        {
+            if (plugin != nullptr && plugin->processor != nullptr)
+            {
+                DBG("Reclaiming plugin: " << plugin->processor->getName());
+                plugin->processor->releaseResources();
+            }
+        }
+    }
+}
+
+//==============================================================================
+PluginChain::PluginChain()
+    : reclaimer(*this)
+{
+    publish();
+}
+
+PluginChain::~PluginChain()
+{
+    stopTimer();
+
+    if (tileTuner != nullptr)
+        tileTuner->forget(*this);
+    audioRunning = false;
+
+    // The segment workers have to be gone before their snapshots are
+    pipeline.reset();
+
+    // Audio has been stopped by now, so whatever is left can go right away.
+    std::unique_ptr<ChainSnapshot> last(currentSnapshot.exchange(nullptr));
+    std::vector<std::unique_ptr<PluginInstance>> remaining;
+    for (auto& removal : pendingRemovals)
+        remaining.push_back(std::move(removal.plugin));
+    for (auto& plugin : plugins)
+        remaining.push_back(std::move(plugin));
+
+    for (auto& plugin : remaining)
+        stopListening(*plugin);
+
+    pendingRemovals.clear();
+    plugins.clear();
+    reclaimer.retire(std::move(last), std::move(remaining));
+}
+
+//==============================================================================
+void PluginChain::prepare(double sampleRate, int maximumBlockSize, int numChannels)
+{
+    currentSampleRate = sampleRate;
+    currentBlockSize = maximumBlockSize;
+    currentNumChannels = numChannels;
+
+    pipeline.reset();
+    if (pipelineSegments > 1 && pipelineActive)
+        pipeline = std::make_unique<ChainPipeline>(*this, pipelineSegments, numChannels, maximumBlockSize);
+
+    gainStepPerSample = sampleRate > 0.0 ? (float)(1.0 / (fadeTimeSeconds * sampleRate)) : 1.0f;
+    microsPerSample = sampleRate > 0.0 ? (float)(1.0e6 / sampleRate) : 0.0f;
+
+    for (auto& plugin : plugins)
+    {
+        if (plugin && plugin->processor)
+        {
+            plugin->processor->prepareToPlay(sampleRate, maximumBlockSize);
+            plugin->prepareBuffers(numChannels, maximumBlockSize);
+            DBG("Prepared plugin: " << plugin->processor->getName());
+        }
+    }
+
+    // Branch buffers live in the snapshot, so rebuild it at the new size
+    resetDelayLines = true;
+    publish();
+    requestTuning();
+    audioRunning = true;
+    startTimerHz(20);
+}
+
+void PluginChain::release()
+{
+    // Segment workers may still be inside a plugin; join them first. That also
+    // drops the snapshot references of blocks that never came out.
+    pipeline.reset();
+    audioRunning = false;
+
+    for (auto& plugin : plugins)
+    {
+        if (plugin && plugin->processor)
+            plugin->processor->releaseResources();
+    }
+
+    // Nothing is fading any more, so finish pending removals immediately.
+    stopTimer();
+    timerCallback();
+}
+
+void PluginChain::setPlugins(std::vector<std::unique_ptr<PluginInstance>> newPlugins)
+{
+    std::vector<std::unique_ptr<PluginInstance>> retired;
+    for (auto& plugin : plugins)
+        retired.push_back(std::move(plugin));
+    for (auto& removal : pendingRemovals)
+        retired.push_back(std::move(removal.plugin));
+
+    for (auto& plugin : retired)
+        stopListening(*plugin);
+
+    pendingRemovals.clear();
+    plugins = std::move(newPlugins);
+
+    for (auto& plugin : plugins)
+    {
+        plugin->currentGain = 1.0f;
+        plugin->currentWet = plugin->bypassed ? 0.0f : 1.0f;
+        plugin->prepareBuffers(currentNumChannels, currentBlockSize);
+        startListening(*plugin);
+    }
+
+    publish(std::move(retired));
+}
+
+void PluginChain::addPlugin(std::unique_ptr<PluginInstance> plugin)
+{
+    jassert(plugin != nullptr);
+
+    // New plugins fade in from the dry signal.
+    plugin->currentGain = audioRunning ? 0.0f : 1.0f;
+    plugin->targetGain = 1.0f;
+    plugin->prepareBuffers(currentNumChannels, currentBlockSize);
+    startListening(*plugin);
+    plugins.push_back(std::move(plugin));
+    publish();
+}
+
+void PluginChain::replacePlugin(int index, std::unique_ptr<PluginInstance> plugin)
+{
+    jassert(plugin != nullptr);
+
+    if (index < 0 || index >= (int)plugins.size())
+        return;
+
+    auto old = std::move(plugins[(size_t)index]);
+    if (old->editorWindow != nullptr)
+        delete old->editorWindow.getComponent();
+
+    stopListening(*old);
+
+    // The replacement takes over the old one's place in the routing and fades in
+    plugin->parallelWithPrevious = old->parallelWithPrevious;
+    plugin->bypassed = old->bypassed.load();
+    plugin->currentGain = audioRunning ? 0.0f : 1.0f;
+    plugin->currentWet = plugin->bypassed ? 0.0f : 1.0f;
+    plugin->targetGain = 1.0f;
+    plugin->prepareBuffers(currentNumChannels, currentBlockSize);
+    startListening(*plugin);
+    plugins[(size_t)index] = std::move(plugin);
+
+    std::vector<std::unique_ptr<PluginInstance>> retired;
+    retired.push_back(std::move(old));
+    publish(std::move(retired));
+}
+
+void PluginChain::removePlugin(int index)
+{
+    if (index < 0 || index >= (int)plugins.size())
+        return;
+
+    auto plugin = std::move(plugins[(size_t)index]);
+    plugins.erase(plugins.begin() + index);
+
+    if (plugin->editorWindow != nullptr)
+        delete plugin->editorWindow.getComponent();
+
+    stopListening(*plugin);
+
+    // Keep the plugin in the chain while it fades out; the timer drops it
+    // from the published snapshot once the audio thread reports silence.
+    plugin->targetGain = 0.0f;
+    pendingRemovals.push_back({ std::move(plugin), index });
+
+    if (!audioRunning)
+        timerCallback();
+}
+
+void PluginChain::movePlugin(int fromIndex, int toIndex)
+{
+    if (fromIndex < 0 || fromIndex >= (int)plugins.size()
+        || toIndex < 0 || toIndex >= (int)plugins.size()
+        || fromIndex == toIndex)
+        return;
+
+    auto plugin = std::move(plugins[(size_t)fromIndex]);
+    plugins.erase(plugins.begin() + fromIndex);
+    plugins.insert(plugins.begin() + toIndex, std::move(plugin));
+    publish();
+}
+
+void PluginChain::setPipelineSegments(int numSegments)
+{
+    pipelineSegments = juce::jlimit(1, 8, numSegments);
+}
+
+void PluginChain::setPipelineActive(bool shouldBeActive)
+{
+    pipelineActive = shouldBeActive;
+
+    // Until the chain is prepared, prepare() sees to it
+    const bool wantPipeline = audioRunning && pipelineActive && pipelineSegments > 1;
+    if (wantPipeline == (pipeline != nullptr))
+        return;
+
+    if (wantPipeline)
+        pipeline = std::make_unique<ChainPipeline>(*this, pipelineSegments, currentNumChannels, currentBlockSize);
+    else
+        pipeline.reset();
+
+    // The segment split goes with the pipeline
+    publish();
+}
+
+int PluginChain::getPipelineLatencyInBlocks() const
+{
+    return pipeline != nullptr ? pipeline->getLatencyInBlocks() : 0;
+}
+
+juce::uint64 PluginChain::getPipelineLateBlocks() const
+{
+    return pipeline != nullptr ? pipeline->getNumLateBlocks() : 0;
+}
+
+void PluginChain::setTileSize(int samples)
+{
+    requestedTileSize = samples == autoTileSize ? autoTileSize : juce::jmax(0, samples);
+}
+
+void PluginChain::setTunedTileSize(int samples, juce::uint64 generation)
+{
+    if (generation == tuningGeneration)
+        tunedTileSize = juce::jmax(0, samples);
+}
+
+// The tuned size holds meanwhile; the tuner waits for the edits to settle
+void PluginChain::requestTuning()
+{
+    tunedPlugins.clear();
+    for (auto& plugin : plugins)
+        tunedPlugins.push_back(plugin.get());
+
+    ++tuningGeneration;
+
+    if (tileTuner != nullptr && requestedTileSize == autoTileSize && pipelineSegments <= 1 && currentBlockSize > 0)
+        tileTuner->chainChanged(*this);
+}
+
+void PluginChain::setBypassed(int index, bool shouldBeBypassed)
+{
+    if (auto* plugin = getPlugin(index))
+    {
+        // Re-enabling by hand gives a hung plugin a clean slate
+        if (!shouldBeBypassed && plugin->hung)
+        {
+            plugin->overruns = 0;
+            plugin->worstOverrunMicros = 0.0f;
+            plugin->hung = false;
+        }
+
+        plugin->bypassed = shouldBeBypassed;
+    }
+}
+
+void PluginChain::setParallelWithPrevious(int index, bool shouldBeParallel)
+{
+    if (auto* plugin = getPlugin(index))
+    {
+        plugin->parallelWithPrevious = shouldBeParallel;
+        publish();
+    }
+}
+
+PluginInstance* PluginChain::getPlugin(int index) const
+{
+    if (index >= 0 && index < (int)plugins.size())
+        return plugins[(size_t)index].get();
+
+    return nullptr;
+}
+
+int PluginChain::indexOf(const PluginInstance* plugin) const
+{
+    for (size_t i = 0; i < plugins.size(); ++i)
+        if (plugins[i].get() == plugin)
+            return (int)i;
+
+    return -1;
+}
+
+//==============================================================================
+void PluginChain::publish(std::vector<std::unique_ptr<PluginInstance>> retiredPlugins)
+{
+    std::vector<PluginInstance*> ordered;
+    ordered.reserve(plugins.size() + pendingRemovals.size());
+
+    for (auto& plugin : plugins)
+        if (plugin && plugin->processor)
+            ordered.push_back(plugin.get());
+
+    for (auto& removal : pendingRemovals)
+    {
+        auto position = (size_t)juce::jlimit(0, (int)ordered.size(), removal.position);
+        ordered.insert(ordered.begin() + (std::ptrdiff_t)position, removal.plugin.get());
+    }
+
+    // Delay lines that are still the right length keep what's in them. After
+    // prepare() whatever they hold is from before the device stopped.
+    struct CarriedDelays
+    {
+        std::shared_ptr<SampleDelay> dry;
+        std::shared_ptr<SampleDelay> compensation;
+    };
+
+    std::map<const PluginInstance*, CarriedDelays> previousDelays;
+    auto* previous = currentSnapshot.load();
+    if (previous != nullptr && !resetDelayLines)
+    {
+        for (auto& stage : previous->stages)
+        {
+            if (stage->plugin != nullptr)
+                previousDelays[stage->plugin].dry = stage->dryDelay;
+
+            for (auto& branch : stage->branches)
+                previousDelays[branch->plugin] = { branch->dryDelay, branch->compensation };
+        }
+    }
+
+    resetDelayLines = false;
+
+    auto snapshot = std::make_unique<ChainSnapshot>();
+    const auto numChannels = juce::jmax(1, currentNumChannels);
+    const auto blockSize = juce::jmax(1, currentBlockSize);
+
+    auto carry = [numChannels](const std::shared_ptr<SampleDelay>& delay, int samples)
+    {
+        if (delay != nullptr && delay->matches(numChannels, samples))
+            return delay;
+
+        auto fresh = std::make_shared<SampleDelay>();
+        fresh->prepare(numChannels, samples);
+        return fresh;
+    };
+
+    for (auto* plugin : ordered)
+        plugin->latencySamples = plugin->processor->getLatencySamples();
+
+    for (size_t i = 0; i < ordered.size();)
+    {
+        auto end = i + 1;
+        while (end < ordered.size() && ordered[end]->parallelWithPrevious)
+            ++end;
+
+        auto stage = std::make_unique<ChainStage>();
+
+        if (end - i == 1)
+        {
+            stage->plugin = ordered[i];
+            stage->latencySamples = stage->plugin->latencySamples;
+            stage->dryDelay = carry(previousDelays[stage->plugin].dry, stage->latencySamples);
+        }
+        else
+        {
+            for (auto k = i; k < end; ++k)
+                stage->latencySamples = juce::jmax(stage->latencySamples, ordered[k]->latencySamples);
+
+            for (auto k = i; k < end; ++k)
+            {
+                auto branch = std::make_unique<ChainBranch>();
+                branch->plugin = ordered[k];
+                branch->audio.setSize(numChannels, blockSize);
+                branch->dry.setSize(numChannels, blockSize);
+                branch->midi.ensureSize(ProcessingContext::midiBytesToReserve);
+
+                auto& carried = previousDelays[ordered[k]];
+                branch->dryDelay = carry(carried.dry, ordered[k]->latencySamples);
+                branch->compensation = carry(carried.compensation, stage->latencySamples - ordered[k]->latencySamples);
+
+                snapshot->memoryLock.add(branch->audio);
+                snapshot->memoryLock.add(branch->dry);
+                stage->branches.push_back(std::move(branch));
+            }
+        }
+
+        snapshot->latencySamples += stage->latencySamples;
+        snapshot->stages.push_back(std::move(stage));
+        i = end;
+    }
+
+    if (snapshot->latencySamples != chainLatencySamples)
+        DBG("Chain latency is now " << snapshot->latencySamples << " samples");
+
+    chainLatencySamples = snapshot->latencySamples;
+
+    // The split only changes with the stages themselves; a better one for the
+    // same stages waits for the timer to find it holds up
+    if (pipeline != nullptr)
+    {
+        const bool sameStages = (int)currentSegmentStarts.size() == pipeline->getNumSegments() + 1
+                             && currentSegmentStarts.back() == (int)snapshot->stages.size();
+        snapshot->segmentStarts = sameStages ? currentSegmentStarts : partitionStages(measureStages(*snapshot));
+    }
+
+    currentSegmentStarts = snapshot->segmentStarts;
+
+    std::unique_ptr<ChainSnapshot> retired(currentSnapshot.exchange(snapshot.release()));
+    reclaimer.retire(std::move(retired), std::move(retiredPlugins));
+
+    bool samePlugins = tunedPlugins.size() == plugins.size();
+    for (size_t i = 0; samePlugins && i < plugins.size(); ++i)
+        samePlugins = tunedPlugins[i] == plugins[i].get();
+
+    if (!samePlugins && audioRunning)
+        requestTuning();
+}
+
+// Running totals of the stages' costs, so a segment costs the difference of
+// two entries. Stages run in parallel cost as much as their slowest branch;
+// unmeasured plugins count as one unit so a new chain still spreads out
+// evenly, and bypassed plugins without latency are skipped outright so they
+// count as free.
+std::vector<double> PluginChain::measureStages(const ChainSnapshot& snapshot) const
+{
+    auto costOf = [](const PluginInstance* plugin)
+    {
+        if (plugin->bypassed && plugin->latencySamples == 0)
+            return 0.0;
+
+        auto cost = (double)plugin->timing.getSummary().meanMicros;
+        return cost > 0.0 ? cost : 1.0;
+    };
+
+    const auto numStages = (int)snapshot.stages.size();
+
+    std::vector<double> prefix((size_t)numStages + 1, 0.0);
+    for (int i = 0; i < numStages; ++i)
+    {
+        auto& stage = *snapshot.stages[(size_t)i];
+        double cost = 0.0;
+
+        if (stage.plugin != nullptr)
+            cost = costOf(stage.plugin);
+        else
+            for (auto& branch : stage.branches)
+                cost = juce::jmax(cost, costOf(branch->plugin));
+
+        prefix[(size_t)i + 1] = prefix[(size_t)i] + cost;
+    }
+
+    return prefix;
+}
+
+double PluginChain::slowestSegment(const std::vector<double>& costPrefix, const std::vector<int>& starts)
+{
+    double slowest = 0.0;
+    for (size_t k = 0; k + 1 < starts.size(); ++k)
+        slowest = juce::jmax(slowest, costPrefix[(size_t)starts[k + 1]] - costPrefix[(size_t)starts[k]]);
+
+    return slowest;
+}
+
+// Splits the stages into contiguous pipeline segments so that the most
+// expensive segment is as cheap as possible.
+std::vector<int> PluginChain::partitionStages(const std::vector<double>& prefix) const
+{
+    const auto numStages = (int)prefix.size() - 1;
+    const auto numSegments = pipeline != nullptr ? pipeline->getNumSegments() : 1;
+
+    const auto unreachable = std::numeric_limits<double>::max();
+    std::vector<std::vector<double>> best((size_t)numSegments + 1, std::vector<double>((size_t)numStages + 1, unreachable));
+    std::vector<std::vector<int>> cut((size_t)numSegments + 1, std::vector<int>((size_t)numStages + 1, 0));
+    best[0][0] = 0.0;
+
+    for (int j = 1; j <= numSegments; ++j)
+    {
+        for (int i = 0; i <= numStages; ++i)
+        {
+            for (int p = 0; p <= i; ++p)
+            {
+                if (best[(size_t)j - 1][(size_t)p] == unreachable)
+                    continue;
+
+                auto cost = juce::jmax(best[(size_t)j - 1][(size_t)p], prefix[(size_t)i] - prefix[(size_t)p]);
+                if (cost < best[(size_t)j][(size_t)i])
+                {
+                    best[(size_t)j][(size_t)i] = cost;
+                    cut[(size_t)j][(size_t)i] = p;
+                }
+            }
+        }
+    }
+
+    std::vector<int> starts((size_t)numSegments + 1, numStages);
+    for (int j = numSegments, i = numStages; j > 0; --j)
+    {
+        i = cut[(size_t)j][(size_t)i];
+        starts[(size_t)j - 1] = i;
+    }
+
+    return starts;
+}
+
+void PluginChain::repartitionIfNeeded()
+{
+    auto* snapshot = currentSnapshot.load();
+    if (pipeline == nullptr || snapshot == nullptr)
+        return;
+
+    const auto costs = measureStages(*snapshot);
+    auto starts = partitionStages(costs);
+
+    const bool better = starts != currentSegmentStarts
+                     && slowestSegment(costs, starts) < slowestSegment(costs, currentSegmentStarts) * (1.0 - minRepartitionGain);
+
+    if (!better)
+    {
+        betterSplitChecks = 0;
+        return;
+    }
+
+    if (++betterSplitChecks < repartitionChecks)
+        return;
+
+    DBG("Plugin costs have shifted, rebalancing pipeline segments");
+    betterSplitChecks = 0;
+    currentSegmentStarts = std::move(starts);
+    publish();
+}
+
+void PluginChain::startListening(PluginInstance& plugin)
+{
+    plugin.journal = journal;
+    plugin.journalStrip = journalStrip;
+
+    if (plugin.processor != nullptr)
+    {
+        plugin.processor->addListener(this);
+        plugin.processor->addListener(&plugin.stateListener);
+    }
+
+    if (watchdog != nullptr)
+        watchdog->watch(plugin);
+}
+
+void PluginChain::stopListening(PluginInstance& plugin)
+{
+    if (plugin.processor != nullptr)
+    {
+        plugin.processor->removeListener(this);
+        plugin.processor->removeListener(&plugin.stateListener);
+    }
+
+    if (watchdog != nullptr)
+        watchdog->unwatch(plugin);
+}
+
+// Can arrive on any thread, including the audio thread, so just flag it and
+// let the timer republish.
+void PluginChain::audioProcessorChanged(juce::AudioProcessor*, const ChangeDetails& details)
+{
+    if (details.latencyChanged)
+        latencyChanged = true;
+}
+
+void PluginChain::timerCallback()
+{
+    std::vector<std::unique_ptr<PluginInstance>> finished;
+
+    for (auto it = pendingRemovals.begin(); it != pendingRemovals.end();)
+    {
+        if (!audioRunning || it->plugin->fadedOut)
+        {
+            finished.push_back(std::move(it->plugin));
+            it = pendingRemovals.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (!finished.empty())
+    {
+        DBG("Dropping " << (int)finished.size() << " faded-out plugin(s) from the chain");
+        publish(std::move(finished));
+    }
+
+    if (latencyChanged.exchange(false))
+    {
+        DBG("A plugin changed its latency, republishing delay compensation");
+        publish();
+    }
+
+    if (watchdog != nullptr)
+        bypassHungPlugins();
+
+    auto now = juce::Time::getMillisecondCounter();
+    if (audioRunning && now - lastRepartitionTime >= (juce::uint32)repartitionIntervalMs)
+    {
+        lastRepartitionTime = now;
+        repartitionIfNeeded();
+    }
+}
+
+void PluginChain::bypassHungPlugins()
+{
+    bool anyBypassed = false;
+
+    for (int i = 0; i < (int)plugins.size(); ++i)
+    {
+        auto& plugin = *plugins[(size_t)i];
+        if (plugin.hung || !watchdog->shouldBypass(plugin))
+            continue;
+
+        plugin.hung = true;
+        plugin.bypassed = true;
+        anyBypassed = true;
+
+        juce::String report;
+        report << plugin.processor->getName() << " overran its block budget " << plugin.overruns.load()
+               << " times (worst " << juce::String(plugin.worstOverrunMicros.load() / 1000.0f, 1)
+               << " ms against a budget of " << juce::String(plugin.lastOverrunBudgetMicros.load() / 1000.0f, 2)
+               << " ms) and has been bypassed.";
+        DBG("Watchdog: " << report);
+
+        if (onPluginHung)
+            onPluginHung(i, report);
+    }
+
+    // Bypassed plugins cost nothing, which the pipeline split should know
+    if (anyBypassed)
+        publish();
+}
+
+//==============================================================================
+void PluginChain::process(ProcessingContext& context, int numSamples)
+{
+    if (auto* snapshot = currentSnapshot.load())
+    {
+        auto& block = context.getBlock(numSamples);
+
+        if (pipeline != nullptr)
+        {
+            pipeline->process(*snapshot, block, numSamples);
+        }
+        else
+        {
+            const auto requested = requestedTileSize.load(std::memory_order_relaxed);
+            const auto tileSize = requested == autoTileSize ? tunedTileSize.load(std::memory_order_relaxed) : requested;
+
+            processTiles(*snapshot, context, numSamples, tileSize);
+            effectiveTileSize.store(tileSize, std::memory_order_relaxed);
+        }
+    }
+
+    completedBlocks.fetch_add(1);
+}
+
+void PluginChain::warmNextStage(ProcessingContext& context, int numSamples)
+{
+    if (auto* snapshot = currentSnapshot.load())
+    {
+        if (!snapshot->stages.empty())
+        {
+            nextWarmStage %= snapshot->stages.size();
+            context.midi.clear();
+            processStage(*snapshot->stages[nextWarmStage++], context.getBlock(numSamples), context.dry,
+                context.midi, numSamples);
+        }
+    }
+
+    completedBlocks.fetch_add(1);
+}
+
+void PluginChain::processTiles(ChainSnapshot& snapshot, ProcessingContext& context, int numSamples, int tileSize)
+{
+    if (tileSize <= 0 || tileSize >= numSamples)
+    {
+        processStages(snapshot, context.getBlock(numSamples), context, numSamples);
+        return;
+    }
+
+    for (int offset = 0; offset < numSamples; offset += tileSize)
+    {
+        const auto tileSamples = juce::jmin(tileSize, numSamples - offset);
+        processStages(snapshot, context.getTile(offset, tileSamples), context, tileSamples);
+    }
+}
+
+void PluginChain::processStages(ChainSnapshot& snapshot, juce::AudioBuffer<float>& block,
+    ProcessingContext& context, int numSamples)
+{
+    context.midi.clear();
+    for (auto& stage : snapshot.stages)
+        processStage(*stage, block, context.dry, context.midi, numSamples);
+}
+
+void PluginChain::processSegment(ChainSnapshot& snapshot, int segment, juce::AudioBuffer<float>& block,
+    juce::AudioBuffer<float>& dry, juce::MidiBuffer& midi, int numSamples)
+{
+    int first = 0;
+    int end = (int)snapshot.stages.size();
+
+    if (segment >= snapshot.getNumSegments())
+        return;
+
+    if (snapshot.segmentStarts.size() > 1)
+    {
+        first = snapshot.segmentStarts[(size_t)segment];
+        end = snapshot.segmentStarts[(size_t)segment + 1];
+    }
+
+    for (int i = first; i < end; ++i)
+        processStage(*snapshot.stages[(size_t)i], block, dry, midi, numSamples);
+}
+
+void PluginChain::processStage(ChainStage& stage, juce::AudioBuffer<float>& block,
+    juce::AudioBuffer<float>& dry, juce::MidiBuffer& midi, int numSamples)
+{
+    if (stage.plugin != nullptr)
+    {
+        processPlugin(*stage.plugin, block, dry, *stage.dryDelay, false, midi, numSamples);
+        return;
+    }
+
+    stage.chain = this;
+    stage.input = &block;
+    stage.numSamples = numSamples;
+
+    const auto numBranches = (int)stage.branches.size();
+    if (threadPool != nullptr)
+        threadPool->parallelFor(stage, numBranches);
+    else
+        for (int i = 0; i < numBranches; ++i)
+            stage.run(i);
+
+    // Merge: sum the branches back into the chain's buffer
+    for (int channel = 0; channel < block.getNumChannels(); ++channel)
+    {
+        block.copyFrom(channel, 0, stage.branches[0]->view, channel, 0, numSamples);
+        for (int i = 1; i < numBranches; ++i)
+            block.addFrom(channel, 0, stage.branches[(size_t)i]->view, channel, 0, numSamples);
+    }
+}
+
+void ChainStage::run(int index) noexcept
+{
+    auto& branch = *branches[(size_t)index];
+    branch.view.setDataToReferTo(branch.audio.getArrayOfWritePointers(),
+        input->getNumChannels(), numSamples);
+
+    for (int channel = 0; channel < input->getNumChannels(); ++channel)
+        branch.view.copyFrom(channel, 0, *input, channel, 0, numSamples);
+
+    branch.midi.clear();
+    chain->processPlugin(*branch.plugin, branch.view, branch.dry, *branch.dryDelay, true,
+        branch.midi, numSamples);
+
+    // Shared with the plugin's branch in other snapshots, like the plugin itself
+    auto& inProcess = branch.plugin->inProcess;
+    while (inProcess.exchange(true, std::memory_order_acquire))
+        std::this_thread::yield();
+    branch.compensation->process(branch.view, numSamples);
+    inProcess.store(false, std::memory_order_release);
+}
+
+//==============================================================================
+void SampleDelay::prepare(int numChannels, int samples)
+{
+    delaySamples = juce::jmax(0, samples);
+    position = 0;
+    memoryLock.clear();
+    line.setSize(delaySamples > 0 ? numChannels : 0, delaySamples);
+    line.clear();
+    memoryLock.add(line);
+}
+
+void SampleDelay::process(juce::AudioBuffer<float>& buffer, int numSamples) noexcept
+{
+    if (delaySamples == 0)
+        return;
+
+    const auto numChannels = juce::jmin(buffer.getNumChannels(), line.getNumChannels());
+    int end = position;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto* samples = buffer.getWritePointer(channel);
+        auto* delayed = line.getWritePointer(channel);
+        end = position;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            std::swap(samples[i], delayed[end]);
+            if (++end == delaySamples)
+                end = 0;
+        }
+    }
+
+    position = end;
+}
+
+void SampleDelay::processInto(const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+    int numSamples) noexcept
+{
+    const auto numChannels = juce::jmin(input.getNumChannels(), output.getNumChannels());
+
+    if (delaySamples == 0)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            output.copyFrom(channel, 0, input, channel, 0, numSamples);
+
+        return;
+    }
+
+    int end = position;
+
+    for (int channel = 0; channel < juce::jmin(numChannels, line.getNumChannels()); ++channel)
+    {
+        auto* source = input.getReadPointer(channel);
+        auto* destination = output.getWritePointer(channel);
+        auto* delayed = line.getWritePointer(channel);
+        end = position;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            destination[i] = delayed[end];
+            delayed[end] = source[i];
+            if (++end == delaySamples)
+                end = 0;
+        }
+    }
+
+    position = end;
+}
+
+//==============================================================================
+namespace
+{
+    float rampTowards(float current, float target, float maxStep)
+    {
+        return target > current ? juce::jmin(target, current + maxStep)
+                                : juce::jmax(target, current - maxStep);
+    }
+}
+
+// Two crossfades meet here: the plugin's presence in the chain (fading in on
+// add, out on remove) and its bypass state. In a serial stage both fade
+// against the plugin's input; in a branch feeding a sum, presence fades
+// against silence instead. The dry signal is delayed by the plugin's latency
+// so the two sides of a crossfade stay aligned.
+void PluginChain::processPlugin(PluginInstance& plugin, juce::AudioBuffer<float>& buffer,
+    juce::AudioBuffer<float>& dry, SampleDelay& dryDelay, bool fadeToSilence,
+    juce::MidiBuffer& midi, int numSamples)
+{
+    // The pipeline drains before a plugin moves to an earlier segment, so this
+    // is never expected to wait; it only backs the ordering up.
+    while (plugin.inProcess.exchange(true, std::memory_order_acquire))
+        std::this_thread::yield();
+
+    struct ScopedRelease
+    {
+        ~ScopedRelease() { flag.store(false, std::memory_order_release); }
+        std::atomic<bool>& flag;
+    } releaseOnExit { plugin.inProcess };
+
+    // A hung plugin is cut off at once rather than faded, which would mean
+    // calling into it for a few more blocks
+    if (plugin.hung.load(std::memory_order_relaxed))
+        plugin.currentWet = 0.0f;
+
+    const auto presenceTarget = plugin.targetGain.load(std::memory_order_relaxed);
+    const auto wetTarget = plugin.bypassed.load(std::memory_order_relaxed) ? 0.0f : 1.0f;
+    const auto maxStep = gainStepPerSample * (float)numSamples;
+
+    const auto p0 = plugin.currentGain;
+    const auto w0 = plugin.currentWet;
+    const auto p1 = rampTowards(p0, presenceTarget, maxStep);
+    const auto w1 = rampTowards(w0, wetTarget, maxStep);
+    plugin.currentGain = p1;
+    plugin.currentWet = w1;
+
+    if (p0 == 0.0f && p1 == 0.0f)
+    {
+        if (fadeToSilence)
+            buffer.clear();
+
+        if (presenceTarget == 0.0f)
+            plugin.fadedOut = true;
+
+        return;
+    }
+
+    // Gains for the plugin's output and for its dry input at either end of the block
+    const auto g0 = p0 * w0;
+    const auto g1 = p1 * w1;
+    const auto d0 = fadeToSilence ? p0 * (1.0f - w0) : 1.0f - g0;
+    const auto d1 = fadeToSilence ? p1 * (1.0f - w1) : 1.0f - g1;
+
+    // Plugins with latency keep their delayed dry signal running, so that a
+    // crossfade can start on any block without a stale tail.
+    const auto hasLatency = dryDelay.getDelay() > 0;
+    if (hasLatency)
+        dryDelay.processInto(buffer, dry, numSamples);
+
+    if (g0 == 1.0f && g1 == 1.0f)
+    {
+        callProcessBlock(plugin, buffer, midi, numSamples);
+        return;
+    }
+
+    if (g0 == 0.0f && g1 == 0.0f)
+    {
+        // Bypassed. Without latency the input is already the right answer;
+        // with latency the plugin's own bypass keeps the timing intact.
+        if (hasLatency && plugin.hung.load(std::memory_order_relaxed))
+        {
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                buffer.copyFrom(channel, 0, dry, channel, 0, numSamples);
+        }
+        else if (hasLatency)
+        {
+            const RealtimeAllocationCheck::ScopedAllowAllocation pluginCode;
+            plugin.processor->processBlockBypassed(buffer, midi);
+        }
+
+        if (d0 != 1.0f || d1 != 1.0f)
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                buffer.applyGainRamp(channel, 0, numSamples, d0, d1);
+
+        return;
+    }
+
+    if (!hasLatency)
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            dry.copyFrom(channel, 0, buffer, channel, 0, numSamples);
+
+    callProcessBlock(plugin, buffer, midi, numSamples);
+
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+    {
+        buffer.applyGainRamp(channel, 0, numSamples, g0, g1);
+
+        if (d0 > 0.0f || d1 > 0.0f)
+            buffer.addFromWithRamp(channel, 0, dry.getReadPointer(channel), numSamples, d0, d1);
+    }
+}
+
+void PluginChain::callProcessBlock(PluginInstance& plugin, juce::AudioBuffer<float>& buffer,
+    juce::MidiBuffer& midi, int numSamples)
+{
+    // Third-party code; we can't vouch for what it does with the heap
+    const RealtimeAllocationCheck::ScopedAllowAllocation pluginCode;
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    const auto budgetMicros = (float)numSamples * microsPerSample;
+
+    plugin.callBudgetMicros.store(budgetMicros, std::memory_order_relaxed);
+    plugin.callStartTicks.store(startTicks, std::memory_order_release);
+
+    if (plugin.ioBuffer.getNumChannels() == 0)
+    {
+        plugin.processor->processBlock(buffer, midi);
+    }
+    else
+    {
+        processWithOwnBuffer(plugin, buffer, midi, numSamples);
+    }
+
+    plugin.callStartTicks.store(0, std::memory_order_release);
+
+    const auto micros = (float)(juce::Time::highResolutionTicksToSeconds(
+        juce::Time::getHighResolutionTicks() - startTicks) * 1.0e6);
+    plugin.timing.add(micros, budgetMicros);
+}
+
+void PluginChain::processWithOwnBuffer(PluginInstance& plugin, juce::AudioBuffer<float>& buffer,
+    juce::MidiBuffer& midi, int numSamples)
+{
+    // The plugin wants more channels than the device gives us
+    const auto shared = buffer.getNumChannels();
+    plugin.ioView.setDataToReferTo(plugin.ioBuffer.getArrayOfWritePointers(),
+        plugin.ioBuffer.getNumChannels(), numSamples);
+
+    for (int channel = 0; channel < plugin.ioView.getNumChannels(); ++channel)
+    {
+        if (channel < shared)
+            plugin.ioView.copyFrom(channel, 0, buffer, channel, 0, numSamples);
+        else
+            plugin.ioView.clear(channel, 0, numSamples);
+    }
+
+    plugin.processor->processBlock(plugin.ioView, midi);
+
+    for (int channel = 0; channel < shared; ++channel)
+        buffer.copyFrom(channel, 0, plugin.ioView, channel, 0, numSamples);
+}
@@ -0,0 +1,238 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PluginInstance.h"
+#include "ProcessingContext.h"
+#include "RealtimeThreadPool.h"
+#include "ChainSnapshot.h"
+#include "ChainPipeline.h"
+#include "PluginWatchdog.h"
+
+class ChainTileTuner;
+
+// Owns the plugins of the chain and hands the audio thread an immutable
+// snapshot of them. Every edit builds a new snapshot on the message thread
+// and publishes it with a single atomic exchange; the audio thread picks it
+// up with one atomic load per block. Old snapshots and removed plugins are
+// destroyed on the reclaimer thread once the audio thread can no longer see them.
+//
+// Plugins flagged parallelWithPrevious form a split with the plugin before
+// them: each branch gets a copy of the same input, the branches run on the
+// worker pool, and their outputs are summed like a mixer bus.
+//
+// With pipelining enabled the stages are also cut into segments of roughly
+// equal measured cost, each running on its own core a block behind the last.
+//
+// Plugin latency is tracked per node. Shorter branches of a split are delayed
+// to match the longest, and a plugin reporting a new latency gets the
+// compensation republished on the fly.
+class PluginChain : private juce::Timer,
+    private juce::AudioProcessorListener
+{
+public:
+    PluginChain();
+    ~PluginChain() override;
+
+    //==============================================================================
+    // Message thread
+    void prepare(double sampleRate, int maximumBlockSize, int numChannels);
+    void release();
+
+    void setPlugins(std::vector<std::unique_ptr<PluginInstance>> newPlugins);
+    void addPlugin(std::unique_ptr<PluginInstance> plugin);
+    void removePlugin(int index);
+
+    // Swaps a plugin for another in the same slot, e.g. the same plugin moved
+    // into or out of a sandbox. The old one is cut off, the new one fades in.
+    void replacePlugin(int index, std::unique_ptr<PluginInstance> plugin);
+    void movePlugin(int fromIndex, int toIndex);
+    void setParallelWithPrevious(int index, bool shouldBeParallel);
+
+    // Cheap enough to toggle live: the audio thread just reads the flag.
+    void setBypassed(int index, bool shouldBeBypassed);
+
+    // Must be set before audio starts; branches run inline without a pool.
+    void setThreadPool(RealtimeThreadPool* poolToUse) { threadPool = poolToUse; }
+
+    // Must be set before the chain is prepared; pipeline workers apply it to
+    // themselves.
+    void setRealtimePolicy(RealtimePolicy* policyToUse) { policy = policyToUse; }
+
+    // Set before any plugins are added. Plugins the watchdog gives up on are
+    // bypassed in the next published chain and reported through onPluginHung.
+    void setWatchdog(PluginWatchdog* watchdogToUse) { watchdog = watchdogToUse; }
+    std::function<void(int index, const juce::String& report)> onPluginHung;
+
+    // Set before any plugins are added. Parameter changes of this chain's
+    // plugins are journaled as belonging to the given strip, or rather its
+    // chain id, which tells the scenes of a strip apart.
+    void setJournal(ParameterJournal* journalToUse, int strip) { journal = journalToUse; journalStrip = strip; }
+
+    // Takes effect the next time the chain is prepared. 1 turns pipelining off.
+    void setPipelineSegments(int numSegments);
+
+    // Only a chain that's being heard needs segment workers of its own. An
+    // inactive chain has none, and starts them when it's made active again.
+    // Must not be made inactive while the audio thread may be running it.
+    void setPipelineActive(bool shouldBeActive);
+    int getPipelineLatencyInBlocks() const;
+    juce::uint64 getPipelineLateBlocks() const;
+
+    const std::vector<std::unique_ptr<PluginInstance>>& getPlugins() const { return plugins; }
+    int size() const { return (int)plugins.size(); }
+    PluginInstance* getPlugin(int index) const;
+    int indexOf(const PluginInstance* plugin) const;
+    int getMaximumBlockSize() const { return currentBlockSize; }
+
+    // Latency of the published chain, excluding any pipeline delay
+    int getLatencySamples() const { return chainLatencySamples; }
+
+    // Runs the whole chain over sub-blocks of this many samples in turn, so a
+    // tile stays in cache from the first plugin to the last. 0 processes whole
+    // blocks. autoTileSize uses whatever the tile tuner found fastest for the
+    // chain, whole blocks until it has found anything, and asks it to look
+    // again whenever the chain's plugins or the device change. Only applies
+    // when the chain isn't pipelined.
+    static constexpr int autoTileSize = -1;
+    void setTileSize(int samples);
+    int getTileSize() const { return effectiveTileSize.load(); }
+
+    // Set before any plugins are added
+    void setTileTuner(ChainTileTuner* tunerToUse) { tileTuner = tunerToUse; }
+
+    // For the tile tuner. A result is only taken if no newer tuning has been
+    // asked for since the generation it was started at.
+    juce::uint64 getTuningGeneration() const { return tuningGeneration; }
+    void setTunedTileSize(int samples, juce::uint64 generation);
+    double getSampleRate() const { return currentSampleRate; }
+    int getNumChannels() const { return currentNumChannels; }
+
+    //==============================================================================
+    // Audio thread
+    void process(ProcessingContext& context, int numSamples);
+
+    // For a chain that isn't being heard. Runs only its next stage over the
+    // block in the context, taking turns, so its plugins stay warm without
+    // the cost of the whole chain landing on a single block.
+    void warmNextStage(ProcessingContext& context, int numSamples);
+
+    // For a chain the audio thread passes over this block, so what it retires
+    // can still be freed
+    void skipBlock() noexcept { completedBlocks.fetch_add(1); }
+
+private:
+    //==============================================================================
+    struct PendingRemoval
+    {
+        std::unique_ptr<PluginInstance> plugin;
+        int position = 0;
+    };
+
+    // Destroys retired snapshots and plugins off the audio thread, once the
+    // audio thread has finished the block that might still have used them.
+    class Reclaimer : public juce::Thread
+    {
+    public:
+        explicit Reclaimer(PluginChain& owner);
+        ~Reclaimer() override;
+
+        void retire(std::unique_ptr<ChainSnapshot> snapshot,
+            std::vector<std::unique_ptr<PluginInstance>> retiredPlugins);
+        void run() override;
+        void reclaim(bool force);
+
+    private:
+        struct Entry
+        {
+            std::unique_ptr<ChainSnapshot> snapshot;
+            std::vector<std::unique_ptr<PluginInstance>> plugins;
+            juce::uint64 epoch = 0;
+        };
+
+        PluginChain& chain;
+        juce::CriticalSection lock;
+        std::vector<Entry> entries;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Reclaimer)
+    };
+
+    friend struct ChainStage;
+    friend class ChainPipeline;
+
+    void publish(std::vector<std::unique_ptr<PluginInstance>> retiredPlugins = {});
+    std::vector<double> measureStages(const ChainSnapshot& snapshot) const;
+    std::vector<int> partitionStages(const std::vector<double>& prefix) const;
+    static double slowestSegment(const std::vector<double>& costPrefix, const std::vector<int>& starts);
+    void repartitionIfNeeded();
+    void bypassHungPlugins();
+
+    void requestTuning();
+    void processTiles(ChainSnapshot& snapshot, ProcessingContext& context, int numSamples, int tileSize);
+    void processStages(ChainSnapshot& snapshot, juce::AudioBuffer<float>& block,
+        ProcessingContext& context, int numSamples);
+    void processSegment(ChainSnapshot& snapshot, int segment, juce::AudioBuffer<float>& block,
+        juce::AudioBuffer<float>& dry, juce::MidiBuffer& midi, int numSamples);
+    void processStage(ChainStage& stage, juce::AudioBuffer<float>& block,
+        juce::AudioBuffer<float>& dry, juce::MidiBuffer& midi, int numSamples);
+    void processPlugin(PluginInstance& plugin, juce::AudioBuffer<float>& buffer,
+        juce::AudioBuffer<float>& dry, SampleDelay& dryDelay, bool fadeToSilence,
+        juce::MidiBuffer& midi, int numSamples);
+    void callProcessBlock(PluginInstance& plugin, juce::AudioBuffer<float>& buffer,
+        juce::MidiBuffer& midi, int numSamples);
+    void processWithOwnBuffer(PluginInstance& plugin, juce::AudioBuffer<float>& buffer,
+        juce::MidiBuffer& midi, int numSamples);
+    void timerCallback() override;
+
+    void audioProcessorParameterChanged(juce::AudioProcessor*, int, float) override {}
+    void audioProcessorChanged(juce::AudioProcessor*, const ChangeDetails& details) override;
+    void startListening(PluginInstance& plugin);
+    void stopListening(PluginInstance& plugin);
+
+    //==============================================================================
+    std::vector<std::unique_ptr<PluginInstance>> plugins;
+    std::vector<PendingRemoval> pendingRemovals;
+
+    std::atomic<ChainSnapshot*> currentSnapshot { nullptr };
+    std::atomic<juce::uint64> completedBlocks { 0 };
+    size_t nextWarmStage = 0;
+    std::atomic<bool> audioRunning { false };
+    std::atomic<bool> latencyChanged { false };
+    bool resetDelayLines = false;
+    int chainLatencySamples = 0;
+
+    float gainStepPerSample = 1.0f;
+    float microsPerSample = 0.0f;
+
+    std::atomic<int> requestedTileSize { 0 };
+    std::atomic<int> effectiveTileSize { 0 };
+    std::atomic<int> tunedTileSize { 0 };
+    ChainTileTuner* tileTuner = nullptr;
+    juce::uint64 tuningGeneration = 0;
+    std::vector<const PluginInstance*> tunedPlugins;
+    double currentSampleRate = 0.0;
+    int currentBlockSize = 0;
+    int currentNumChannels = 0;
+
+    RealtimeThreadPool* threadPool = nullptr;
+    RealtimePolicy* policy = nullptr;
+    PluginWatchdog* watchdog = nullptr;
+    ParameterJournal* journal = nullptr;
+    int journalStrip = 0;
+    std::unique_ptr<ChainPipeline> pipeline;
+    int pipelineSegments = 1;
+    bool pipelineActive = true;
+    std::vector<int> currentSegmentStarts;
+    juce::uint32 lastRepartitionTime = 0;
+    int betterSplitChecks = 0;
+
+    Reclaimer reclaimer;
+
+    static constexpr double fadeTimeSeconds = 0.02;
+    static constexpr int repartitionIntervalMs = 2000;
+
+    // A new pipeline split has to beat the current one by this much for this
+    // many checks in a row, so noisy timings don't keep moving plugins around
+    static constexpr double minRepartitionGain = 0.15;
+    static constexpr int repartitionChecks = 3;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginChain)
+};
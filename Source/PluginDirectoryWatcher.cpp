@@ -0,0 +1,277 @@
+#include "PluginDirectoryWatcher.h"
+
+#if JUCE_LINUX
+ #include <sys/inotify.h>
+ #include <poll.h>
+ #include <unistd.h>
+#endif
+
+namespace
+{
+    const char* const vst3FormatName = "VST3";
+
+   #if JUCE_LINUX
+    // Everything that adds, replaces or removes a file or directory
+    const juce::uint32 watchMask = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM
+                                 | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF;
+   #endif
+
+    // Where VST3 plugins live on Linux, per the VST3 SDK
+    juce::Array<juce::File> getStandardDirectories()
+    {
+        return {
+            juce::File::getSpecialLocation(juce::File::userHomeDirectory).getChildFile(".vst3"),
+            juce::File("/usr/lib/vst3"),
+            juce::File("/usr/local/lib/vst3")
+        };
+    }
+}
+
+PluginDirectoryWatcher::PluginDirectoryWatcher(PluginScanCache& scanCacheToUse)
+    : juce::Thread("Plugin Directory Watcher"),
+    scanCache(scanCacheToUse)
+{
+    if (!isSupported())
+        return;
+
+    newRoots.addArray(getStandardDirectories());
+    for (auto& directory : scanCache.getDirectories())
+        newRoots.addIfNotAlreadyThere(juce::File(directory));
+
+    startThread();
+}
+
+PluginDirectoryWatcher::~PluginDirectoryWatcher()
+{
+    // Waits for a scan in progress, which has a timeout of its own
+    stopThread(-1);
+}
+
+bool PluginDirectoryWatcher::isSupported()
+{
+   #if JUCE_LINUX
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+void PluginDirectoryWatcher::addDirectory(const juce::File& directory)
+{
+    if (!isSupported() || !directory.isDirectory())
+        return;
+
+    scanCache.addDirectory(directory.getFullPathName());
+
+    const juce::ScopedLock sl(newRootsLock);
+    newRoots.addIfNotAlreadyThere(directory);
+}
+
+//==============================================================================
+void PluginDirectoryWatcher::run()
+{
+   #if JUCE_LINUX
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0)
+    {
+        DBG("inotify_init1 failed, plugin directories won't be watched");
+        return;
+    }
+
+    while (!threadShouldExit())
+    {
+        juce::Array<juce::File> rootsToAdd;
+        {
+            const juce::ScopedLock sl(newRootsLock);
+            rootsToAdd.swapWith(newRoots);
+        }
+
+        for (auto& root : rootsToAdd)
+            watchRoot(root);
+
+        checkMissingRoots();
+
+        pollfd pfd { inotifyFd, POLLIN, 0 };
+        if (poll(&pfd, 1, pollIntervalMs) > 0)
+            readEvents();
+
+        updatePendingBundles();
+    }
+
+    close(inotifyFd);
+    inotifyFd = -1;
+    watches.clear();
+   #endif
+}
+
+#if JUCE_LINUX
+void PluginDirectoryWatcher::watchRoot(const juce::File& root)
+{
+    if (roots.contains(root))
+        return;
+
+    // Directories that don't exist yet can't be watched; a missing ~/.vst3 is
+    // common, and often created by the first plugin installer to come along
+    if (!root.isDirectory())
+    {
+        if (missingRoots.addIfNotAlreadyThere(root))
+            DBG("Not watching " << root.getFullPathName() << " until it exists");
+        return;
+    }
+
+    missingRoots.removeFirstMatchingValue(root);
+    roots.add(root);
+    watchTree(root);
+    checkExisting(root);
+
+    DBG("Watching " << root.getFullPathName() << " for plugin changes ("
+        << (int)watches.size() << " directories watched)");
+}
+
+void PluginDirectoryWatcher::checkMissingRoots()
+{
+    const auto now = juce::Time::getMillisecondCounter();
+    if (now - lastMissingCheck < missingRootIntervalMs)
+        return;
+
+    lastMissingCheck = now;
+
+    // A root that was deleted has lost its watches; look out for it coming back
+    for (int i = roots.size(); --i >= 0;)
+    {
+        if (!roots.getReference(i).isDirectory())
+        {
+            DBG("Plugin directory " << roots.getReference(i).getFullPathName() << " went away");
+            missingRoots.addIfNotAlreadyThere(roots.getReference(i));
+            roots.remove(i);
+        }
+    }
+
+    // Watching it also checks any bundles that came with it
+    for (auto& root : juce::Array<juce::File>(missingRoots))
+        if (root.isDirectory())
+            watchRoot(root);
+}
+
+void PluginDirectoryWatcher::watchTree(const juce::File& directory)
+{
+    int wd = inotify_add_watch(inotifyFd, directory.getFullPathName().toRawUTF8(), watchMask);
+    if (wd < 0)
+    {
+        DBG("Failed to watch " << directory.getFullPathName());
+        return;
+    }
+
+    watches[wd] = directory;
+
+    // Deployments usually replace the binary deep inside the bundle
+    for (const auto& entry : juce::RangedDirectoryIterator(directory, false, "*", juce::File::findDirectories))
+        watchTree(entry.getFile());
+}
+
+void PluginDirectoryWatcher::checkExisting(const juce::File& root)
+{
+    // Bundles that changed or appeared while we weren't running. Checking
+    // one that hasn't changed is only a few stat calls.
+    for (const auto& entry : juce::RangedDirectoryIterator(root, true, "*.vst3",
+             juce::File::findFilesAndDirectories | juce::File::ignoreHiddenFiles))
+    {
+        auto bundle = findBundle(entry.getFile());
+        if (bundle == entry.getFile())
+            pendingBundles[bundle.getFullPathName()] = 0;
+    }
+
+    // And known ones that have gone away since
+    for (auto& known : scanCache.getKnownFiles())
+    {
+        juce::File file(known);
+        if (file.isAChildOf(root) && !file.exists())
+            pendingBundles[known] = 0;
+    }
+}
+
+void PluginDirectoryWatcher::readEvents()
+{
+    alignas(inotify_event) char buffer[16384];
+
+    for (;;)
+    {
+        auto bytes = read(inotifyFd, buffer, sizeof(buffer));
+        if (bytes <= 0)
+            break;
+
+        for (char* p = buffer; p < buffer + bytes;)
+        {
+            auto* event = reinterpret_cast<inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+
+            if ((event->mask & IN_IGNORED) != 0)
+            {
+                watches.erase(event->wd);
+                continue;
+            }
+
+            if ((event->mask & IN_Q_OVERFLOW) != 0)
+            {
+                // Lost track of what changed; fall back to checking everything
+                DBG("inotify queue overflowed, checking all plugin directories");
+                for (auto& root : roots)
+                    checkExisting(root);
+                continue;
+            }
+
+            auto watched = watches.find(event->wd);
+            if (watched == watches.end())
+                continue;
+
+            auto changed = event->len > 0 ? watched->second.getChildFile(event->name) : watched->second;
+
+            if ((event->mask & IN_ISDIR) != 0 && (event->mask & (IN_CREATE | IN_MOVED_TO)) != 0)
+                watchTree(changed);
+
+            auto bundle = findBundle(changed);
+            if (bundle != juce::File())
+                pendingBundles[bundle.getFullPathName()] = juce::Time::getMillisecondCounter();
+        }
+    }
+}
+
+void PluginDirectoryWatcher::updatePendingBundles()
+{
+    const auto now = juce::Time::getMillisecondCounter();
+
+    for (auto it = pendingBundles.begin(); it != pendingBundles.end() && !threadShouldExit();)
+    {
+        // Still being written
+        if (it->second != 0 && now - it->second < settleTimeMs)
+        {
+            ++it;
+            continue;
+        }
+
+        // Unchanged bundles, e.g. from the startup check, cost nothing here
+        juce::File bundle(it->first);
+        const bool updated = bundle.exists() ? scanCache.refresh(vst3FormatName, it->first)
+                                             : scanCache.removeFile(it->first);
+        if (updated)
+        {
+            DBG("Plugin bundle " << (bundle.exists() ? "updated: " : "removed: ") << it->first);
+            ++numUpdates;
+        }
+
+        it = pendingBundles.erase(it);
+    }
+}
+
+juce::File PluginDirectoryWatcher::findBundle(const juce::File& changed) const
+{
+    // The outermost .vst3 below a watched root, so a change anywhere inside
+    // a bundle is put down to the bundle itself
+    juce::File bundle;
+    for (auto f = changed; f != f.getParentDirectory() && !roots.contains(f); f = f.getParentDirectory())
+        if (f.hasFileExtension("vst3"))
+            bundle = f;
+
+    return bundle;
+}
+#endif
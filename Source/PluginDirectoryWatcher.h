@@ -0,0 +1,64 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PluginScanCache.h"
+
+// Keeps the scan cache in step with the plugin directories while the host
+// runs. On Linux it watches the standard VST3 directories, plus any the scan
+// cache remembers, with inotify, including everything inside the bundles.
+// When a bundle is added, changed or removed, only that bundle is rescanned
+// or dropped, on this thread, once it has been quiet for a moment so that a
+// deployment writing many files causes one rescan.
+//
+// At startup it also checks the bundles already there against the cache, so
+// changes made while the host wasn't running are picked up the same way.
+// Directories that don't exist yet, or go away, are looked for again every
+// few seconds and watched as soon as they're there.
+// Nothing here ever blocks the message thread.
+class PluginDirectoryWatcher : private juce::Thread
+{
+public:
+    explicit PluginDirectoryWatcher(PluginScanCache& scanCache);
+    ~PluginDirectoryWatcher() override;
+
+    static bool isSupported();
+
+    // Message thread. Starts watching another directory and has the cache
+    // remember it for next time.
+    void addDirectory(const juce::File& directory);
+
+    // Bundles rescanned or dropped since starting, for the status display
+    int getNumUpdates() const { return numUpdates.load(); }
+
+private:
+    void run() override;
+
+    void watchRoot(const juce::File& root);
+    void checkMissingRoots();
+    void watchTree(const juce::File& directory);
+    void checkExisting(const juce::File& root);
+    void readEvents();
+    void updatePendingBundles();
+    juce::File findBundle(const juce::File& changed) const;
+
+    int inotifyFd = -1;
+    std::map<int, juce::File> watches;
+    juce::Array<juce::File> roots;
+    juce::Array<juce::File> missingRoots;
+    juce::uint32 lastMissingCheck = 0;
+
+    // Bundle path to the time of its last change
+    std::map<juce::String, juce::uint32> pendingBundles;
+
+    PluginScanCache& scanCache;
+
+    juce::CriticalSection newRootsLock;
+    juce::Array<juce::File> newRoots;
+
+    std::atomic<int> numUpdates { 0 };
+
+    static constexpr int pollIntervalMs = 200;
+    static constexpr juce::uint32 settleTimeMs = 1000;
+    static constexpr juce::uint32 missingRootIntervalMs = 2000;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginDirectoryWatcher)
+};
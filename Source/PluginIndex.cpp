@@ -0,0 +1,149 @@
+#include "PluginIndex.h"
+
+namespace
+{
+    // How much a match in each field counts, by Field
+    const int fieldWeights[] = { 4, 2, 1, 1 };
+
+    bool isWordStart(juce::String::CharPointerType text, juce::String::CharPointerType start)
+    {
+        if (text == start)
+            return true;
+
+        auto previous = text;
+        --previous;
+        return !juce::CharacterFunctions::isLetterOrDigit(*previous);
+    }
+}
+
+void PluginIndex::rebuild(const juce::Array<juce::PluginDescription>& types)
+{
+    entries.clear();
+    entries.reserve((size_t)types.size());
+
+    for (auto& type : types)
+    {
+        Entry entry;
+        entry.description = type;
+        entry.fields[nameField] = type.name.toLowerCase();
+        entry.fields[manufacturerField] = type.manufacturerName.toLowerCase();
+
+        // VST3 categories come as "Fx|Dynamics"; each part is a tag
+        auto categories = juce::StringArray::fromTokens(type.category, "|", {});
+        entry.fields[categoryField] = categories.isEmpty() ? juce::String() : categories[0].toLowerCase();
+
+        juce::StringArray tags(categories);
+        tags.add(type.isInstrument ? "instrument" : "effect");
+        tags.add(type.pluginFormatName);
+        entry.fields[tagsField] = tags.joinIntoString(" ").toLowerCase();
+
+        entries.push_back(std::move(entry));
+    }
+
+    byName.resize(entries.size());
+    for (size_t i = 0; i < byName.size(); ++i)
+        byName[i] = (int)i;
+
+    std::sort(byName.begin(), byName.end(), [this](int a, int b)
+    {
+        return entries[(size_t)a].fields[nameField] < entries[(size_t)b].fields[nameField];
+    });
+
+    DBG("Plugin index rebuilt with " << (int)entries.size() << " plugins");
+}
+
+void PluginIndex::search(const juce::String& query, std::vector<int>& results) const
+{
+    results.clear();
+
+    auto words = juce::StringArray::fromTokens(query.toLowerCase(), true);
+    words.removeEmptyStrings();
+
+    if (words.isEmpty())
+    {
+        results = byName;
+        return;
+    }
+
+    // byName order, so equal scores stay alphabetical
+    std::vector<std::pair<int, int>> scored;
+    for (auto index : byName)
+    {
+        int total = 0;
+        for (auto& word : words)
+        {
+            auto score = scoreWord(entries[(size_t)index], word);
+            if (score <= 0)
+            {
+                total = 0;
+                break;
+            }
+            total += score;
+        }
+
+        if (total > 0)
+            scored.emplace_back(total, index);
+    }
+
+    std::stable_sort(scored.begin(), scored.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b)
+    {
+        return a.first > b.first;
+    });
+
+    results.reserve(scored.size());
+    for (auto& entry : scored)
+        results.push_back(entry.second);
+}
+
+int PluginIndex::scoreWord(const Entry& entry, const juce::String& word)
+{
+    int best = 0;
+    for (int field = 0; field < numFields; ++field)
+        best = juce::jmax(best, scoreField(entry.fields[field], word) * fieldWeights[field]);
+    return best;
+}
+
+int PluginIndex::scoreField(const juce::String& field, const juce::String& word)
+{
+    if (field.isEmpty())
+        return 0;
+
+    // Substrings beat scattered matches, and word starts beat the middle of words
+    auto found = field.indexOf(word);
+    if (found == 0)
+        return 100;
+    if (found > 0)
+    {
+        auto start = field.getCharPointer();
+        auto at = start + found;
+        return isWordStart(at, start) ? 80 : 60;
+    }
+
+    // Subsequence: every character in order, rewarding runs and word starts
+    auto start = field.getCharPointer();
+    auto text = start;
+    auto wanted = word.getCharPointer();
+    int score = 0;
+    bool previousMatched = false;
+
+    while (!wanted.isEmpty())
+    {
+        if (text.isEmpty())
+            return 0;
+
+        if (*text == *wanted)
+        {
+            score += previousMatched ? 3 : isWordStart(text, start) ? 2 : 1;
+            previousMatched = true;
+            ++wanted;
+        }
+        else
+        {
+            previousMatched = false;
+        }
+
+        ++text;
+    }
+
+    return juce::jlimit(1, 50, score * 40 / juce::jmax(1, word.length()) / 3);
+}
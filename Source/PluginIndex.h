@@ -0,0 +1,45 @@
+#pragma once
+#include <JuceHeader.h>
+
+// In-memory search index over the known plugins. Each plugin's name,
+// manufacturer, category and tags are lowercased once when the index is
+// built, so a search only walks flat strings.
+//
+// A query is split into words and every word has to match some field, either
+// as a substring or as a fuzzy subsequence ("fbq" finds "FabFilter Pro-Q").
+// Results are ranked with name matches first, then whole-word and prefix
+// matches over scattered ones. Searching a library of a few thousand plugins
+// takes well under a millisecond.
+class PluginIndex
+{
+public:
+    PluginIndex() = default;
+
+    void rebuild(const juce::Array<juce::PluginDescription>& types);
+
+    int size() const { return (int)entries.size(); }
+    const juce::PluginDescription& getDescription(int index) const { return entries[(size_t)index].description; }
+
+    // Indices of the plugins matching the query, best first. An empty query
+    // matches everything, sorted by name.
+    void search(const juce::String& query, std::vector<int>& results) const;
+
+private:
+    enum Field { nameField, manufacturerField, categoryField, tagsField, numFields };
+
+    struct Entry
+    {
+        juce::PluginDescription description;
+        juce::String fields[numFields];
+    };
+
+    static int scoreField(const juce::String& field, const juce::String& word);
+    static int scoreWord(const Entry& entry, const juce::String& word);
+
+    std::vector<Entry> entries;
+
+    // Entries by name, for empty queries
+    std::vector<int> byName;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginIndex)
+};
@@ -1,14 +1,126 @@
 #pragma once
 #include <JuceHeader.h>
+#include "ProcessTimeStats.h"
+#include "AudioMemoryLock.h"
+#include "ParameterJournal.h"
 
 class PluginInstance
 {
 public:
     std::unique_ptr<juce::AudioPluginInstance> processor;
     bool isEditorVisible = false;
+    bool parallelWithPrevious = false;
+
+    // Last latency the plugin reported, refreshed whenever the chain publishes
+    int latencySamples = 0;
+    juce::Component::SafePointer<juce::DocumentWindow> editorWindow;
+
+    // Crossfades. targetGain fades the plugin into and out of the chain when it
+    // is added or removed; bypassed fades between its output and its input.
+    // The message thread only writes the targets; the current values belong
+    // to the audio thread.
+    std::atomic<float> targetGain { 1.0f };
+    std::atomic<bool> bypassed { false };
+    std::atomic<bool> fadedOut { false };
+    float currentGain = 0.0f;
+    float currentWet = 1.0f;
+
+    // processBlock timings, shown per row and used to balance pipeline segments
+    ProcessTimeStats timing;
+
+    // Held while a thread is inside this plugin. The pipeline keeps a plugin's
+    // blocks in order by itself, so nothing should ever have to wait on it.
+    std::atomic<bool> inProcess { false };
+
+    // Watchdog. The audio thread stamps the start and budget of each
+    // processBlock call and clears the stamp when it returns; the watchdog
+    // counts calls that run past a multiple of their budget. A plugin the
+    // watchdog has bypassed is never called into again until re-enabled.
+    std::atomic<juce::int64> callStartTicks { 0 };
+    std::atomic<float> callBudgetMicros { 0.0f };
+    std::atomic<int> overruns { 0 };
+    std::atomic<float> worstOverrunMicros { 0.0f };
+    std::atomic<float> lastOverrunBudgetMicros { 0.0f };
+    std::atomic<bool> hung { false };
+    juce::int64 lastOverrunStart = 0;
+
+    // Autosave. Any parameter or state change the plugin reports, on any
+    // thread, marks it dirty; only dirty plugins have their state captured
+    // again, otherwise the last captured state is written back out.
+    std::atomic<bool> stateDirty { true };
+    std::atomic<juce::uint32> lastStateChange { 0 };
+    juce::MemoryBlock lastSavedState;
+
+    // What the process grew by while the plugin was created and prepared, as
+    // a rough idea of its memory cost; 0 if that couldn't be measured
+    size_t loadedBytes = 0;
+
+    // Blob store hash of the last saved state, if it's large enough to be kept
+    // there. A plugin restored from a blob has only this, not lastSavedState,
+    // and the blob's size.
+    juce::String lastSavedBlob;
+    size_t lastSavedBlobBytes = 0;
+
+    // Parameter journal. The tag names the snapshot and slot this plugin was
+    // last saved as, 0 until it has been. The chain sets the journal and strip
+    // before it starts listening.
+    std::atomic<juce::uint64> journalTag { 0 };
+    ParameterJournal* journal = nullptr;
+    int journalStrip = 0;
+
+    // Names the state in lastSavedState, new every time the autosaver
+    // captures it, so a save that finishes later can tell whether it still
+    // describes this plugin. Message thread only.
+    juce::uint64 savedStateId = 0;
+
+    struct StateListener : public juce::AudioProcessorListener
+    {
+        explicit StateListener(PluginInstance& ownerToUse) : owner(ownerToUse) {}
+
+        void audioProcessorParameterChanged(juce::AudioProcessor*, int parameterIndex, float newValue) override
+        {
+            owner.markStateChanged();
+            if (owner.journal != nullptr)
+                owner.journal->record(owner.journalStrip, owner.journalTag.load(), parameterIndex, newValue);
+        }
+
+        void audioProcessorChanged(juce::AudioProcessor*, const ChangeDetails&) override { owner.markStateChanged(); }
+
+        PluginInstance& owner;
+    };
+
+    StateListener stateListener { *this };
+
+    void markStateChanged() noexcept
+    {
+        lastStateChange = juce::Time::getMillisecondCounter();
+        stateDirty = true;
+    }
+
+    // Used instead of the shared block when the plugin wants more channels
+    // than the device provides. Sized off the audio thread by prepareBuffers().
+    juce::AudioBuffer<float> ioBuffer;
+    juce::AudioBuffer<float> ioView;
+    AudioMemoryLock::Regions ioBufferLock;
+
+    void prepareBuffers(int numChannels, int maximumBlockSize)
+    {
+        auto pluginChannels = processor != nullptr
+            ? juce::jmax(processor->getTotalNumInputChannels(), processor->getTotalNumOutputChannels())
+            : 0;
+
+        ioBufferLock.clear();
+
+        if (pluginChannels > numChannels)
+            ioBuffer.setSize(pluginChannels, maximumBlockSize);
+        else
+            ioBuffer.setSize(0, 0);
+
+        ioBufferLock.add(ioBuffer);
+    }
 
     ~PluginInstance()
     {
         processor = nullptr;
     }
-};
\ No newline at end of file
+};
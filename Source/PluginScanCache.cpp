@@ -0,0 +1,344 @@
+#include "PluginScanCache.h"
+
+PluginScanCache::PluginScanCache()
+{
+    auto appDataDir = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("VSTMIC");
+    appDataDir.createDirectory();
+    cacheFile = appDataDir.getChildFile("plugincache.xml");
+
+    load();
+}
+
+//==============================================================================
+bool PluginScanCache::getDescriptions(juce::AudioPluginFormat& format, const juce::String& fileOrIdentifier,
+    juce::OwnedArray<juce::PluginDescription>& descriptions, juce::String& error)
+{
+    return lookUp(format.getName(), fileOrIdentifier, descriptions, error);
+}
+
+bool PluginScanCache::refresh(const juce::String& formatName, const juce::String& fileOrIdentifier)
+{
+    if (isUpToDate(fileOrIdentifier, fingerprintOf(juce::File(fileOrIdentifier))))
+        return false;
+
+    juce::String error;
+    juce::OwnedArray<juce::PluginDescription> descriptions;
+    if (!lookUp(formatName, fileOrIdentifier, descriptions, error))
+        DBG("Refreshing " << fileOrIdentifier << " found no plugins: " << error);
+
+    return true;
+}
+
+bool PluginScanCache::removeFile(const juce::String& fileOrIdentifier)
+{
+    for (auto& type : knownPlugins.getTypes())
+        if (type.fileOrIdentifier == fileOrIdentifier)
+            knownPlugins.removeType(type);
+    knownPlugins.removeFromBlacklist(fileOrIdentifier);
+
+    const juce::ScopedLock sl(lock);
+    if (fingerprints.erase(fileOrIdentifier) == 0)
+        return false;
+
+    DBG("Removed " << fileOrIdentifier << " from the scan cache");
+    save();
+    return true;
+}
+
+juce::StringArray PluginScanCache::getKnownFiles() const
+{
+    const juce::ScopedLock sl(lock);
+
+    juce::StringArray files;
+    for (auto& entry : fingerprints)
+        files.add(entry.first);
+    return files;
+}
+
+void PluginScanCache::addDirectory(const juce::String& directory)
+{
+    const juce::ScopedLock sl(lock);
+    if (directories.addIfNotAlreadyThere(directory))
+        save();
+}
+
+juce::StringArray PluginScanCache::getDirectories() const
+{
+    const juce::ScopedLock sl(lock);
+    return directories;
+}
+
+bool PluginScanCache::lookUp(const juce::String& formatName, const juce::String& fileOrIdentifier,
+    juce::OwnedArray<juce::PluginDescription>& descriptions, juce::String& error)
+{
+    const auto current = fingerprintOf(juce::File(fileOrIdentifier));
+
+    if (isUpToDate(fileOrIdentifier, current))
+    {
+        if (knownPlugins.getBlacklistedFiles().contains(fileOrIdentifier))
+        {
+            error = "Scanning this plugin failed before and it hasn't changed since";
+            return false;
+        }
+
+        for (auto& type : knownPlugins.getTypes())
+            if (type.fileOrIdentifier == fileOrIdentifier && type.pluginFormatName == formatName)
+                descriptions.add(new juce::PluginDescription(type));
+
+        DBG("Scan cache hit for " << fileOrIdentifier << ": " << descriptions.size() << " plugin(s)");
+        return !descriptions.isEmpty();
+    }
+
+    DBG("Scan cache miss for " << fileOrIdentifier << ", scanning");
+
+    // Not holding the lock while scanning, which can take a while
+    juce::OwnedArray<juce::PluginDescription> found;
+    const bool scanned = scanOutOfProcess(formatName, fileOrIdentifier, found, error);
+
+    // Whatever we knew about the old version of the file is stale now
+    for (auto& type : knownPlugins.getTypes())
+        if (type.fileOrIdentifier == fileOrIdentifier)
+            knownPlugins.removeType(type);
+
+    if (scanned)
+    {
+        knownPlugins.removeFromBlacklist(fileOrIdentifier);
+        for (auto* type : found)
+        {
+            knownPlugins.addType(*type);
+            descriptions.add(new juce::PluginDescription(*type));
+        }
+    }
+    else
+    {
+        knownPlugins.addToBlacklist(fileOrIdentifier);
+    }
+
+    {
+        const juce::ScopedLock sl(lock);
+        fingerprints[fileOrIdentifier] = current;
+        save();
+    }
+
+    if (scanned && descriptions.isEmpty())
+        error = "No plugins found in the file";
+
+    return !descriptions.isEmpty();
+}
+
+bool PluginScanCache::findFullDescription(juce::AudioPluginFormatManager& formatManager,
+    const juce::PluginDescription& saved, juce::PluginDescription& result)
+{
+    for (auto* format : formatManager.getFormats())
+    {
+        if (format->getName() != saved.pluginFormatName)
+            continue;
+
+        juce::String error;
+        juce::OwnedArray<juce::PluginDescription> descriptions;
+        if (!getDescriptions(*format, saved.fileOrIdentifier, descriptions, error))
+        {
+            DBG("No cached description for " << saved.name << ": " << error);
+            return false;
+        }
+
+        // Prefer the plugin with the saved name, for shells holding several
+        for (auto* description : descriptions)
+        {
+            if (description->name == saved.name)
+            {
+                result = *description;
+                return true;
+            }
+        }
+
+        result = *descriptions[0];
+        return true;
+    }
+
+    return false;
+}
+
+void PluginScanCache::forget(const juce::String& fileOrIdentifier)
+{
+    const juce::ScopedLock sl(lock);
+    fingerprints.erase(fileOrIdentifier);
+}
+
+//==============================================================================
+PluginScanCache::Fingerprint PluginScanCache::fingerprintOf(const juce::File& file)
+{
+    Fingerprint fingerprint;
+
+    if (file.isDirectory())
+    {
+        // Bundles change inside without touching the directory itself
+        fingerprint.modificationTime = file.getLastModificationTime().toMilliseconds();
+        for (const auto& entry : juce::RangedDirectoryIterator(file, true, "*", juce::File::findFiles))
+        {
+            fingerprint.modificationTime = juce::jmax(fingerprint.modificationTime,
+                entry.getModificationTime().toMilliseconds());
+            fingerprint.size += entry.getFileSize();
+        }
+    }
+    else if (file.existsAsFile())
+    {
+        fingerprint.modificationTime = file.getLastModificationTime().toMilliseconds();
+        fingerprint.size = file.getSize();
+    }
+
+    return fingerprint;
+}
+
+bool PluginScanCache::isUpToDate(const juce::String& fileOrIdentifier, const Fingerprint& current) const
+{
+    const juce::ScopedLock sl(lock);
+    auto known = fingerprints.find(fileOrIdentifier);
+    return known != fingerprints.end() && known->second == current;
+}
+
+bool PluginScanCache::scanOutOfProcess(const juce::String& formatName, const juce::String& fileOrIdentifier,
+    juce::OwnedArray<juce::PluginDescription>& found, juce::String& error)
+{
+    auto output = juce::File::getSpecialLocation(juce::File::tempDirectory)
+        .getNonexistentChildFile("vstmic-scan", ".xml");
+
+    juce::StringArray args;
+    args.add(juce::File::getSpecialLocation(juce::File::currentExecutableFile).getFullPathName());
+    args.add(commandLineFlag);
+    args.add(formatName);
+    args.add(fileOrIdentifier);
+    args.add(output.getFullPathName());
+
+    juce::ChildProcess scanner;
+    if (!scanner.start(args, 0))
+    {
+        error = "Couldn't start the scanner process";
+        return false;
+    }
+
+    if (!scanner.waitForProcessToFinish(scanTimeoutMs))
+    {
+        scanner.kill();
+        output.deleteFile();
+        error = "Scanning timed out after " + juce::String(scanTimeoutMs / 1000) + " seconds";
+        DBG(error << ": " << fileOrIdentifier);
+        return false;
+    }
+
+    auto exitCode = scanner.getExitCode();
+    auto xml = juce::parseXML(output);
+    output.deleteFile();
+
+    if (exitCode != 0 || xml == nullptr)
+    {
+        error = "The scanner crashed or failed (exit code " + juce::String((int)exitCode) + ")";
+        DBG(error << ": " << fileOrIdentifier);
+        return false;
+    }
+
+    for (auto* typeXml : xml->getChildIterator())
+    {
+        juce::PluginDescription description;
+        if (description.loadFromXml(*typeXml))
+            found.add(new juce::PluginDescription(description));
+    }
+
+    return true;
+}
+
+//==============================================================================
+bool PluginScanCache::isScanCommandLine(const juce::String& commandLine)
+{
+    return juce::StringArray::fromTokens(commandLine, true).contains(commandLineFlag);
+}
+
+int PluginScanCache::runScanner(const juce::String& commandLine)
+{
+    auto args = juce::StringArray::fromTokens(commandLine, true);
+    auto flag = args.indexOf(commandLineFlag);
+    if (flag < 0 || flag + 3 >= args.size())
+        return 2;
+
+    auto formatName = args[flag + 1].unquoted();
+    auto fileOrIdentifier = args[flag + 2].unquoted();
+    auto output = juce::File(args[flag + 3].unquoted());
+
+    juce::AudioPluginFormatManager formatManager;
+    formatManager.addDefaultFormats();
+
+    for (auto* format : formatManager.getFormats())
+    {
+        if (format->getName() != formatName)
+            continue;
+
+        juce::OwnedArray<juce::PluginDescription> found;
+        format->findAllTypesForFile(found, fileOrIdentifier);
+
+        juce::XmlElement root("Scan");
+        for (auto* description : found)
+            root.addChildElement(description->createXml().release());
+
+        return root.writeTo(output) ? 0 : 1;
+    }
+
+    return 1;
+}
+
+//==============================================================================
+void PluginScanCache::load()
+{
+    auto xml = juce::parseXML(cacheFile);
+    if (xml == nullptr || !xml->hasTagName("PluginScanCache"))
+    {
+        DBG("No plugin scan cache yet");
+        return;
+    }
+
+    if (auto* listXml = xml->getChildByName("KNOWNPLUGINS"))
+        knownPlugins.recreateFromXml(*listXml);
+
+    if (auto* filesXml = xml->getChildByName("Files"))
+    {
+        for (auto* fileXml : filesXml->getChildIterator())
+        {
+            Fingerprint fingerprint;
+            fingerprint.modificationTime = fileXml->getStringAttribute("modified").getLargeIntValue();
+            fingerprint.size = fileXml->getStringAttribute("size").getLargeIntValue();
+            fingerprints[fileXml->getStringAttribute("path")] = fingerprint;
+        }
+    }
+
+    if (auto* directoriesXml = xml->getChildByName("Directories"))
+        for (auto* directoryXml : directoriesXml->getChildIterator())
+            directories.add(directoryXml->getStringAttribute("path"));
+
+    DBG("Plugin scan cache: " << knownPlugins.getNumTypes() << " plugins in "
+        << (int)fingerprints.size() << " files");
+}
+
+// Called with the lock held
+void PluginScanCache::save()
+{
+    juce::XmlElement root("PluginScanCache");
+
+    if (auto listXml = knownPlugins.createXml())
+        root.addChildElement(listXml.release());
+
+    auto* filesXml = root.createNewChildElement("Files");
+    for (auto& entry : fingerprints)
+    {
+        auto* fileXml = filesXml->createNewChildElement("File");
+        fileXml->setAttribute("path", entry.first);
+        fileXml->setAttribute("modified", juce::String(entry.second.modificationTime));
+        fileXml->setAttribute("size", juce::String(entry.second.size));
+    }
+
+    auto* directoriesXml = root.createNewChildElement("Directories");
+    for (auto& directory : directories)
+        directoriesXml->createNewChildElement("Directory")->setAttribute("path", directory);
+
+    if (!root.writeTo(cacheFile))
+        DBG("Failed to write plugin scan cache");
+}
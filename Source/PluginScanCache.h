@@ -0,0 +1,95 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Persistent record of what every plugin file we've looked at contains, kept
+// in a KnownPluginList saved next to the other settings. Each file is keyed
+// by its path, modification time and size; for a bundle those are the newest
+// modification time and total size of everything inside it, so any change
+// to the bundle is noticed.
+//
+// A file is only scanned when it's new or has changed, and then in a child
+// process with a timeout, so a plugin that hangs or crashes while being
+// scanned can't take the host with it. Files that failed go on the list's
+// blacklist and aren't tried again until they change.
+//
+// Lookups and scans are safe on any thread, so changed files can be rescanned
+// in the background while the UI keeps using what's cached.
+class PluginScanCache
+{
+public:
+    PluginScanCache();
+
+    //==============================================================================
+    // Fills descriptions with the plugins in the file, scanning it first if the
+    // cache doesn't know the file as it is now. Blocks while scanning.
+    bool getDescriptions(juce::AudioPluginFormat& format, const juce::String& fileOrIdentifier,
+        juce::OwnedArray<juce::PluginDescription>& descriptions, juce::String& error);
+
+    // Rescans the file if it changed since it was last seen, for watchers.
+    // Returns whether it did.
+    bool refresh(const juce::String& formatName, const juce::String& fileOrIdentifier);
+
+    // Drops everything known about a file that has gone away; false if nothing was
+    bool removeFile(const juce::String& fileOrIdentifier);
+
+    // Files the cache has a record of
+    juce::StringArray getKnownFiles() const;
+
+    // Extra directories to watch for plugin changes, remembered across runs
+    void addDirectory(const juce::String& directory);
+    juce::StringArray getDirectories() const;
+
+    // Told on the message thread whenever the known plugins change
+    juce::ChangeBroadcaster& getChangeBroadcaster() { return knownPlugins; }
+
+    // The complete cached description matching a saved, possibly partial one,
+    // scanning the file if needed. Returns false if nothing matches.
+    bool findFullDescription(juce::AudioPluginFormatManager& formatManager,
+        const juce::PluginDescription& saved, juce::PluginDescription& result);
+
+    // Rescans one file even if it looks unchanged
+    void forget(const juce::String& fileOrIdentifier);
+
+    // Any thread
+    juce::Array<juce::PluginDescription> getKnownTypes() const { return knownPlugins.getTypes(); }
+
+    //==============================================================================
+    // Scanner process. The application runs in this mode when started with
+    // --scan <format> <file> <output file>; it returns the exit code.
+    static constexpr const char* commandLineFlag = "--scan";
+    static bool isScanCommandLine(const juce::String& commandLine);
+    static int runScanner(const juce::String& commandLine);
+
+private:
+    struct Fingerprint
+    {
+        juce::int64 modificationTime = 0;
+        juce::int64 size = 0;
+
+        bool operator==(const Fingerprint& other) const
+        {
+            return modificationTime == other.modificationTime && size == other.size;
+        }
+    };
+
+    static Fingerprint fingerprintOf(const juce::File& file);
+    bool isUpToDate(const juce::String& fileOrIdentifier, const Fingerprint& current) const;
+    bool lookUp(const juce::String& formatName, const juce::String& fileOrIdentifier,
+        juce::OwnedArray<juce::PluginDescription>& descriptions, juce::String& error);
+    bool scanOutOfProcess(const juce::String& formatName, const juce::String& fileOrIdentifier,
+        juce::OwnedArray<juce::PluginDescription>& found, juce::String& error);
+    void load();
+    void save();
+
+    juce::File cacheFile;
+    juce::KnownPluginList knownPlugins;
+
+    // Guards the fingerprints, the directories and the file
+    mutable juce::CriticalSection lock;
+    std::map<juce::String, Fingerprint> fingerprints;
+    juce::StringArray directories;
+
+    static constexpr int scanTimeoutMs = 30000;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginScanCache)
+};
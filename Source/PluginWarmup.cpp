@@ -0,0 +1,128 @@
+#include "PluginWarmup.h"
+#include "SandboxedPlugin.h"
+
+PluginWarmup::PluginWarmup()
+    : juce::Thread("Plugin Warmup")
+{
+    startThread();
+}
+
+PluginWarmup::~PluginWarmup()
+{
+    cancelPendingUpdate();
+    stopThread(5000);
+}
+
+void PluginWarmup::preroll(PluginInstance& plugin, int numBlocks, int blockSize)
+{
+    auto* processor = plugin.processor.get();
+    if (processor == nullptr || numBlocks <= 0 || blockSize <= 0
+        || dynamic_cast<SandboxedPlugin*>(processor) != nullptr)
+        return;
+
+    juce::AudioBuffer<float> buffer(juce::jmax(1, processor->getTotalNumInputChannels(),
+        processor->getTotalNumOutputChannels()), blockSize);
+    juce::MidiBuffer midi;
+
+    const auto ticksPerMs = (double)juce::Time::getHighResolutionTicksPerSecond() / 1000.0;
+    double firstMs = 0.0, lastMs = 0.0, slowestMs = 0.0, totalMs = 0.0;
+    int numRun = 0;
+
+    for (; numRun < numBlocks && !juce::Thread::currentThreadShouldExit(); ++numRun)
+    {
+        buffer.clear();
+        midi.clear();
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        processor->processBlock(buffer, midi);
+        lastMs = (double)(juce::Time::getHighResolutionTicks() - start) / ticksPerMs;
+
+        if (numRun == 0)
+            firstMs = lastMs;
+        slowestMs = juce::jmax(slowestMs, lastMs);
+        totalMs += lastMs;
+    }
+
+    // Drops whatever the preroll left in delay lines and envelopes
+    processor->reset();
+
+    DBG("Warmed up " << processor->getName() << " with " << numRun << " blocks of " << blockSize
+        << " samples in " << juce::String(totalMs, 2) << " ms: first " << juce::String(firstMs, 3)
+        << " ms, slowest " << juce::String(slowestMs, 3) << " ms, last " << juce::String(lastMs, 3) << " ms");
+}
+
+void PluginWarmup::warmUp(std::unique_ptr<PluginInstance> plugin, int blockSize,
+    std::function<void(std::unique_ptr<PluginInstance>)> onWarm)
+{
+    jassert(plugin != nullptr && onWarm != nullptr);
+
+    // Even with the preroll off, plugins go through the queue so they come back in order
+    {
+        const juce::ScopedLock sl(lock);
+        pending.push_back({ std::move(plugin), blockSize, std::move(onWarm) });
+    }
+
+    notify();
+}
+
+void PluginWarmup::finishAll()
+{
+    for (;;)
+    {
+        {
+            const juce::ScopedLock sl(lock);
+            if (pending.empty() && !busy)
+                break;
+        }
+
+        juce::Thread::sleep(1);
+    }
+
+    cancelPendingUpdate();
+    handleAsyncUpdate();
+}
+
+void PluginWarmup::run()
+{
+    while (!threadShouldExit())
+    {
+        Job job;
+        {
+            const juce::ScopedLock sl(lock);
+            if (!pending.empty())
+            {
+                job = std::move(pending.front());
+                pending.pop_front();
+                busy = true;
+            }
+        }
+
+        if (job.plugin == nullptr)
+        {
+            wait(-1);
+            continue;
+        }
+
+        preroll(*job.plugin, numBlocks.load(), job.blockSize);
+
+        {
+            const juce::ScopedLock sl(lock);
+            finished.push_back(std::move(job));
+            busy = false;
+        }
+
+        triggerAsyncUpdate();
+    }
+}
+
+void PluginWarmup::handleAsyncUpdate()
+{
+    std::deque<Job> ready;
+    {
+        const juce::ScopedLock sl(lock);
+        ready.swap(finished);
+    }
+
+    for (auto& job : ready)
+        job.onWarm(std::move(job.plugin));
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PluginInstance.h"
+
+// Runs freshly prepared plugins over a few blocks of silence before they go
+// live. The first processBlock calls after prepareToPlay are often many times
+// slower than the rest while a plugin warms its caches and builds tables it
+// creates lazily; on the audio thread that's a dropout. The plugin is reset
+// afterwards, so nothing of the preroll is ever heard.
+//
+// preroll() does the work on the calling thread. An instance hands plugins to
+// a thread of its own and gives them back on the message thread, in the order
+// they were handed in.
+class PluginWarmup : private juce::Thread,
+    private juce::AsyncUpdater
+{
+public:
+    PluginWarmup();
+    ~PluginWarmup() override;
+
+    // Blocks of silence per plugin; 0 turns the preroll off
+    void setNumBlocks(int newNumBlocks) { numBlocks = juce::jmax(0, newNumBlocks); }
+
+    // Any thread, for a plugin that isn't in a chain yet. Sandboxed plugins
+    // are left alone: their blocks are a round trip to another process, which
+    // the sandbox gives up on as soon as it's late.
+    static void preroll(PluginInstance& plugin, int numBlocks, int blockSize);
+
+    // Message thread. onWarm is called on the message thread with the plugin
+    // once it's been prerolled.
+    void warmUp(std::unique_ptr<PluginInstance> plugin, int blockSize,
+        std::function<void(std::unique_ptr<PluginInstance>)> onWarm);
+
+    // Message thread. Waits for every plugin handed in so far and gives them
+    // all back before returning, e.g. before the strips are rebuilt.
+    void finishAll();
+
+private:
+    struct Job
+    {
+        std::unique_ptr<PluginInstance> plugin;
+        int blockSize = 0;
+        std::function<void(std::unique_ptr<PluginInstance>)> onWarm;
+    };
+
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    juce::CriticalSection lock;
+    std::deque<Job> pending;
+    std::deque<Job> finished;
+    bool busy = false;
+
+    std::atomic<int> numBlocks { 16 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginWarmup)
+};
@@ -0,0 +1,87 @@
+#include "PluginWatchdog.h"
+
+PluginWatchdog::PluginWatchdog()
+    : juce::Thread("Plugin Watchdog")
+{
+    startThread();
+}
+
+PluginWatchdog::~PluginWatchdog()
+{
+    stopThread(1000);
+}
+
+void PluginWatchdog::setOptions(const Options& newOptions)
+{
+    budgetMultiple = juce::jmax(0, newOptions.budgetMultiple);
+    strikes = juce::jmax(1, newOptions.strikes);
+}
+
+PluginWatchdog::Options PluginWatchdog::getOptions() const
+{
+    Options options;
+    options.budgetMultiple = budgetMultiple.load();
+    options.strikes = strikes.load();
+    return options;
+}
+
+void PluginWatchdog::watch(PluginInstance& plugin)
+{
+    const juce::ScopedLock sl(lock);
+    plugins.addIfNotAlreadyThere(&plugin);
+}
+
+void PluginWatchdog::unwatch(PluginInstance& plugin)
+{
+    const juce::ScopedLock sl(lock);
+    plugins.removeFirstMatchingValue(&plugin);
+}
+
+bool PluginWatchdog::shouldBypass(const PluginInstance& plugin) const
+{
+    return budgetMultiple.load() > 0 && plugin.overruns.load() >= strikes.load();
+}
+
+void PluginWatchdog::run()
+{
+    const auto ticksPerMicro = (double)juce::Time::getHighResolutionTicksPerSecond() / 1.0e6;
+
+    while (!threadShouldExit())
+    {
+        if (budgetMultiple.load() > 0)
+        {
+            const auto now = juce::Time::getHighResolutionTicks();
+
+            const juce::ScopedLock sl(lock);
+            for (auto* plugin : plugins)
+                check(*plugin, now, ticksPerMicro);
+        }
+
+        wait(pollIntervalMs);
+    }
+}
+
+void PluginWatchdog::check(PluginInstance& plugin, juce::int64 now, double ticksPerMicro)
+{
+    const auto start = plugin.callStartTicks.load(std::memory_order_acquire);
+    if (start == 0)
+        return;
+
+    const auto budget = plugin.callBudgetMicros.load(std::memory_order_relaxed);
+    const auto elapsed = (float)((double)(now - start) / ticksPerMicro);
+    if (budget <= 0.0f || elapsed <= budget * (float)budgetMultiple.load())
+        return;
+
+    // Count each call once, but keep measuring it for as long as it runs
+    if (plugin.lastOverrunStart != start)
+    {
+        plugin.lastOverrunStart = start;
+        plugin.overruns.fetch_add(1);
+        plugin.lastOverrunBudgetMicros = budget;
+        DBG("Watchdog: " << plugin.processor->getName() << " is " << juce::String(elapsed / 1000.0f, 1)
+            << " ms into a " << juce::String(budget / 1000.0f, 2) << " ms block");
+    }
+
+    if (elapsed > plugin.worstOverrunMicros.load())
+        plugin.worstOverrunMicros = elapsed;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PluginInstance.h"
+
+// Watches processBlock calls from a thread of its own. The audio thread
+// stamps each call's start time and budget on the plugin and clears the
+// stamp on return; the watchdog polls the stamps and flags any call that
+// has been running longer than a multiple of its budget, recording how long
+// it ran. It never touches the audio thread, so it sees a plugin that is
+// stuck right now rather than one that has already come back.
+//
+// The chains act on the flags: a plugin with too many overruns is bypassed
+// and no longer called into at all.
+class PluginWatchdog : private juce::Thread
+{
+public:
+    struct Options
+    {
+        // Overrun threshold in multiples of the block budget; 0 turns the watchdog off
+        int budgetMultiple = 4;
+
+        // Overruns before the plugin is bypassed
+        int strikes = 3;
+    };
+
+    PluginWatchdog();
+    ~PluginWatchdog() override;
+
+    void setOptions(const Options& newOptions);
+    Options getOptions() const;
+
+    // Message thread. Plugins must be unwatched before they are destroyed.
+    void watch(PluginInstance& plugin);
+    void unwatch(PluginInstance& plugin);
+
+    // Whether the plugin has used up its strikes
+    bool shouldBypass(const PluginInstance& plugin) const;
+
+private:
+    void run() override;
+    void check(PluginInstance& plugin, juce::int64 now, double ticksPerMicro);
+
+    mutable juce::CriticalSection lock;
+    juce::Array<PluginInstance*> plugins;
+
+    std::atomic<int> budgetMultiple { 4 };
+    std::atomic<int> strikes { 3 };
+
+    static constexpr int pollIntervalMs = 2;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginWatchdog)
+};
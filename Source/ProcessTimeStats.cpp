@@ -0,0 +1,32 @@
+#include "ProcessTimeStats.h"
+
+ProcessTimeStats::Summary ProcessTimeStats::getSummary() const
+{
+    Summary summary;
+
+    const auto numBlocks = (int)juce::jmin((juce::uint32)windowSize, written.load(std::memory_order_acquire));
+    if (numBlocks == 0)
+        return summary;
+
+    std::array<float, (size_t)windowSize> sorted;
+    double totalMicros = 0.0;
+    double totalBudget = 0.0;
+
+    for (int i = 0; i < numBlocks; ++i)
+    {
+        const auto micros = times[(size_t)i].load(std::memory_order_relaxed);
+        sorted[(size_t)i] = micros;
+        totalMicros += micros;
+        totalBudget += budgets[(size_t)i].load(std::memory_order_relaxed);
+        summary.maxMicros = juce::jmax(summary.maxMicros, micros);
+    }
+
+    const auto p99Index = juce::jmin(numBlocks - 1, (int)std::ceil(0.99 * numBlocks) - 1);
+    std::nth_element(sorted.begin(), sorted.begin() + p99Index, sorted.begin() + numBlocks);
+
+    summary.numBlocks = numBlocks;
+    summary.meanMicros = (float)(totalMicros / numBlocks);
+    summary.p99Micros = sorted[(size_t)p99Index];
+    summary.budgetPercent = totalBudget > 0.0 ? (float)(100.0 * totalMicros / totalBudget) : 0.0f;
+    return summary;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Rolling timing statistics over the most recent blocks. One thread records
+// (the one processing the plugin); any thread can summarise without locking.
+// The reader may see a window that is a block or two newer in places than
+// in others, which is fine for a meter.
+class ProcessTimeStats
+{
+public:
+    struct Summary
+    {
+        int numBlocks = 0;
+        float meanMicros = 0.0f;
+        float p99Micros = 0.0f;
+        float maxMicros = 0.0f;
+
+        // Share of the real time available for the blocks measured
+        float budgetPercent = 0.0f;
+    };
+
+    // Audio thread
+    void add(float micros, float budgetMicros) noexcept
+    {
+        const auto index = written.load(std::memory_order_relaxed);
+        const auto slot = (size_t)(index % windowSize);
+        times[slot].store(micros, std::memory_order_relaxed);
+        budgets[slot].store(budgetMicros, std::memory_order_relaxed);
+        written.store(index + 1, std::memory_order_release);
+    }
+
+    // Any thread
+    Summary getSummary() const;
+
+    static constexpr int windowSize = 1024;
+
+private:
+    std::array<std::atomic<float>, (size_t)windowSize> times {};
+    std::array<std::atomic<float>, (size_t)windowSize> budgets {};
+    std::atomic<juce::uint32> written { 0 };
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <JuceHeader.h>
+#include "AudioMemoryLock.h"
+
+// Everything the audio callback writes to, sized once when the device starts
+// so that the callback itself never has to allocate.
+struct ProcessingContext
+{
+    void prepare(int numChannelsToUse, int maximumBlockSizeToUse)
+    {
+        numChannels = juce::jmax(1, numChannelsToUse);
+        maximumBlockSize = juce::jmax(1, maximumBlockSizeToUse);
+
+        audio.setSize(numChannels, maximumBlockSize);
+        dry.setSize(numChannels, maximumBlockSize);
+        audio.clear();
+        dry.clear();
+
+        memoryLock.clear();
+        memoryLock.add(audio);
+        memoryLock.add(dry);
+
+        // Room for a generous amount of MIDI so plugins adding events don't
+        // make the buffer grow on the audio thread.
+        midi.clear();
+        midi.ensureSize(midiBytesToReserve);
+    }
+
+    // Points the block view at the first numSamples of the audio buffer.
+    // AudioBuffer keeps up to 32 channel pointers inline, so this doesn't allocate.
+    juce::AudioBuffer<float>& getBlock(int numSamples)
+    {
+        jassert(numSamples <= maximumBlockSize);
+        block.setDataToReferTo(audio.getArrayOfWritePointers(), numChannels, numSamples);
+        return block;
+    }
+
+    // Same again for a tile of numSamples starting at offset
+    juce::AudioBuffer<float>& getTile(int offset, int numSamples)
+    {
+        jassert(offset + numSamples <= maximumBlockSize);
+        tile.setDataToReferTo(audio.getArrayOfWritePointers(), numChannels, offset, numSamples);
+        return tile;
+    }
+
+    juce::AudioBuffer<float> audio;
+    juce::AudioBuffer<float> dry;
+    juce::AudioBuffer<float> block;
+    juce::AudioBuffer<float> tile;
+    juce::MidiBuffer midi;
+
+    int numChannels = 0;
+    int maximumBlockSize = 0;
+
+    AudioMemoryLock::Regions memoryLock;
+
+    static constexpr size_t midiBytesToReserve = 4096;
+};
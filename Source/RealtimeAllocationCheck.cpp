@@ -0,0 +1,143 @@
+#include "RealtimeAllocationCheck.h"
+
+#if JUCE_DEBUG
+
+#include <cstdlib>
+#include <new>
+
+#if JUCE_WINDOWS
+ #include <malloc.h>
+#endif
+
+namespace
+{
+    thread_local int realtimeDepth = 0;
+    thread_local int allowanceDepth = 0;
+
+    void checkAllocation()
+    {
+        if (realtimeDepth > 0 && allowanceDepth == 0)
+        {
+            // The assertion machinery may allocate on its own
+            const RealtimeAllocationCheck::ScopedAllowAllocation reporting;
+
+            // If you hit this, something allocated inside the audio callback.
+            // Look up the call stack for the culprit.
+            jassertfalse;
+        }
+    }
+
+    void* allocate(std::size_t size)
+    {
+        checkAllocation();
+
+        if (auto* ptr = std::malloc(size == 0 ? 1 : size))
+            return ptr;
+
+        throw std::bad_alloc();
+    }
+
+   #if __cpp_aligned_new
+    // Over-aligned types skip the plain overloads, so they need their own
+    void* allocateAligned(std::size_t size, std::align_val_t alignment) noexcept
+    {
+        checkAllocation();
+
+        const auto align = juce::jmax(sizeof(void*), static_cast<std::size_t>(alignment));
+        size = size == 0 ? align : size;
+
+       #if JUCE_WINDOWS
+        return _aligned_malloc(size, align);
+       #else
+        void* ptr = nullptr;
+        return posix_memalign(&ptr, align, size) == 0 ? ptr : nullptr;
+       #endif
+    }
+
+    void freeAligned(void* ptr) noexcept
+    {
+       #if JUCE_WINDOWS
+        _aligned_free(ptr);
+       #else
+        std::free(ptr);
+       #endif
+    }
+   #endif
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    checkAllocation();
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    checkAllocation();
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+
+#if __cpp_aligned_new
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (auto* ptr = allocateAligned(size, alignment))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    if (auto* ptr = allocateAligned(size, alignment))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept { freeAligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { freeAligned(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { freeAligned(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { freeAligned(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(ptr); }
+#endif
+
+namespace RealtimeAllocationCheck
+{
+    ScopedRealtimeSection::ScopedRealtimeSection()   { ++realtimeDepth; }
+    ScopedRealtimeSection::~ScopedRealtimeSection()  { --realtimeDepth; }
+    ScopedAllowAllocation::ScopedAllowAllocation()   { ++allowanceDepth; }
+    ScopedAllowAllocation::~ScopedAllowAllocation()  { --allowanceDepth; }
+}
+
+#else
+
+namespace RealtimeAllocationCheck
+{
+    ScopedRealtimeSection::ScopedRealtimeSection()   {}
+    ScopedRealtimeSection::~ScopedRealtimeSection()  {}
+    ScopedAllowAllocation::ScopedAllowAllocation()   {}
+    ScopedAllowAllocation::~ScopedAllowAllocation()  {}
+}
+
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Debug-build guard against heap allocations on the audio thread. While a
+// ScopedRealtimeSection is alive on a thread, any operator new on that thread
+// trips an assertion. Release builds compile this down to nothing.
+namespace RealtimeAllocationCheck
+{
+    struct ScopedRealtimeSection
+    {
+        ScopedRealtimeSection();
+        ~ScopedRealtimeSection();
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedRealtimeSection)
+    };
+
+    // Suspends the check, e.g. around calls into third-party plugin code that
+    // we can't make allocation-free ourselves.
+    struct ScopedAllowAllocation
+    {
+        ScopedAllowAllocation();
+        ~ScopedAllowAllocation();
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedAllowAllocation)
+    };
+}
@@ -0,0 +1,276 @@
+#include "RealtimePolicy.h"
+
+#if JUCE_LINUX
+ #include <pthread.h>
+ #include <sched.h>
+ #include <sys/resource.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <cerrno>
+ #include <cstring>
+#endif
+
+namespace
+{
+    juce::String describeError(int error)
+    {
+       #if JUCE_LINUX
+        if (error == EPERM)
+            return "not permitted, raise RLIMIT_RTPRIO or grant CAP_SYS_NICE";
+        if (error == EACCES)
+            return "permission denied";
+        return juce::String(strerror(error));
+       #else
+        return "error " + juce::String(error);
+       #endif
+    }
+
+    juce::String describePolicy(int policy)
+    {
+       #if JUCE_LINUX
+        switch (policy)
+        {
+            case SCHED_FIFO:  return "SCHED_FIFO";
+            case SCHED_RR:    return "SCHED_RR";
+            case SCHED_OTHER: return "SCHED_OTHER";
+            default:          break;
+        }
+       #endif
+        return "policy " + juce::String(policy);
+    }
+
+    // What the thread had before it first applied the policy, to go back to.
+    // Kept per thread rather than per slot, since threads can share a slot.
+    struct OriginalPolicy
+    {
+        juce::uint32 appliedGeneration = 0;
+        bool saved = false;
+       #if JUCE_LINUX
+        int policy = SCHED_OTHER;
+        sched_param param {};
+        bool affinitySaved = false;
+        cpu_set_t affinity;
+       #endif
+    };
+
+    thread_local OriginalPolicy originalPolicy;
+}
+
+//==============================================================================
+RealtimePolicy::RealtimePolicy() = default;
+
+RealtimePolicy::~RealtimePolicy()
+{
+    closeDmaLatency();
+}
+
+void RealtimePolicy::setOptions(const Options& newOptions)
+{
+    realtimeScheduling = newOptions.realtimeScheduling;
+    devicePriority = newOptions.devicePriority;
+    workerPriority = newOptions.workerPriority;
+    pinThreads = newOptions.pinThreads;
+    holdCpuDmaLatency = newOptions.holdCpuDmaLatency;
+
+    // Every thread picks the new policy up the next time round
+    generation.fetch_add(1);
+
+    if (!holdCpuDmaLatency)
+        closeDmaLatency();
+}
+
+void RealtimePolicy::audioStarted()
+{
+    // The device may call back on a fresh thread
+    generation.fetch_add(1);
+
+    if (holdCpuDmaLatency)
+        openDmaLatency();
+}
+
+void RealtimePolicy::audioStopped()
+{
+    closeDmaLatency();
+}
+
+//==============================================================================
+void RealtimePolicy::applyToCurrentThread(int slot) noexcept
+{
+    if (slot < 0 || slot >= maxThreads)
+        return;
+
+    const auto current = generation.load(std::memory_order_relaxed);
+    if (originalPolicy.appliedGeneration == current)
+        return;
+
+    auto& state = threads[(size_t)slot];
+    applyNow(slot, state);
+    originalPolicy.appliedGeneration = current;
+    state.appliedGeneration.store(current, std::memory_order_release);
+}
+
+void RealtimePolicy::applyNow(int slot, ThreadState& state) noexcept
+{
+   #if JUCE_LINUX
+    const auto self = pthread_self();
+    int schedulingError = 0;
+    int affinityError = 0;
+    int cpu = -1;
+
+    auto& original = originalPolicy;
+    if (!original.saved)
+    {
+        original.saved = pthread_getschedparam(self, &original.policy, &original.param) == 0;
+        original.affinitySaved = pthread_getaffinity_np(self, sizeof(original.affinity), &original.affinity) == 0;
+    }
+
+    if (realtimeScheduling)
+    {
+        auto wanted = slot == deviceThread ? devicePriority.load() : workerPriority.load();
+
+        sched_param param {};
+        param.sched_priority = juce::jlimit(sched_get_priority_min(SCHED_FIFO),
+            sched_get_priority_max(SCHED_FIFO), wanted);
+        schedulingError = pthread_setschedparam(self, SCHED_FIFO, &param);
+
+        // Without CAP_SYS_NICE we may still be allowed a lower priority
+        rlimit limit {};
+        if (schedulingError == EPERM && getrlimit(RLIMIT_RTPRIO, &limit) == 0
+            && limit.rlim_cur > 0 && (int)limit.rlim_cur < param.sched_priority)
+        {
+            param.sched_priority = (int)limit.rlim_cur;
+            schedulingError = pthread_setschedparam(self, SCHED_FIFO, &param);
+        }
+    }
+    else if (original.saved)
+    {
+        schedulingError = pthread_setschedparam(self, original.policy, &original.param);
+    }
+
+    // Pinning stands on its own; it helps cache locality with or without
+    // real-time priorities
+    if (pinThreads)
+    {
+        const auto numCpus = juce::SystemStats::getNumCpus();
+
+        // The device thread gets core 0, workers and pipeline segments each
+        // share the rest the same way
+        const auto index = slot >= firstPipelineThread ? slot - firstPipelineThread : slot - firstWorkerThread;
+        cpu = slot == deviceThread || numCpus < 2 ? 0 : 1 + index % (numCpus - 1);
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        affinityError = pthread_setaffinity_np(self, sizeof(set), &set);
+        if (affinityError != 0)
+            cpu = -1;
+    }
+    else if (original.affinitySaved)
+    {
+        affinityError = pthread_setaffinity_np(self, sizeof(original.affinity), &original.affinity);
+    }
+
+    int policy = -1;
+    sched_param current {};
+    if (pthread_getschedparam(self, &policy, &current) == 0)
+    {
+        state.policy = policy;
+        state.priority = current.sched_priority;
+    }
+
+    state.cpu = cpu;
+    state.schedulingError = schedulingError;
+    state.affinityError = affinityError;
+   #else
+    juce::ignoreUnused(slot);
+    state.policy = -1;
+   #endif
+}
+
+//==============================================================================
+void RealtimePolicy::openDmaLatency()
+{
+   #if JUCE_LINUX
+    if (dmaLatencyFile >= 0)
+        return;
+
+    // The request holds for as long as the file stays open
+    dmaLatencyFile = open("/dev/cpu_dma_latency", O_WRONLY);
+    if (dmaLatencyFile < 0)
+    {
+        dmaLatencyError = errno;
+        DBG("Could not open /dev/cpu_dma_latency: " << describeError(dmaLatencyError));
+        return;
+    }
+
+    const juce::int32 zeroMicroseconds = 0;
+    if (write(dmaLatencyFile, &zeroMicroseconds, sizeof(zeroMicroseconds)) != (ssize_t)sizeof(zeroMicroseconds))
+    {
+        dmaLatencyError = errno;
+        DBG("Could not write /dev/cpu_dma_latency: " << describeError(dmaLatencyError));
+        close(dmaLatencyFile);
+        dmaLatencyFile = -1;
+        return;
+    }
+
+    dmaLatencyError = 0;
+    DBG("Holding /dev/cpu_dma_latency at 0 us");
+   #endif
+}
+
+void RealtimePolicy::closeDmaLatency()
+{
+   #if JUCE_LINUX
+    if (dmaLatencyFile >= 0)
+    {
+        close(dmaLatencyFile);
+        dmaLatencyFile = -1;
+        DBG("Released /dev/cpu_dma_latency");
+    }
+   #endif
+}
+
+//==============================================================================
+juce::String RealtimePolicy::getReport() const
+{
+   #if ! JUCE_LINUX
+    return "Real-time policy: not supported on this platform\n";
+   #else
+    juce::String report;
+
+    for (int slot = 0; slot < maxThreads; ++slot)
+    {
+        auto& state = threads[(size_t)slot];
+        if (state.appliedGeneration.load(std::memory_order_acquire) == 0)
+            continue;
+
+        report << (slot == deviceThread ? juce::String("Device thread")
+                   : slot >= firstPipelineThread ? "Pipeline segment " + juce::String(slot - firstPipelineThread + 1)
+                                                 : "DSP worker " + juce::String(slot - firstWorkerThread))
+               << ": " << describePolicy(state.policy.load());
+
+        if (state.priority.load() > 0)
+            report << " " << state.priority.load();
+
+        if (state.cpu.load() >= 0)
+            report << ", CPU " << state.cpu.load();
+
+        if (auto error = state.schedulingError.load())
+            report << " (SCHED_FIFO " << describeError(error) << ")";
+
+        if (auto error = state.affinityError.load())
+            report << " (pinning " << describeError(error) << ")";
+
+        report << "\n";
+    }
+
+    if (dmaLatencyFile >= 0)
+        report << "cpu_dma_latency: held at 0 us\n";
+    else if (holdCpuDmaLatency && dmaLatencyError != 0)
+        report << "cpu_dma_latency: " << describeError(dmaLatencyError) << "\n";
+    else
+        report << "cpu_dma_latency: not held\n";
+
+    return report;
+   #endif
+}
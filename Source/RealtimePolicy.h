@@ -0,0 +1,80 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Optional real-time scheduling for the threads on the audio path. Each
+// thread applies the policy to itself (scheduling can only be changed
+// reliably from the thread concerned) the first time it runs after the
+// policy changed, and records what it actually got, so the UI and logs show
+// the effective policy rather than the requested one. Missing permissions
+// leave the thread as it was and say why. Turning an option off puts the
+// thread back to the scheduling and affinity it had before it first applied
+// the policy.
+//
+// On Linux this means SCHED_FIFO priorities, optional CPU pinning and
+// holding /dev/cpu_dma_latency at zero while audio runs to keep cores out
+// of deep C-states. Elsewhere the policy is only reported.
+class RealtimePolicy
+{
+public:
+    struct Options
+    {
+        bool realtimeScheduling = false;
+        int devicePriority = 80;
+        int workerPriority = 70;
+        bool pinThreads = false;
+        bool holdCpuDmaLatency = false;
+    };
+
+    // Slots that threads report into
+    static constexpr int deviceThread = 0;
+    static constexpr int firstWorkerThread = 1;
+    static constexpr int firstPipelineThread = 8;
+    static constexpr int maxThreads = 16;
+
+    RealtimePolicy();
+    ~RealtimePolicy();
+
+    //==============================================================================
+    // Message thread
+    void setOptions(const Options& newOptions);
+    void audioStarted();
+    void audioStopped();
+
+    // One line per thread that has reported, plus the DMA latency request
+    juce::String getReport() const;
+
+    //==============================================================================
+    // Audio and worker threads. Cheap unless the policy changed since the
+    // calling thread last applied it. Threads may share a slot, e.g. the
+    // pipeline workers of different strips; the slot reports the last one.
+    void applyToCurrentThread(int slot) noexcept;
+
+private:
+    struct ThreadState
+    {
+        std::atomic<juce::uint32> appliedGeneration { 0 };
+        std::atomic<int> policy { -1 };
+        std::atomic<int> priority { 0 };
+        std::atomic<int> cpu { -1 };
+        std::atomic<int> schedulingError { 0 };
+        std::atomic<int> affinityError { 0 };
+    };
+
+    void applyNow(int slot, ThreadState& state) noexcept;
+    void openDmaLatency();
+    void closeDmaLatency();
+
+    std::atomic<juce::uint32> generation { 1 };
+    std::atomic<bool> realtimeScheduling { false };
+    std::atomic<int> devicePriority { 80 };
+    std::atomic<int> workerPriority { 70 };
+    std::atomic<bool> pinThreads { false };
+
+    bool holdCpuDmaLatency = false;
+    int dmaLatencyFile = -1;
+    int dmaLatencyError = 0;
+
+    std::array<ThreadState, (size_t)maxThreads> threads;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RealtimePolicy)
+};
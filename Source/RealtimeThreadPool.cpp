@@ -0,0 +1,227 @@
+#include "RealtimeThreadPool.h"
+#include "RealtimePolicy.h"
+#include <thread>
+
+namespace
+{
+    // Which pool queue the current thread posts to, if any. An outside queue
+    // is handed back to its pool when the thread exits.
+    struct QueueClaim
+    {
+        ~QueueClaim() { release(); }
+
+        void release()
+        {
+            if (inUse != nullptr)
+                inUse->store(false);
+
+            inUse = nullptr;
+            owner = nullptr;
+            pool = nullptr;
+            queue = -1;
+        }
+
+        const void* pool = nullptr;
+        int queue = -1;
+
+        // Keeps the flag alive even if the pool goes first
+        std::shared_ptr<void> owner;
+        std::atomic<bool>* inUse = nullptr;
+    };
+
+    thread_local QueueClaim localClaim;
+}
+
+//==============================================================================
+RealtimeThreadPool::Worker::Worker(RealtimeThreadPool& owner, int index)
+    : juce::Thread("DSP Worker " + juce::String(index)),
+    pool(owner),
+    queueIndex(index)
+{
+}
+
+void RealtimeThreadPool::Worker::run()
+{
+    localClaim.pool = &pool;
+    localClaim.queue = queueIndex;
+
+    while (!threadShouldExit())
+    {
+        if (auto* policy = pool.policy.load(std::memory_order_relaxed))
+            policy->applyToCurrentThread(RealtimePolicy::firstWorkerThread + queueIndex);
+
+        if (pool.stealOne(queueIndex + 1))
+            continue;
+
+        // Stay hot for a little while; blocks tend to arrive back to back
+        auto lastPost = pool.postCount.load();
+        bool newWork = false;
+        for (int i = 0; i < spinsBeforeSleeping && !newWork; ++i)
+            newWork = pool.postCount.load(std::memory_order_relaxed) != lastPost;
+
+        if (newWork)
+            continue;
+
+        sleeping = true;
+        if (pool.postCount.load() == lastPost)
+            wakeUp.wait(100);
+        sleeping = false;
+    }
+}
+
+//==============================================================================
+RealtimeThreadPool::RealtimeThreadPool(int numWorkers)
+    : outsideQueues(std::make_shared<OutsideQueues>())
+{
+    for (auto& inUse : outsideQueues->inUse)
+        inUse.store(false);
+
+    for (int i = 0; i < numWorkers + maxOutsideThreads; ++i)
+        queues.push_back(std::make_unique<Queue>());
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto* worker = workers.add(new Worker(*this, i));
+        worker->startThread(juce::Thread::realtimeAudioPriority);
+    }
+
+    DBG("Realtime thread pool started with " << numWorkers << " workers");
+}
+
+RealtimeThreadPool::~RealtimeThreadPool()
+{
+    for (auto* worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->wakeUp.signal();
+    }
+
+    for (auto* worker : workers)
+        worker->stopThread(2000);
+}
+
+//==============================================================================
+RealtimeThreadPool::Queue* RealtimeThreadPool::getQueueForThisThread() noexcept
+{
+    if (localClaim.pool != this)
+    {
+        localClaim.release();
+
+        for (int index = 0; index < maxOutsideThreads; ++index)
+        {
+            auto& inUse = outsideQueues->inUse[(size_t)index];
+            bool expected = false;
+
+            if (inUse.compare_exchange_strong(expected, true))
+            {
+                localClaim.pool = this;
+                localClaim.queue = workers.size() + index;
+                localClaim.owner = outsideQueues;
+                localClaim.inUse = &inUse;
+                break;
+            }
+        }
+
+        // Every outside queue is taken; this thread runs its work inline
+        if (localClaim.pool != this)
+            return nullptr;
+    }
+
+    return queues[(size_t)localClaim.queue].get();
+}
+
+bool RealtimeThreadPool::stealOne(int startQueue) noexcept
+{
+    const auto numQueues = (int)queues.size();
+
+    for (int q = 0; q < numQueues; ++q)
+    {
+        auto& queue = *queues[(size_t)((startQueue + q) % numQueues)];
+
+        // Outer levels first: they hold the bigger pieces of work
+        for (auto& slot : queue.slots)
+        {
+            if (slot.batch.load(std::memory_order_relaxed) == nullptr)
+                continue;
+
+            slot.readers.fetch_add(1);
+            auto* batch = slot.batch.load();
+            int index = -1;
+
+            if (batch != nullptr)
+            {
+                index = batch->next.fetch_add(1);
+                if (index >= batch->numJobs)
+                    index = -1;
+            }
+
+            slot.readers.fetch_sub(1);
+
+            // A claimed index keeps the batch alive until it's accounted for
+            if (index >= 0)
+            {
+                batch->job->run(index);
+                batch->remaining.fetch_sub(1);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void RealtimeThreadPool::runAll(Batch& batch) noexcept
+{
+    for (;;)
+    {
+        auto index = batch.next.fetch_add(1);
+        if (index >= batch.numJobs)
+            return;
+
+        batch.job->run(index);
+        batch.remaining.fetch_sub(1);
+    }
+}
+
+void RealtimeThreadPool::parallelFor(Job& job, int numJobs) noexcept
+{
+    if (numJobs <= 0)
+        return;
+
+    auto* queue = workers.isEmpty() || numJobs == 1 ? nullptr : getQueueForThisThread();
+
+    if (queue == nullptr || queue->depth >= maxDepth)
+    {
+        for (int i = 0; i < numJobs; ++i)
+            job.run(i);
+
+        return;
+    }
+
+    Batch batch;
+    batch.job = &job;
+    batch.numJobs = numJobs;
+    batch.remaining = numJobs;
+
+    auto& slot = queue->slots[(size_t)queue->depth++];
+    slot.batch = &batch;
+    postCount.fetch_add(1);
+
+    for (auto* worker : workers)
+        if (worker->sleeping.load())
+            worker->wakeUp.signal();
+
+    // Work through our own batch, then wait for whatever was stolen. We don't
+    // go stealing ourselves here: picking up somebody else's long job would
+    // hold up our caller for no reason.
+    runAll(batch);
+
+    while (batch.remaining.load() > 0)
+        std::this_thread::yield();
+
+    slot.batch = nullptr;
+    while (slot.readers.load() > 0)
+        std::this_thread::yield();
+
+    --queue->depth;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <JuceHeader.h>
+
+class RealtimePolicy;
+
+// A small pool of high-priority threads that audio threads can fan work out
+// to. parallelFor() is called from the audio callback: the caller takes part
+// in the work and only returns once every job index has finished, so the
+// results are always joined before the callback carries on.
+//
+// Work is shared by stealing. Every thread that calls parallelFor() posts its
+// batch in a queue of its own, and idle workers go looking through everyone's
+// queues for indices still to claim. Calls may nest, so a channel strip
+// running on a worker can fan its parallel branches out in turn, and the
+// device thread and pipeline workers can all use the pool at once.
+class RealtimeThreadPool
+{
+public:
+    struct Job
+    {
+        virtual ~Job() = default;
+        virtual void run(int index) noexcept = 0;
+    };
+
+    explicit RealtimeThreadPool(int numWorkers);
+    ~RealtimeThreadPool();
+
+    int getNumWorkers() const { return workers.size(); }
+
+    // Workers apply this policy to themselves; set it before audio starts
+    void setPolicy(RealtimePolicy* policyToUse) { policy = policyToUse; }
+
+    // Audio threads. Runs job.run(i) for every i in [0, numJobs).
+    void parallelFor(Job& job, int numJobs) noexcept;
+
+private:
+    // job and numJobs are set before the batch is published and never change
+    // after, and each call posts a batch of its own, so an index claimed from
+    // next always belongs to the job it runs. Rewriting a published batch in
+    // place would let a thief pair one call's index with another's job.
+    struct Batch
+    {
+        Job* job = nullptr;
+        int numJobs = 0;
+        std::atomic<int> next { 0 };
+        std::atomic<int> remaining { 0 };
+    };
+
+    // One slot per nesting level. A thief registers as a reader before looking
+    // at a slot, so the owner knows when nobody can still see its batch.
+    struct Slot
+    {
+        std::atomic<Batch*> batch { nullptr };
+        std::atomic<int> readers { 0 };
+    };
+
+    static constexpr int maxDepth = 4;
+
+    struct Queue
+    {
+        std::array<Slot, (size_t)maxDepth> slots;
+        int depth = 0;
+    };
+
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker(RealtimeThreadPool& owner, int index);
+        void run() override;
+
+        std::atomic<bool> sleeping { false };
+        juce::WaitableEvent wakeUp;
+
+    private:
+        RealtimeThreadPool& pool;
+        const int queueIndex;
+    };
+
+    Queue* getQueueForThisThread() noexcept;
+    bool stealOne(int startQueue) noexcept;
+    static void runAll(Batch& batch) noexcept;
+
+    // Workers use the first queues; any other thread claims one of the rest
+    // the first time it posts work, and gives it back when it exits. Device
+    // threads and pipeline workers come and go with every restart.
+    static constexpr int maxOutsideThreads = 8;
+
+    struct OutsideQueues
+    {
+        std::array<std::atomic<bool>, (size_t)maxOutsideThreads> inUse;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::shared_ptr<OutsideQueues> outsideQueues;
+
+    std::atomic<RealtimePolicy*> policy { nullptr };
+
+    // Bumped whenever a batch is posted, so spinning workers notice cheaply
+    std::atomic<juce::uint32> postCount { 0 };
+
+    juce::OwnedArray<Worker> workers;
+
+    static constexpr int spinsBeforeSleeping = 20000;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RealtimeThreadPool)
+};
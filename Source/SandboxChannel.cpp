@@ -0,0 +1,229 @@
+#include "SandboxChannel.h"
+
+#if JUCE_LINUX
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <sys/syscall.h>
+ #include <linux/futex.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <ctime>
+#endif
+
+namespace
+{
+   #if JUCE_LINUX
+    void* mapSegment(const juce::String& name, bool create)
+    {
+        auto flags = create ? O_CREAT | O_EXCL | O_RDWR : O_RDWR;
+        int fd = shm_open(name.toRawUTF8(), flags, 0600);
+        if (fd < 0)
+        {
+            DBG("shm_open failed for " << name);
+            return nullptr;
+        }
+
+        if (create && ftruncate(fd, (off_t)sizeof(SandboxChannel::Layout)) != 0)
+        {
+            DBG("Failed to size shared memory " << name);
+            close(fd);
+            shm_unlink(name.toRawUTF8());
+            return nullptr;
+        }
+
+        auto* address = mmap(nullptr, sizeof(SandboxChannel::Layout),
+            PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (address == MAP_FAILED)
+        {
+            DBG("Failed to map shared memory " << name);
+            if (create)
+                shm_unlink(name.toRawUTF8());
+            return nullptr;
+        }
+
+        // The audio area is touched every block; keep it resident
+        mlock(address, offsetof(SandboxChannel::Layout, state));
+        return address;
+    }
+
+    int* futexWord(std::atomic<juce::uint32>& word) noexcept
+    {
+        static_assert(sizeof(std::atomic<juce::uint32>) == sizeof(int), "futex words must be plain ints");
+        return reinterpret_cast<int*>(&word);
+    }
+
+    // Sleeps while the word holds value, for at most timeoutMicros if positive
+    void futexWait(std::atomic<juce::uint32>& word, juce::uint32 value, juce::int64 timeoutMicros) noexcept
+    {
+        timespec timeout { (time_t)(timeoutMicros / 1000000), (long)(timeoutMicros % 1000000) * 1000 };
+        syscall(SYS_futex, futexWord(word), FUTEX_WAIT, (int)value,
+            timeoutMicros >= 0 ? &timeout : nullptr, nullptr, 0);
+    }
+   #endif
+
+    constexpr int spinsBeforeSleeping = 2000;
+
+    template <typename Condition>
+    bool waitUntil(SandboxChannel::Word& word, int timeoutMicros, Condition done) noexcept
+    {
+        for (int spin = 0; spin < spinsBeforeSleeping; ++spin)
+            if (done(word.value.load(std::memory_order_acquire)))
+                return true;
+
+       #if JUCE_LINUX
+        auto ticksPerMicro = (double)juce::Time::getHighResolutionTicksPerSecond() / 1.0e6;
+        auto deadline = juce::Time::getHighResolutionTicks() + (juce::int64)(timeoutMicros * ticksPerMicro);
+
+        // Counted before the value is read again, so a waker that stores after
+        // that read is sure to see us and make the syscall
+        word.sleepers.fetch_add(1);
+        struct Awake { std::atomic<juce::uint32>& sleepers; ~Awake() { sleepers.fetch_sub(1); } } awake { word.sleepers };
+
+        for (;;)
+        {
+            auto current = word.value.load();
+            if (done(current))
+                return true;
+
+            juce::int64 remaining = -1;
+            if (timeoutMicros >= 0)
+            {
+                remaining = (juce::int64)((deadline - juce::Time::getHighResolutionTicks()) / ticksPerMicro);
+                if (remaining <= 0)
+                    return false;
+            }
+
+            futexWait(word.value, current, remaining);
+        }
+       #else
+        juce::ignoreUnused(timeoutMicros);
+        return false;
+       #endif
+    }
+}
+
+//==============================================================================
+SandboxChannel::SandboxChannel(const juce::String& nameToUse, Layout* layoutToUse, bool owner)
+    : name(nameToUse), layout(layoutToUse), isOwner(owner), linked(owner)
+{
+}
+
+SandboxChannel::~SandboxChannel()
+{
+    unlink();
+
+   #if JUCE_LINUX
+    munmap(layout, sizeof(Layout));
+   #endif
+}
+
+void SandboxChannel::unlink()
+{
+    if (!linked)
+        return;
+
+    linked = false;
+
+   #if JUCE_LINUX
+    shm_unlink(name.toRawUTF8());
+   #endif
+}
+
+bool SandboxChannel::isSupported()
+{
+   #if JUCE_LINUX
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+std::unique_ptr<SandboxChannel> SandboxChannel::create(const juce::String& name)
+{
+   #if JUCE_LINUX
+    if (auto* address = mapSegment(name, true))
+        return std::unique_ptr<SandboxChannel>(new SandboxChannel(name, new (address) Layout, true));
+   #else
+    juce::ignoreUnused(name);
+   #endif
+    return nullptr;
+}
+
+std::unique_ptr<SandboxChannel> SandboxChannel::open(const juce::String& name)
+{
+   #if JUCE_LINUX
+    if (auto* address = mapSegment(name, false))
+        return std::unique_ptr<SandboxChannel>(new SandboxChannel(name, static_cast<Layout*>(address), false));
+   #else
+    juce::ignoreUnused(name);
+   #endif
+    return nullptr;
+}
+
+//==============================================================================
+bool SandboxChannel::waitFor(Word& word, juce::uint32 expected, int timeoutMicros) noexcept
+{
+    return waitUntil(word, timeoutMicros, [expected](juce::uint32 current) { return current == expected; });
+}
+
+bool SandboxChannel::waitForChange(Word& word, juce::uint32 value, int timeoutMicros) noexcept
+{
+    return waitUntil(word, timeoutMicros, [value](juce::uint32 current) { return current != value; });
+}
+
+void SandboxChannel::wake(Word& word) noexcept
+{
+   #if JUCE_LINUX
+    // Orders the caller's store of the value before the look at sleepers;
+    // pairs with the count a waiter takes before its last read of the value
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (word.sleepers.load(std::memory_order_relaxed) == 0)
+        return;
+
+    syscall(SYS_futex, futexWord(word.value), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+   #else
+    juce::ignoreUnused(word);
+   #endif
+}
+
+void SandboxChannel::writeMidi(const juce::MidiBuffer& midi, Layout& layout) noexcept
+{
+    int used = 0;
+
+    for (const auto metadata : midi)
+    {
+        auto needed = (int)(2 * sizeof(juce::int32)) + metadata.numBytes;
+        if (used + needed > midiCapacity)
+            break;
+
+        juce::int32 header[2] = { (juce::int32)metadata.samplePosition, (juce::int32)metadata.numBytes };
+        std::memcpy(layout.midi + used, header, sizeof(header));
+        std::memcpy(layout.midi + used + sizeof(header), metadata.data, (size_t)metadata.numBytes);
+        used += needed;
+    }
+
+    layout.midiBytes = used;
+}
+
+void SandboxChannel::readMidi(const Layout& layout, juce::MidiBuffer& midi) noexcept
+{
+    midi.clear();
+
+    auto total = juce::jlimit(0, midiCapacity, (int)layout.midiBytes);
+    int used = 0;
+
+    while (used + (int)(2 * sizeof(juce::int32)) <= total)
+    {
+        juce::int32 header[2];
+        std::memcpy(header, layout.midi + used, sizeof(header));
+        used += (int)sizeof(header);
+
+        if (header[1] <= 0 || used + header[1] > total)
+            break;
+
+        midi.addEvent(layout.midi + used, header[1], header[0]);
+        used += header[1];
+    }
+}
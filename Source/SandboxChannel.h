@@ -0,0 +1,115 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Shared memory between the host and one sandbox process. The host writes a
+// block's audio and MIDI straight into the mapped area, bumps a sequence word
+// and wakes the sandbox; the sandbox processes the audio where it lies and
+// answers the same way, so a block costs one copy in and one copy out.
+//
+// The sequence words double as futexes, so neither side needs a pipe or a
+// syscall unless it actually has to sleep: each word counts the sides asleep
+// on it, and waking one that nobody sleeps on is only a load. Linux only; isSupported() is false
+// everywhere else and create() returns nothing.
+class SandboxChannel
+{
+public:
+    static constexpr int maxChannels = 8;
+    static constexpr int maxBlockSize = 4096;
+    static constexpr int midiCapacity = 16 * 1024;
+    static constexpr int stateCapacity = 8 * 1024 * 1024;
+
+    enum Command : juce::uint32
+    {
+        noCommand = 0,
+        prepareCommand,
+        getStateCommand,
+        setStateCommand,
+        shutdownCommand
+    };
+
+    struct Word
+    {
+        std::atomic<juce::uint32> value;
+
+        // Waiters that have gone past spinning and may be in the kernel
+        std::atomic<juce::uint32> sleepers;
+    };
+
+    struct Layout
+    {
+        // Audio: request is bumped by the host, response set to match by the sandbox
+        Word request;
+        Word response;
+
+        // Control commands from the host's message thread, same handshake
+        Word controlRequest;
+        Word controlResponse;
+
+        // Set by the sandbox once the plugin is loaded
+        Word ready;
+
+        juce::int32 numChannels;
+        juce::int32 numSamples;
+        juce::int32 midiBytes;
+
+        // Time the sandbox spent in processBlock for the last request
+        std::atomic<float> processMicros;
+
+        juce::uint32 command;
+        juce::int32 commandSucceeded;
+        double sampleRate;
+        juce::int32 blockSize;
+        juce::int32 latencySamples;
+        juce::int32 stateBytes;
+
+        float audio[maxChannels][maxBlockSize];
+        juce::uint8 midi[midiCapacity];
+        juce::uint8 state[stateCapacity];
+    };
+
+    ~SandboxChannel();
+
+    static bool isSupported();
+
+    // Host: creates a new zeroed segment
+    static std::unique_ptr<SandboxChannel> create(const juce::String& name);
+
+    // Sandbox: maps the segment the host created
+    static std::unique_ptr<SandboxChannel> open(const juce::String& name);
+
+    // Host: removes the segment's name once the sandbox has mapped it, so
+    // nothing is left behind in /dev/shm even if the host crashes. The
+    // memory stays until both sides have unmapped it, but a new sandbox
+    // needs a new channel.
+    void unlink();
+    bool isLinked() const { return linked; }
+
+    Layout& get() noexcept { return *layout; }
+    const juce::String& getName() const { return name; }
+
+    //==============================================================================
+    // Spins briefly, then sleeps on the word until it holds expected. A negative
+    // timeout waits forever. Returns false on timeout.
+    static bool waitFor(Word& word, juce::uint32 expected, int timeoutMicros) noexcept;
+
+    // Sleeps until the word no longer holds value. Returns false on timeout.
+    static bool waitForChange(Word& word, juce::uint32 value, int timeoutMicros) noexcept;
+
+    // Call after storing the word's new value. Only enters the kernel if
+    // the other side is asleep on it.
+    static void wake(Word& word) noexcept;
+
+    // Packs events as [position, size, bytes]; whatever doesn't fit is dropped
+    static void writeMidi(const juce::MidiBuffer& midi, Layout& layout) noexcept;
+    static void readMidi(const Layout& layout, juce::MidiBuffer& midi) noexcept;
+
+private:
+    SandboxChannel(const juce::String& name, Layout* layout, bool owner);
+
+    const juce::String name;
+    Layout* const layout;
+    const bool isOwner;
+    bool linked;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SandboxChannel)
+};
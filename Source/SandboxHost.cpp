@@ -0,0 +1,282 @@
+#include "SandboxHost.h"
+
+#if JUCE_LINUX
+ #include <unistd.h>
+#endif
+
+namespace
+{
+    int getParentProcess()
+    {
+       #if JUCE_LINUX
+        return (int)getppid();
+       #else
+        return 0;
+       #endif
+    }
+}
+
+//==============================================================================
+bool SandboxHost::isSandboxCommandLine(const juce::String& commandLine)
+{
+    return juce::StringArray::fromTokens(commandLine, true).contains(commandLineFlag);
+}
+
+SandboxHost::SandboxHost(const juce::String& commandLine)
+    : juce::Thread("Sandbox Audio"),
+    parentProcess(getParentProcess())
+{
+    auto args = juce::StringArray::fromTokens(commandLine, true);
+    auto flag = args.indexOf(commandLineFlag);
+    if (flag < 0 || flag + 2 >= args.size())
+    {
+        DBG("Sandbox: expected " << commandLineFlag << " <shared memory> <setup file>");
+        return;
+    }
+
+    channel = SandboxChannel::open(args[flag + 1].unquoted());
+    if (channel == nullptr)
+    {
+        DBG("Sandbox: couldn't open the shared memory channel");
+        return;
+    }
+
+    formatManager.addDefaultFormats();
+    if (!loadPlugin(juce::File(args[flag + 2].unquoted())))
+        return;
+
+    auto& shared = channel->get();
+    shared.latencySamples = plugin->getLatencySamples();
+    shared.ready.value.store(1, std::memory_order_release);
+    SandboxChannel::wake(shared.ready);
+
+    controlThread = std::make_unique<ControlThread>(*this);
+    controlThread->startThread();
+    startThread(juce::Thread::realtimeAudioPriority);
+}
+
+SandboxHost::~SandboxHost()
+{
+    if (controlThread != nullptr)
+        controlThread->stopThread(2000);
+
+    stopThread(2000);
+
+    if (plugin != nullptr)
+        plugin->releaseResources();
+}
+
+bool SandboxHost::loadPlugin(const juce::File& setupFile)
+{
+    auto setup = juce::parseXML(setupFile);
+    if (setup == nullptr)
+    {
+        DBG("Sandbox: couldn't read " << setupFile.getFullPathName());
+        return false;
+    }
+
+    juce::PluginDescription desc;
+    auto* descXml = setup->getChildByName("PLUGIN");
+    if (descXml == nullptr || !desc.loadFromXml(*descXml))
+    {
+        DBG("Sandbox: setup file has no plugin description");
+        return false;
+    }
+
+    auto sampleRate = setup->getDoubleAttribute("sampleRate", 44100.0);
+    auto blockSize = setup->getIntAttribute("blockSize", 512);
+
+    juce::String error;
+    auto instance = formatManager.createPluginInstance(desc, sampleRate, blockSize, error);
+
+    // Saved descriptions can be partial; rescan the file like the host does
+    for (auto* format : formatManager.getFormats())
+    {
+        if (instance != nullptr || format->getName() != desc.pluginFormatName)
+            continue;
+
+        juce::OwnedArray<juce::PluginDescription> descriptions;
+        format->findAllTypesForFile(descriptions, desc.fileOrIdentifier);
+        if (!descriptions.isEmpty())
+            instance = format->createInstanceFromDescription(*descriptions[0], sampleRate, blockSize, error);
+    }
+
+    if (instance == nullptr)
+    {
+        DBG("Sandbox: failed to create " << desc.name << ": " << error);
+        return false;
+    }
+
+    instance->setRateAndBufferSizeDetails(sampleRate, blockSize);
+
+    if (auto* bus = instance->getBus(true, 0))
+        bus->enable();
+    if (auto* bus = instance->getBus(false, 0))
+        bus->enable();
+
+    if (!instance->setBusesLayout(instance->getBusesLayout()))
+    {
+        DBG("Sandbox: failed to set the bus layout for " << desc.name);
+        return false;
+    }
+
+    instance->prepareToPlay(sampleRate, blockSize);
+
+    juce::MemoryBlock state;
+    if (auto* stateXml = setup->getChildByName("State"))
+        state.fromBase64Encoding(stateXml->getStringAttribute("data"));
+
+    if (state.getSize() > 0)
+        instance->setStateInformation(state.getData(), (int)state.getSize());
+
+    plugin = std::move(instance);
+    DBG("Sandbox: loaded " << desc.name);
+    return true;
+}
+
+void SandboxHost::run()
+{
+    auto& shared = channel->get();
+    auto lastRequest = shared.request.value.load(std::memory_order_acquire);
+
+    auto numChannels = juce::jlimit(1, SandboxChannel::maxChannels,
+        juce::jmax(plugin->getTotalNumInputChannels(), plugin->getTotalNumOutputChannels()));
+    midi.ensureSize(SandboxChannel::midiCapacity);
+
+    while (!threadShouldExit())
+    {
+        if (!SandboxChannel::waitForChange(shared.request, lastRequest, parentCheckMicros))
+        {
+            // Nobody left to answer to
+            if (getParentProcess() != parentProcess)
+            {
+                quit();
+                return;
+            }
+            continue;
+        }
+
+        lastRequest = shared.request.value.load(std::memory_order_acquire);
+
+        auto numSamples = juce::jlimit(0, SandboxChannel::maxBlockSize, (int)shared.numSamples);
+        auto numSent = juce::jlimit(0, SandboxChannel::maxChannels, (int)shared.numChannels);
+
+        // The plugin works on the shared audio in place
+        float* channels[SandboxChannel::maxChannels];
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            channels[ch] = shared.audio[ch];
+            if (ch >= numSent)
+                juce::FloatVectorOperations::clear(channels[ch], numSamples);
+        }
+
+        view.setDataToReferTo(channels, numChannels, numSamples);
+        SandboxChannel::readMidi(shared, midi);
+
+        auto start = juce::Time::getHighResolutionTicks();
+        {
+            const juce::ScopedLock sl(plugin->getCallbackLock());
+            if (!plugin->isSuspended())
+                plugin->processBlock(view, midi);
+        }
+        auto elapsed = juce::Time::getHighResolutionTicks() - start;
+        shared.processMicros = (float)(juce::Time::highResolutionTicksToSeconds(elapsed) * 1.0e6);
+
+        SandboxChannel::writeMidi(midi, shared);
+
+        shared.response.value.store(lastRequest, std::memory_order_release);
+        SandboxChannel::wake(shared.response);
+    }
+}
+
+void SandboxHost::handleCommand(SandboxChannel::Layout& shared)
+{
+    bool succeeded = true;
+
+    switch (shared.command)
+    {
+        case SandboxChannel::prepareCommand:
+            plugin->suspendProcessing(true);
+            plugin->setRateAndBufferSizeDetails(shared.sampleRate, shared.blockSize);
+            plugin->prepareToPlay(shared.sampleRate, shared.blockSize);
+            plugin->suspendProcessing(false);
+            break;
+
+        case SandboxChannel::getStateCommand:
+        {
+            juce::MemoryBlock state;
+            plugin->getStateInformation(state);
+
+            succeeded = state.getSize() <= (size_t)SandboxChannel::stateCapacity;
+            if (succeeded)
+            {
+                state.copyTo(shared.state, 0, state.getSize());
+                shared.stateBytes = (juce::int32)state.getSize();
+            }
+            else
+            {
+                DBG("Sandbox: plugin state of " << (int)state.getSize() << " bytes doesn't fit the channel");
+            }
+            break;
+        }
+
+        case SandboxChannel::setStateCommand:
+            plugin->setStateInformation(shared.state,
+                juce::jlimit(0, SandboxChannel::stateCapacity, (int)shared.stateBytes));
+            break;
+
+        case SandboxChannel::shutdownCommand:
+            quit();
+            break;
+
+        default:
+            succeeded = false;
+            break;
+    }
+
+    shared.latencySamples = plugin->getLatencySamples();
+    shared.commandSucceeded = succeeded ? 1 : 0;
+}
+
+void SandboxHost::quit()
+{
+    juce::MessageManager::callAsync([] { juce::JUCEApplicationBase::quit(); });
+}
+
+//==============================================================================
+SandboxHost::ControlThread::ControlThread(SandboxHost& owner)
+    : juce::Thread("Sandbox Control"),
+    host(owner)
+{
+}
+
+void SandboxHost::ControlThread::run()
+{
+    auto& shared = host.channel->get();
+    auto lastRequest = shared.controlRequest.value.load(std::memory_order_acquire);
+
+    while (!threadShouldExit())
+    {
+        if (!SandboxChannel::waitForChange(shared.controlRequest, lastRequest, parentCheckMicros))
+            continue;
+
+        lastRequest = shared.controlRequest.value.load(std::memory_order_acquire);
+
+        // Plugins expect state and setup calls on the message thread. The event
+        // is shared so an abandoned call can still signal it safely.
+        auto done = std::make_shared<juce::WaitableEvent>();
+        auto* owner = &host;
+        juce::MessageManager::callAsync([owner, &shared, done]
+        {
+            owner->handleCommand(shared);
+            done->signal();
+        });
+
+        while (!done->wait(100))
+            if (threadShouldExit())
+                return;
+
+        shared.controlResponse.value.store(lastRequest, std::memory_order_release);
+        SandboxChannel::wake(shared.controlResponse);
+    }
+}
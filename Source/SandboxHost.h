@@ -0,0 +1,53 @@
+#pragma once
+#include <JuceHeader.h>
+#include "SandboxChannel.h"
+
+// The sandbox side of an out-of-process plugin. The application starts in
+// this mode when launched with --sandbox: instead of opening a window it
+// loads the one plugin described in the setup file, restores its state, and
+// serves blocks from the shared memory channel on a real-time thread until
+// the host asks it to stop or goes away.
+class SandboxHost : private juce::Thread
+{
+public:
+    static constexpr const char* commandLineFlag = "--sandbox";
+
+    // Arguments after the flag: <shared memory name> <setup file>
+    static bool isSandboxCommandLine(const juce::String& commandLine);
+
+    explicit SandboxHost(const juce::String& commandLine);
+    ~SandboxHost() override;
+
+    bool isRunning() const { return plugin != nullptr; }
+
+private:
+    // Runs control commands on the message thread, where plugins expect them
+    class ControlThread : public juce::Thread
+    {
+    public:
+        explicit ControlThread(SandboxHost& owner);
+        void run() override;
+
+    private:
+        SandboxHost& host;
+    };
+
+    bool loadPlugin(const juce::File& setupFile);
+    void run() override;
+    void handleCommand(SandboxChannel::Layout& shared);
+    void quit();
+
+    juce::AudioPluginFormatManager formatManager;
+    std::unique_ptr<juce::AudioPluginInstance> plugin;
+    std::unique_ptr<SandboxChannel> channel;
+    std::unique_ptr<ControlThread> controlThread;
+
+    juce::AudioBuffer<float> view;
+    juce::MidiBuffer midi;
+    int parentProcess = 0;
+
+    // How often an idle sandbox checks that the host is still there
+    static constexpr int parentCheckMicros = 200000;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SandboxHost)
+};
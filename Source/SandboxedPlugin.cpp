@@ -0,0 +1,433 @@
+#include "SandboxedPlugin.h"
+#include "SandboxHost.h"
+
+namespace
+{
+    // High resolution ticks by which the current callback's sandboxed plugins
+    // have to have answered; 0 outside a ScopedDeadline
+    thread_local juce::int64 responseDeadline = 0;
+
+    juce::AudioProcessor::BusesProperties getBuses(const juce::PluginDescription& description)
+    {
+        auto numInputs = juce::jlimit(0, SandboxChannel::maxChannels,
+            description.numInputChannels > 0 ? description.numInputChannels : 2);
+        auto numOutputs = juce::jlimit(1, SandboxChannel::maxChannels,
+            description.numOutputChannels > 0 ? description.numOutputChannels : 2);
+
+        juce::AudioProcessor::BusesProperties buses;
+        if (numInputs > 0)
+            buses = buses.withInput("Input", juce::AudioChannelSet::canonicalChannelSet(numInputs), true);
+        return buses.withOutput("Output", juce::AudioChannelSet::canonicalChannelSet(numOutputs), true);
+    }
+}
+
+//==============================================================================
+std::unique_ptr<SandboxedPlugin> SandboxedPlugin::launch(const juce::PluginDescription& description,
+    const juce::MemoryBlock& state, double sampleRate, int blockSize, juce::String& error)
+{
+    if (!SandboxChannel::isSupported())
+    {
+        error = "Sandboxing isn't supported on this platform";
+        return nullptr;
+    }
+
+    std::unique_ptr<SandboxedPlugin> plugin(new SandboxedPlugin(description, state, sampleRate, blockSize));
+    if (!plugin->startSandbox(error))
+        return nullptr;
+
+    return plugin;
+}
+
+std::unique_ptr<SandboxedPlugin> SandboxedPlugin::spawn(const juce::PluginDescription& description,
+    const juce::MemoryBlock& state, double sampleRate, int blockSize, juce::String& error)
+{
+    if (!SandboxChannel::isSupported())
+    {
+        error = "Sandboxing isn't supported on this platform";
+        return nullptr;
+    }
+
+    std::unique_ptr<SandboxedPlugin> plugin(new SandboxedPlugin(description, state, sampleRate, blockSize));
+    if (!plugin->spawnSandbox(error))
+        return nullptr;
+
+    return plugin;
+}
+
+SandboxedPlugin::SandboxedPlugin(const juce::PluginDescription& description, const juce::MemoryBlock& state,
+    double sampleRate, int blockSize)
+    : juce::AudioPluginInstance(getBuses(description)),
+    pluginDescription(description),
+    lastState(state),
+    currentSampleRate(sampleRate),
+    currentBlockSize(juce::jmin(blockSize, SandboxChannel::maxBlockSize))
+{
+    setRateAndBufferSizeDetails(sampleRate, currentBlockSize);
+}
+
+SandboxedPlugin::~SandboxedPlugin()
+{
+    stopTimer();
+    stopSandbox();
+}
+
+//==============================================================================
+bool SandboxedPlugin::startSandbox(juce::String& error)
+{
+    if (!spawnSandbox(error))
+        return false;
+
+    auto startup = checkStartup(error);
+    while (startup == Startup::pending)
+    {
+        SandboxChannel::waitFor(channel->get().ready, 1, 50000);
+        startup = checkStartup(error);
+    }
+
+    return startup == Startup::ready;
+}
+
+bool SandboxedPlugin::spawnSandbox(juce::String& error)
+{
+    // A channel is unlinked once its sandbox is up, so a respawn needs a new one
+    if (channel == nullptr || !channel->isLinked())
+    {
+        channel = nullptr;
+        auto name = "/vstmic-" + juce::String::toHexString(juce::Random::getSystemRandom().nextInt64());
+        channel = SandboxChannel::create(name);
+        if (channel == nullptr)
+        {
+            error = "Couldn't create the shared memory channel";
+            return false;
+        }
+    }
+
+    // Nothing is in flight once the audio thread has been kept out
+    auto& shared = channel->get();
+    shared.ready.value = 0;
+    shared.response.value = shared.request.value.load();
+    shared.controlResponse.value = shared.controlRequest.value.load();
+    awaitingResponse = false;
+
+    juce::XmlElement setup("Sandbox");
+    setup.setAttribute("sampleRate", currentSampleRate);
+    setup.setAttribute("blockSize", currentBlockSize);
+    setup.addChildElement(pluginDescription.createXml().release());
+
+    auto* stateElement = setup.createNewChildElement("State");
+    stateElement->setAttribute("data", lastState.toBase64Encoding());
+
+    setupFile = juce::File::getSpecialLocation(juce::File::tempDirectory)
+        .getNonexistentChildFile("vstmic-sandbox", ".xml");
+
+    if (!setup.writeTo(setupFile))
+    {
+        error = "Couldn't write " + setupFile.getFullPathName();
+        return false;
+    }
+
+    juce::StringArray args;
+    args.add(juce::File::getSpecialLocation(juce::File::currentExecutableFile).getFullPathName());
+    args.add(SandboxHost::commandLineFlag);
+    args.add(channel->getName());
+    args.add(setupFile.getFullPathName());
+
+    sandbox = std::make_unique<juce::ChildProcess>();
+    if (!sandbox->start(args, 0))
+    {
+        error = "Couldn't start the sandbox process";
+        sandbox = nullptr;
+        setupFile.deleteFile();
+        return false;
+    }
+
+    startupDeadline = juce::Time::getMillisecondCounter() + (juce::uint32)startupTimeoutMs;
+    return true;
+}
+
+SandboxedPlugin::Startup SandboxedPlugin::checkStartup(juce::String& error)
+{
+    if (alive.load())
+        return Startup::ready;
+
+    if (sandbox == nullptr)
+        return Startup::failed;
+
+    auto& shared = channel->get();
+    if (shared.ready.value.load(std::memory_order_acquire) != 1)
+    {
+        // Loading a plugin can take a while; give up early if the sandbox dies
+        if (sandbox->isRunning() && juce::Time::getMillisecondCounter() < startupDeadline)
+            return Startup::pending;
+
+        error = "The sandbox failed to load " + pluginDescription.name;
+        sandbox->kill();
+        sandbox = nullptr;
+        setupFile.deleteFile();
+        return Startup::failed;
+    }
+
+    setupFile.deleteFile();
+    channel->unlink();
+    setLatencySamples(shared.latencySamples);
+
+    alive = true;
+    startTimer(100);
+
+    DBG("Started sandbox for " << pluginDescription.name << " on " << channel->getName());
+    return Startup::ready;
+}
+
+void SandboxedPlugin::stopSandbox()
+{
+    alive = false;
+    waitForAudioThread();
+
+    if (sandbox != nullptr)
+    {
+        if (sandbox->isRunning())
+        {
+            sendCommand(SandboxChannel::shutdownCommand);
+            if (!sandbox->waitForProcessToFinish(1000))
+                sandbox->kill();
+        }
+        sandbox = nullptr;
+    }
+
+    channel = nullptr;
+}
+
+void SandboxedPlugin::waitForAudioThread()
+{
+    // alive is already false, so the audio thread won't come back in
+    while (inBlock.load())
+        juce::Thread::yield();
+}
+
+bool SandboxedPlugin::sendCommand(SandboxChannel::Command command)
+{
+    if (channel == nullptr || sandbox == nullptr)
+        return false;
+
+    auto& shared = channel->get();
+    shared.command = command;
+
+    auto request = shared.controlRequest.value.load() + 1;
+    shared.controlRequest.value.store(request, std::memory_order_release);
+    SandboxChannel::wake(shared.controlRequest);
+
+    if (!SandboxChannel::waitFor(shared.controlResponse, request, commandTimeoutMs * 1000))
+    {
+        DBG("Sandbox for " << pluginDescription.name << " didn't answer command " << (int)command);
+        return false;
+    }
+
+    if (shared.latencySamples != getLatencySamples())
+        setLatencySamples(shared.latencySamples);
+
+    return shared.commandSucceeded != 0;
+}
+
+void SandboxedPlugin::timerCallback()
+{
+    if (alive.load())
+    {
+        if (sandbox != nullptr && sandbox->isRunning())
+            return;
+
+        // Stop sending it audio, then bring it back with the last state we saw
+        alive = false;
+        waitForAudioThread();
+        ++numCrashes;
+        sandbox = nullptr;
+        nextRestartTime = 0;
+        DBG("Sandbox for " << pluginDescription.name << " exited; bypassing it and restarting");
+    }
+
+    juce::String error;
+
+    // A respawn is loading; poll it rather than hold up the message thread
+    if (sandbox != nullptr)
+    {
+        auto startup = checkStartup(error);
+        if (startup == Startup::pending)
+            return;
+
+        if (startup == Startup::ready)
+        {
+            failedRestarts = 0;
+
+            // Changes made while it loaded went to lastState only
+            if (stateChangedWhileDown)
+                setStateInformation(lastState.getData(), (int)lastState.getSize());
+            return;
+        }
+    }
+    else
+    {
+        if (failedRestarts >= maxFailedRestarts || juce::Time::getMillisecondCounter() < nextRestartTime)
+            return;
+
+        stateChangedWhileDown = false;
+        if (spawnSandbox(error))
+            return;
+    }
+
+    ++failedRestarts;
+    nextRestartTime = juce::Time::getMillisecondCounter() + 1000u * (juce::uint32)failedRestarts;
+    DBG("Restarting the sandbox for " << pluginDescription.name << " failed: " << error);
+}
+
+juce::String SandboxedPlugin::getStatusText() const
+{
+    if (!alive.load())
+    {
+        if (failedRestarts >= maxFailedRestarts)
+            return "sandbox crashed, gave up restarting";
+        return "sandbox crashed, restarting";
+    }
+
+    juce::String text;
+    text << "sandboxed, +" << juce::String(meanOverheadMicros.load(), 0) << " us round trip"
+         << " (max " << juce::String(maxOverheadMicros.load(), 0) << ")";
+
+    if (numCrashes > 0)
+        text << ", " << numCrashes << (numCrashes == 1 ? " crash" : " crashes");
+    if (auto missed = missedBlocks.load())
+        text << ", " << (int)missed << " late";
+    return text;
+}
+
+SandboxedPlugin::ScopedDeadline::ScopedDeadline(juce::int64 startTicks, int numSamples, double sampleRate) noexcept
+    : previousDeadline(responseDeadline)
+{
+    auto budgetSeconds = responseTimeoutFraction * numSamples / juce::jmax(1.0, sampleRate);
+    auto deadline = startTicks + (juce::int64)(budgetSeconds * (double)juce::Time::getHighResolutionTicksPerSecond());
+    responseDeadline = previousDeadline != 0 ? juce::jmin(previousDeadline, deadline) : deadline;
+}
+
+SandboxedPlugin::ScopedDeadline::~ScopedDeadline() noexcept
+{
+    responseDeadline = previousDeadline;
+}
+
+//==============================================================================
+void SandboxedPlugin::fillInPluginDescription(juce::PluginDescription& description) const
+{
+    description = pluginDescription;
+}
+
+void SandboxedPlugin::prepareToPlay(double sampleRate, int maximumBlockSize)
+{
+    currentSampleRate = sampleRate;
+    currentBlockSize = juce::jmin(maximumBlockSize, SandboxChannel::maxBlockSize);
+    maxOverheadMicros = 0.0f;
+
+    if (!alive.load())
+        return;
+
+    auto& shared = channel->get();
+    shared.sampleRate = currentSampleRate;
+    shared.blockSize = currentBlockSize;
+    sendCommand(SandboxChannel::prepareCommand);
+}
+
+void SandboxedPlugin::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi)
+{
+    // Announce ourselves before checking, so stopSandbox() can't miss us
+    inBlock = true;
+    struct Leave { std::atomic<bool>& flag; ~Leave() { flag = false; } } leave { inBlock };
+
+    if (!alive.load())
+        return;
+
+    auto& shared = channel->get();
+    auto numSamples = buffer.getNumSamples();
+    auto numChannels = juce::jmin(buffer.getNumChannels(), SandboxChannel::maxChannels);
+
+    // Still busy with a block we gave up on; let this one through dry
+    if (awaitingResponse)
+    {
+        if (shared.response.value.load(std::memory_order_acquire) != sentRequest)
+        {
+            ++missedBlocks;
+            return;
+        }
+        awaitingResponse = false;
+    }
+
+    // Plugins earlier in the callback may have used up the time there was
+    auto timeoutMicros = getResponseTimeoutMicros(numSamples);
+    if (numSamples > SandboxChannel::maxBlockSize || timeoutMicros <= 0)
+    {
+        ++missedBlocks;
+        return;
+    }
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        juce::FloatVectorOperations::copy(shared.audio[ch], buffer.getReadPointer(ch), numSamples);
+
+    SandboxChannel::writeMidi(midi, shared);
+    shared.numChannels = numChannels;
+    shared.numSamples = numSamples;
+
+    auto start = juce::Time::getHighResolutionTicks();
+    sentRequest = shared.request.value.load(std::memory_order_relaxed) + 1;
+    shared.request.value.store(sentRequest, std::memory_order_release);
+    SandboxChannel::wake(shared.request);
+
+    if (!SandboxChannel::waitFor(shared.response, sentRequest, timeoutMicros))
+    {
+        awaitingResponse = true;
+        ++missedBlocks;
+        return;
+    }
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        juce::FloatVectorOperations::copy(buffer.getWritePointer(ch), shared.audio[ch], numSamples);
+
+    SandboxChannel::readMidi(shared, midi);
+
+    auto roundTrip = (float)(juce::Time::highResolutionTicksToSeconds(
+        juce::Time::getHighResolutionTicks() - start) * 1.0e6);
+    auto overhead = juce::jmax(0.0f, roundTrip - shared.processMicros.load());
+
+    meanOverheadMicros = meanOverheadMicros.load() + 0.01f * (overhead - meanOverheadMicros.load());
+    if (overhead > maxOverheadMicros.load())
+        maxOverheadMicros = overhead;
+}
+
+int SandboxedPlugin::getResponseTimeoutMicros(int numSamples) const noexcept
+{
+    if (responseDeadline == 0)
+        return (int)(responseTimeoutFraction * 1.0e6 * numSamples / juce::jmax(1.0, currentSampleRate));
+
+    return (int)(juce::Time::highResolutionTicksToSeconds(
+        responseDeadline - juce::Time::getHighResolutionTicks()) * 1.0e6);
+}
+
+//==============================================================================
+void SandboxedPlugin::getStateInformation(juce::MemoryBlock& destData)
+{
+    if (alive.load() && sendCommand(SandboxChannel::getStateCommand))
+    {
+        auto& shared = channel->get();
+        lastState.replaceAll(shared.state, (size_t)juce::jlimit(0, SandboxChannel::stateCapacity, (int)shared.stateBytes));
+    }
+
+    destData = lastState;
+}
+
+void SandboxedPlugin::setStateInformation(const void* data, int sizeInBytes)
+{
+    lastState.replaceAll(data, (size_t)sizeInBytes);
+    stateChangedWhileDown = !alive.load();
+
+    if (!alive.load() || sizeInBytes > SandboxChannel::stateCapacity)
+        return;
+
+    auto& shared = channel->get();
+    std::memcpy(shared.state, data, (size_t)sizeInBytes);
+    shared.stateBytes = sizeInBytes;
+    sendCommand(SandboxChannel::setStateCommand);
+}
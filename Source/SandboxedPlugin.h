@@ -0,0 +1,132 @@
+#pragma once
+#include <JuceHeader.h>
+#include "SandboxChannel.h"
+
+// Stands in for a plugin that runs in a sandbox process of its own, so a
+// crashing plugin takes down its sandbox rather than the host. The chain
+// treats it like any other plugin: processBlock hands the audio across the
+// shared memory channel and waits for the answer, which costs a round trip
+// per block on top of the plugin's own time. That overhead is measured and
+// shown next to the plugin.
+//
+// If the sandbox doesn't answer in time, or has died, the block passes
+// through dry. A dead sandbox is respawned in the background with the
+// plugin's last known state and swapped back in once it has loaded. Plugin
+// editors aren't available across the process boundary.
+class SandboxedPlugin : public juce::AudioPluginInstance,
+    private juce::Timer
+{
+public:
+    // Message thread. Starts a sandbox for the described plugin and waits for
+    // it to load; returns nothing and sets error if it couldn't.
+    static std::unique_ptr<SandboxedPlugin> launch(const juce::PluginDescription& description,
+        const juce::MemoryBlock& state, double sampleRate, int blockSize, juce::String& error);
+
+    // Message thread. Starts the sandbox without waiting for it to load, so
+    // several can load at once; poll checkStartup() until it isn't pending.
+    static std::unique_ptr<SandboxedPlugin> spawn(const juce::PluginDescription& description,
+        const juce::MemoryBlock& state, double sampleRate, int blockSize, juce::String& error);
+
+    enum class Startup { pending, ready, failed };
+    Startup checkStartup(juce::String& error);
+
+    ~SandboxedPlugin() override;
+
+    bool isSandboxAlive() const { return alive.load(); }
+    int getNumCrashes() const { return numCrashes; }
+    juce::uint64 getNumMissedBlocks() const { return missedBlocks.load(); }
+
+    // Round trip minus the plugin's own processing time
+    float getMeanOverheadMicros() const { return meanOverheadMicros.load(); }
+    float getMaxOverheadMicros() const { return maxOverheadMicros.load(); }
+
+    // One line for the plugin list
+    juce::String getStatusText() const;
+
+    // Audio threads. While one of these is alive on a thread, sandboxed
+    // plugins called on it stop waiting for answers at a deadline a share of
+    // the block after startTicks, so however many a callback runs, they share
+    // that one budget. Scopes nest and the earlier deadline wins. Without
+    // one, each plugin waits up to that share of its own block.
+    struct ScopedDeadline
+    {
+        ScopedDeadline(juce::int64 startTicks, int numSamples, double sampleRate) noexcept;
+        ~ScopedDeadline() noexcept;
+
+    private:
+        const juce::int64 previousDeadline;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedDeadline)
+    };
+
+    //==============================================================================
+    void fillInPluginDescription(juce::PluginDescription& description) const override;
+    const juce::String getName() const override { return pluginDescription.name; }
+
+    void prepareToPlay(double sampleRate, int maximumBlockSize) override;
+    void releaseResources() override {}
+    void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) override;
+
+    double getTailLengthSeconds() const override { return 0.0; }
+    bool acceptsMidi() const override { return true; }
+    bool producesMidi() const override { return false; }
+
+    juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+    bool hasEditor() const override { return false; }
+
+    int getNumPrograms() override { return 1; }
+    int getCurrentProgram() override { return 0; }
+    void setCurrentProgram(int) override {}
+    const juce::String getProgramName(int) override { return {}; }
+    void changeProgramName(int, const juce::String&) override {}
+
+    void getStateInformation(juce::MemoryBlock& destData) override;
+    void setStateInformation(const void* data, int sizeInBytes) override;
+
+private:
+    SandboxedPlugin(const juce::PluginDescription& description, const juce::MemoryBlock& state,
+        double sampleRate, int blockSize);
+
+    bool startSandbox(juce::String& error);
+    bool spawnSandbox(juce::String& error);
+    void stopSandbox();
+    void waitForAudioThread();
+    bool sendCommand(SandboxChannel::Command command);
+    void timerCallback() override;
+
+    const juce::PluginDescription pluginDescription;
+    juce::MemoryBlock lastState;
+    double currentSampleRate;
+    int currentBlockSize;
+
+    std::unique_ptr<SandboxChannel> channel;
+    std::unique_ptr<juce::ChildProcess> sandbox;
+    juce::File setupFile;
+    juce::uint32 startupDeadline = 0;
+
+    std::atomic<bool> alive { false };
+    std::atomic<bool> inBlock { false };
+
+    // Audio thread only
+    bool awaitingResponse = false;
+    juce::uint32 sentRequest = 0;
+
+    std::atomic<float> meanOverheadMicros { 0.0f };
+    std::atomic<float> maxOverheadMicros { 0.0f };
+    std::atomic<juce::uint64> missedBlocks { 0 };
+
+    int numCrashes = 0;
+    int failedRestarts = 0;
+    bool stateChangedWhileDown = false;
+    juce::uint32 nextRestartTime = 0;
+
+    // Share of the block the audio thread waits for answers before giving up
+    static constexpr double responseTimeoutFraction = 0.75;
+
+    int getResponseTimeoutMicros(int numSamples) const noexcept;
+    static constexpr int startupTimeoutMs = 10000;
+    static constexpr int commandTimeoutMs = 2000;
+    static constexpr int maxFailedRestarts = 5;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SandboxedPlugin)
+};
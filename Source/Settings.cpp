@@ -1,4 +1,6 @@
 #include "Settings.h"
+#include "SandboxedPlugin.h"
+#include "ChainStateFile.h"
 
 bool Settings::saveState(juce::AudioDeviceManager& deviceManager)
 {
@@ -90,86 +92,57 @@ bool Settings::loadState(juce::AudioDeviceManager& deviceManager)
     return false;
 }
 
-bool Settings::savePluginState(const std::vector<std::unique_ptr<PluginInstance>>& plugins)
+bool Settings::savePluginState(const std::vector<std::unique_ptr<PluginInstance>>& plugins, int strip)
 {
-    auto stateFile = getPluginStateFile();
+    auto stateFile = getPluginStateFile(strip);
     DBG("Saving plugin state to: " << stateFile.getFullPathName());
-
-    juce::XmlElement rootElement("PluginState");
     DBG("Number of plugins to save: " << plugins.size());
 
+    std::vector<SavedPlugin> saved;
     for (int i = 0; i < plugins.size(); ++i)
     {
         auto& plugin = plugins[i];
-        if (plugin != nullptr && plugin->processor != nullptr)
-        {
-            auto pluginElement = std::make_unique<juce::XmlElement>("Plugin");
-
-            // Save basic plugin info
-            pluginElement->setAttribute("index", i);
-            pluginElement->setAttribute("name", plugin->processor->getName());
-
-            // Save the plugin description
-            juce::PluginDescription desc = plugin->processor->getPluginDescription();
-            DBG("Saving plugin " << i << ":");
-            DBG(" - Name: " << desc.name);
-            DBG(" - Format: " << desc.pluginFormatName);
-            DBG(" - File: " << desc.fileOrIdentifier);
-            DBG(" - Manufacturer: " << desc.manufacturerName);
-            DBG(" - Version: " << desc.version);
-
-            if (std::unique_ptr<juce::XmlElement> descXml = desc.createXml())
-            {
-                auto descElement = std::make_unique<juce::XmlElement>("Description");
-
-                // Explicitly save critical information
-                descElement->setAttribute("name", desc.name);
-                descElement->setAttribute("pluginFormatName", desc.pluginFormatName);
-                descElement->setAttribute("fileOrIdentifier", desc.fileOrIdentifier);
-                descElement->setAttribute("manufacturerName", desc.manufacturerName);
-                descElement->setAttribute("version", desc.version);
-                descElement->setAttribute("isInstrument", desc.isInstrument);
-                descElement->setAttribute("numInputChannels", desc.numInputChannels);
-                descElement->setAttribute("numOutputChannels", desc.numOutputChannels);
-
-                // Copy remaining attributes from the original XML
-                for (int j = 0; j < descXml->getNumAttributes(); ++j)
-                {
-                    auto attrName = descXml->getAttributeName(j);
-                    auto attrValue = descXml->getAttributeValue(j);
-                    if (!descElement->hasAttribute(attrName)) // Don't overwrite our explicit attributes
-                    {
-                        descElement->setAttribute(attrName, attrValue);
-                    }
-                }
+        if (plugin == nullptr || plugin->processor == nullptr)
+            continue;
+
+        SavedPlugin entry;
+        entry.description = plugin->processor->getPluginDescription();
+        entry.parallelWithPrevious = plugin->parallelWithPrevious;
+        entry.bypassed = plugin->bypassed.load();
+        entry.sandboxed = dynamic_cast<SandboxedPlugin*>(plugin->processor.get()) != nullptr;
+        plugin->stateDirty = false;
+        plugin->processor->getStateInformation(entry.state);
+        plugin->lastSavedState = entry.state;
+        plugin->lastSavedBlob = {};
+        plugin->lastSavedBlobBytes = 0;
+
+        DBG("Saving plugin " << i << ": " << entry.description.name << " (" << entry.description.pluginFormatName
+            << ", " << entry.description.fileOrIdentifier << ", " << (int)entry.state.getSize() << " bytes of state)");
+        saved.push_back(std::move(entry));
+    }
 
-                // Copy any child elements if they exist
-                for (auto* child : descXml->getChildIterator())
-                {
-                    descElement->addChildElement(new juce::XmlElement(*child));
-                }
+    return writePluginState(saved, strip);
+}
 
-                DBG("Saved description XML with " << descElement->getNumAttributes() << " attributes");
-                pluginElement->addChildElement(descElement.release());
-            }
+bool Settings::writePluginState(std::vector<SavedPlugin>& saved, int strip, int scene, juce::uint32 epoch)
+{
+    auto stateFile = getPluginStateFile(strip, scene);
 
-            // Save plugin's internal state
-            juce::MemoryBlock stateData;
-            plugin->processor->getStateInformation(stateData);
-            if (stateData.getSize() > 0)
-            {
-                auto stateElement = std::make_unique<juce::XmlElement>("State");
-                stateElement->setAttribute("data", stateData.toBase64Encoding());
-                pluginElement->addChildElement(stateElement.release());
-                DBG("Saved plugin state data: " << stateData.getSize() << " bytes");
-            }
+    // Blobs go first, so a chain never refers to one that isn't on disk. An
+    // entry with a hash but no state refers to a blob that's already there.
+    for (auto& entry : saved)
+    {
+        if (entry.state.getSize() == 0 || !StateBlobStore::shouldStore(entry.state.getSize()))
+            continue;
 
-            rootElement.addChildElement(pluginElement.release());
-            DBG("Successfully saved plugin " << i << ": " << plugin->processor->getName());
-        }
+        if (entry.stateBlob.isEmpty())
+            entry.stateBlob = StateBlobStore::hashOf(entry.state);
+
+        if (!blobStore.store(entry.stateBlob, entry.state))
+            return false;
     }
 
-    bool success = rootElement.writeTo(stateFile);
+    bool success = ChainStateFile::write(stateFile, saved, compressPluginState.load(), epoch);
     if (success)
     {
         DBG("Successfully saved plugin state file to: " << stateFile.getFullPathName());
@@ -181,20 +154,94 @@ bool Settings::savePluginState(const std::vector<std::unique_ptr<PluginInstance>
     return success;
 }
 
-bool Settings::loadPluginState(std::vector<std::unique_ptr<PluginInstance>>& plugins,
-    juce::AudioPluginFormatManager& formatManager,
-    double sampleRate,
-    int bufferSize)
+bool Settings::readPluginState(std::vector<SavedPlugin>& saved, int strip, int scene, juce::uint32* epoch)
 {
-    auto stateFile = getPluginStateFile();
-    DBG("Loading plugin state from: " << stateFile.getFullPathName());
+    auto stateFile = getPluginStateFile(strip, scene);
+    DBG("Reading plugin state from: " << stateFile.getFullPathName());
 
+    // Scenes came after the XML format, so only a strip's first one can have been saved that way
     if (!stateFile.existsAsFile())
+        return scene == 0 && importLegacyPluginState(saved, strip);
+
+    ChainStateFile chainState(stateFile);
+    if (!chainState.readAll(saved))
+    {
+        DBG("Failed to read chain state file");
+        return false;
+    }
+
+    if (epoch != nullptr)
+        *epoch = chainState.getEpoch();
+
+    for (auto& plugin : saved)
+    {
+        if (plugin.stateBlob.isEmpty())
+            continue;
+
+        plugin.stateMapping = blobStore.map(plugin.stateBlob);
+        if (plugin.stateMapping == nullptr)
+            DBG(plugin.description.name << " will start from its default state");
+    }
+
+    DBG("Read " << (int)saved.size() << " of " << chainState.getNumPlugins() << " plugins");
+    return true;
+}
+
+bool Settings::deletePluginState(int strip, int scene)
+{
+    auto stateFile = getPluginStateFile(strip, scene);
+    return !stateFile.existsAsFile() || stateFile.deleteFile();
+}
+
+int Settings::collectStateBlobs()
+{
+    std::set<juce::String> referenced;
+
+    auto stateDirectory = getPluginStateFile(0).getParentDirectory();
+    for (auto& file : stateDirectory.findChildFiles(juce::File::findFiles, false, "chainstate*.bin"))
+    {
+        // A file that can't be read can't be restored either, but an entry
+        // that can't be read might still need its blob
+        ChainStateFile chainState(file);
+        for (int i = 0; i < chainState.getNumPlugins(); ++i)
+        {
+            SavedPlugin plugin;
+            if (!chainState.read(i, plugin, false))
+            {
+                DBG("Not collecting state blobs, " << file.getFileName() << " has an unreadable entry");
+                return 0;
+            }
+
+            if (plugin.stateBlob.isNotEmpty())
+                referenced.insert(plugin.stateBlob);
+        }
+    }
+
+    return blobStore.collectGarbage(referenced);
+}
+
+bool Settings::importLegacyPluginState(std::vector<SavedPlugin>& saved, int strip)
+{
+    auto legacyFile = getLegacyPluginStateFile(strip);
+    if (!legacyFile.existsAsFile())
     {
         DBG("No plugin state file found");
         return false;
     }
 
+    DBG("Importing plugin state from: " << legacyFile.getFullPathName());
+    if (!readLegacyPluginState(legacyFile, saved))
+        return false;
+
+    // Converted once; the XML is kept beside it in case anything went wrong
+    if (writePluginState(saved, strip))
+        legacyFile.moveFileTo(legacyFile.withFileExtension(".xml.imported"));
+
+    return true;
+}
+
+bool Settings::readLegacyPluginState(const juce::File& stateFile, std::vector<SavedPlugin>& saved)
+{
     std::unique_ptr<juce::XmlElement> rootXml(juce::parseXML(stateFile));
     if (rootXml == nullptr)
     {
@@ -202,195 +249,360 @@ bool Settings::loadPluginState(std::vector<std::unique_ptr<PluginInstance>>& plu
         return false;
     }
 
-    DBG("Clearing existing plugins");
-    plugins.clear();
+    saved.clear();
+
+    for (auto* pluginXml : rootXml->getChildIterator())
+    {
+        if (!pluginXml->hasTagName("Plugin"))
+            continue;
+
+        auto* descXml = pluginXml->getChildByName("Description");
+        if (descXml == nullptr)
+        {
+            DBG("No description found for plugin " << pluginXml->getStringAttribute("name"));
+            continue;
+        }
+
+        SavedPlugin plugin;
+        auto& desc = plugin.description;
+
+        // Use the explicit attributes from XML first
+        desc.name = descXml->getStringAttribute("name");
+        desc.pluginFormatName = descXml->getStringAttribute("format", "VST3");
+        desc.fileOrIdentifier = descXml->getStringAttribute("file", descXml->getStringAttribute("fileOrIdentifier"));
+        desc.manufacturerName = descXml->getStringAttribute("manufacturer", descXml->getStringAttribute("manufacturerName"));
+        desc.version = descXml->getStringAttribute("version");
+        desc.isInstrument = descXml->getBoolAttribute("isInstrument", false);
+        desc.numInputChannels = descXml->getIntAttribute("numInputs", descXml->getIntAttribute("numInputChannels", 2));
+        desc.numOutputChannels = descXml->getIntAttribute("numOutputs", descXml->getIntAttribute("numOutputChannels", 2));
+
+        if (auto* stateXml = pluginXml->getChildByName("State"))
+            plugin.state.fromBase64Encoding(stateXml->getStringAttribute("data"));
+
+        plugin.parallelWithPrevious = pluginXml->getBoolAttribute("parallel", false);
+        plugin.bypassed = pluginXml->getBoolAttribute("bypassed", false);
+        plugin.sandboxed = pluginXml->getBoolAttribute("sandboxed", false);
+
+        DBG("Read plugin " << (int)saved.size() << ": " << desc.name << " (" << desc.pluginFormatName
+            << ", " << desc.fileOrIdentifier << ", " << (int)plugin.state.getSize() << " bytes of state)");
+        plugin.slot = (int)saved.size();
+        saved.push_back(std::move(plugin));
+    }
+
+    return true;
+}
 
-    // Debug available formats
-    DBG("Available formats:");
+std::unique_ptr<PluginInstance> Settings::createPlugin(const SavedPlugin& saved,
+    juce::AudioPluginFormatManager& formatManager,
+    PluginScanCache& scanCache,
+    double sampleRate,
+    int bufferSize)
+{
+    const auto& desc = saved.description;
+    DBG("\nAttempting to load plugin: " << desc.name);
+
+    const auto residentBefore = AudioMemoryLock::getResidentBytes();
+
+    // Verify the plugin file exists
+    juce::File pluginFile(desc.fileOrIdentifier);
+    if (!pluginFile.exists())
+    {
+        DBG("WARNING: Plugin file not found at: " << desc.fileOrIdentifier);
+        return nullptr;
+    }
+
+    auto instance = std::make_unique<PluginInstance>();
+    instance->parallelWithPrevious = saved.parallelWithPrevious;
+    instance->bypassed = saved.bypassed;
+
+    // Sandboxed plugins are never loaded into this process
+    if (saved.sandboxed && SandboxChannel::isSupported())
+    {
+        juce::String error;
+        // The sandbox keeps its own copy, to respawn with
+        juce::MemoryBlock state(saved.getStateData(), saved.getStateSize());
+        instance->processor = SandboxedPlugin::launch(desc, state, sampleRate, bufferSize, error);
+        if (instance->processor == nullptr)
+        {
+            DBG("Failed to start sandbox for " << desc.name << ": " << error);
+            return nullptr;
+        }
+
+        // What's on disk is already up to date
+        instance->lastSavedState = saved.state;
+        instance->lastSavedBlob = saved.isStateAvailable() ? saved.stateBlob : juce::String();
+        instance->lastSavedBlobBytes = instance->lastSavedBlob.isNotEmpty() ? saved.getStateSize() : 0;
+        instance->stateDirty = !saved.isStateAvailable();
+
+        DBG("Successfully loaded sandboxed plugin: " << desc.name);
+        return instance;
+    }
+
+    // Find the right format for this plugin
+    juce::AudioPluginFormat* format = nullptr;
     for (int i = 0; i < formatManager.getNumFormats(); ++i)
     {
         auto* f = formatManager.getFormat(i);
-        DBG(" - " << f->getName());
+        if (desc.pluginFormatName == f->getName())
+        {
+            format = f;
+            break;
+        }
     }
 
-    int pluginIndex = 0;
-    for (auto* pluginXml : rootXml->getChildIterator())
+    if (format == nullptr)
     {
-        if (pluginXml->hasTagName("Plugin"))
+        DBG("Could not find format for plugin: " << desc.name <<
+            " (format name: " << desc.pluginFormatName << ")");
+        return nullptr;
+    }
+
+    DBG("Creating plugin instance...");
+    juce::String error;
+    auto pluginInstance = format->createInstanceFromDescription(desc, sampleRate, bufferSize, error);
+
+    if (pluginInstance == nullptr)
+    {
+        DBG("Failed to create plugin instance: " << error);
+
+        // The saved description may be out of date; ask the scan cache, which
+        // only rescans the file if it changed
+        DBG("Looking the plugin up in the scan cache...");
+        juce::PluginDescription current;
+        if (scanCache.findFullDescription(formatManager, desc, current))
         {
-            juce::String pluginName = pluginXml->getStringAttribute("name");
-            DBG("\nAttempting to load plugin " << pluginIndex << ": " << pluginName);
+            DBG("Found " << current.name << " in the scan cache");
+            pluginInstance = format->createInstanceFromDescription(current, sampleRate, bufferSize);
+        }
+        else
+        {
+            DBG("No usable description in the scan cache");
+        }
+    }
 
-            if (auto* descXml = pluginXml->getChildByName("Description"))
-            {
-                // Debug: Print all available attributes in XML
-                DBG("XML attributes available:");
-                for (int i = 0; i < descXml->getNumAttributes(); ++i)
-                {
-                    DBG(" - " << descXml->getAttributeName(i) << ": " << descXml->getAttributeValue(i));
-                }
+    if (pluginInstance == nullptr)
+    {
+        DBG("Failed to create plugin instance for: " << desc.name);
+        return nullptr;
+    }
 
-                // Create plugin description with explicit attribute mapping
-                juce::PluginDescription desc;
-
-                // Use the explicit attributes from XML first
-                desc.name = descXml->getStringAttribute("name");
-                desc.pluginFormatName = descXml->getStringAttribute("format", "VST3");
-                desc.fileOrIdentifier = descXml->getStringAttribute("file", descXml->getStringAttribute("fileOrIdentifier"));
-                desc.manufacturerName = descXml->getStringAttribute("manufacturer", descXml->getStringAttribute("manufacturerName"));
-                desc.version = descXml->getStringAttribute("version");
-                desc.isInstrument = descXml->getBoolAttribute("isInstrument", false);
-                desc.numInputChannels = descXml->getIntAttribute("numInputs", descXml->getIntAttribute("numInputChannels", 2));
-                desc.numOutputChannels = descXml->getIntAttribute("numOutputs", descXml->getIntAttribute("numOutputChannels", 2));
-
-                DBG("Loaded plugin description:");
-                DBG(" - Name: " << desc.name);
-                DBG(" - Format: " << desc.pluginFormatName);
-                DBG(" - File: " << desc.fileOrIdentifier);
-                DBG(" - Manufacturer: " << desc.manufacturerName);
-                DBG(" - Version: " << desc.version);
-                DBG(" - Is Instrument: " << (desc.isInstrument ? "Yes" : "No"));
-                DBG(" - Channels: " << desc.numInputChannels << " in, " << desc.numOutputChannels << " out");
-
-                // Verify the plugin file exists
-                juce::File pluginFile(desc.fileOrIdentifier);
-                if (!pluginFile.exists())
-                {
-                    DBG("WARNING: Plugin file not found at: " << desc.fileOrIdentifier);
-                    continue;
-                }
-                else
-                {
-                    DBG("Plugin file verified at: " << pluginFile.getFullPathName());
-                }
+    instance->processor = std::move(pluginInstance);
 
-                // Find the right format for this plugin
-                juce::AudioPluginFormat* format = nullptr;
-                DBG("Looking for format that matches: " << desc.pluginFormatName);
+    // Configure the plugin
+    DBG("Configuring plugin: " << desc.name);
+    instance->processor->setRateAndBufferSizeDetails(sampleRate, bufferSize);
 
-                for (int i = 0; i < formatManager.getNumFormats(); ++i)
-                {
-                    auto* f = formatManager.getFormat(i);
-                    DBG("Checking format: " << f->getName());
-
-                    if (desc.pluginFormatName == f->getName())
-                    {
-                        DBG("Found matching format: " << f->getName());
-                        format = f;
-                        break;
-                    }
-                }
+    // Enable buses
+    if (auto* bus = instance->processor->getBus(true, 0))
+        bus->enable();
+    if (auto* bus = instance->processor->getBus(false, 0))
+        bus->enable();
 
-                if (format != nullptr)
-                {
-                    auto instance = std::make_unique<PluginInstance>();
-
-                    DBG("Creating plugin instance...");
-                    juce::String error;
-                    auto pluginInstance = format->createInstanceFromDescription(desc, sampleRate, bufferSize, error);
-
-                    if (pluginInstance == nullptr)
-                    {
-                        DBG("Failed to create plugin instance: " << error);
-
-                        // Try rescanning the plugin
-                        DBG("Attempting to rescan plugin file...");
-                        juce::OwnedArray<juce::PluginDescription> descriptions;
-                        format->findAllTypesForFile(descriptions, desc.fileOrIdentifier);
-
-                        if (descriptions.size() > 0)
-                        {
-                            DBG("Found " << descriptions.size() << " plugin descriptions from rescan");
-                            pluginInstance = format->createInstanceFromDescription(*descriptions[0], sampleRate, bufferSize);
-                            if (pluginInstance != nullptr)
-                            {
-                                DBG("Successfully created plugin instance from rescan");
-                            }
-                            else
-                            {
-                                DBG("Failed to create plugin instance even after rescan");
-                            }
-                        }
-                        else
-                        {
-                            DBG("No plugin descriptions found during rescan");
-                        }
-                    }
-
-                    if (pluginInstance != nullptr)
-                    {
-                        instance->processor = std::move(pluginInstance);
-                        DBG("Plugin instance created successfully");
-
-                        // Configure the plugin
-                        DBG("Configuring plugin: " << desc.name);
-                        instance->processor->setRateAndBufferSizeDetails(sampleRate, bufferSize);
-
-                        // Enable buses
-                        if (auto* bus = instance->processor->getBus(true, 0))
-                        {
-                            bus->enable();
-                            DBG("Enabled input bus");
-                        }
-                        if (auto* bus = instance->processor->getBus(false, 0))
-                        {
-                            bus->enable();
-                            DBG("Enabled output bus");
-                        }
-
-                        // Set bus layout
-                        auto layout = instance->processor->getBusesLayout();
-                        if (instance->processor->setBusesLayout(layout))
-                        {
-                            // Prepare the plugin
-                            instance->processor->prepareToPlay(sampleRate, bufferSize);
-                            DBG("Plugin prepared to play");
-
-                            // Restore plugin's state
-                            if (auto* stateXml = pluginXml->getChildByName("State"))
-                            {
-                                DBG("Found saved state data for plugin");
-                                juce::MemoryBlock stateData;
-                                stateData.fromBase64Encoding(stateXml->getStringAttribute("data"));
-                                if (stateData.getSize() > 0)
-                                {
-                                    instance->processor->setStateInformation(stateData.getData(),
-                                        (int)stateData.getSize());
-                                    DBG("Restored plugin state (" << stateData.getSize() << " bytes)");
-                                }
-                                else
-                                {
-                                    DBG("Warning: State data was empty");
-                                }
-                            }
-
-                            plugins.push_back(std::move(instance));
-                            DBG("Successfully loaded plugin " << pluginIndex << ": " << desc.name);
-                            pluginIndex++;
-                        }
-                        else
-                        {
-                            DBG("Failed to set plugin bus layout for: " << desc.name);
-                        }
-                    }
-                    else
-                    {
-                        DBG("Failed to create plugin instance for: " << desc.name);
-                    }
-                }
-                else
-                {
-                    DBG("Could not find format for plugin: " << desc.name <<
-                        " (format name: " << desc.pluginFormatName << ")");
-                }
-            }
-            else
-            {
-                DBG("No description found for plugin " << pluginName);
-            }
+    // Set bus layout
+    auto layout = instance->processor->getBusesLayout();
+    if (!instance->processor->setBusesLayout(layout))
+    {
+        DBG("Failed to set plugin bus layout for: " << desc.name);
+        return nullptr;
+    }
+
+    instance->processor->prepareToPlay(sampleRate, bufferSize);
+    DBG("Plugin prepared to play");
+
+    // Restore plugin's state
+    // Straight from the mapped blob if there is one
+    if (saved.getStateSize() > 0)
+    {
+        instance->processor->setStateInformation(saved.getStateData(), (int)saved.getStateSize());
+        DBG("Restored plugin state (" << (int)saved.getStateSize() << " bytes)");
+    }
+
+    // A plugin restored from a blob only keeps its hash; if the blob was
+    // missing, the state it starts with needs saving
+    instance->lastSavedState = saved.state;
+    instance->lastSavedBlob = saved.isStateAvailable() ? saved.stateBlob : juce::String();
+    instance->lastSavedBlobBytes = instance->lastSavedBlob.isNotEmpty() ? saved.getStateSize() : 0;
+    instance->stateDirty = !saved.isStateAvailable();
+
+    const auto residentAfter = AudioMemoryLock::getResidentBytes();
+    instance->loadedBytes = residentAfter > residentBefore ? residentAfter - residentBefore : 0;
+
+    DBG("Successfully loaded plugin: " << desc.name);
+    return instance;
+}
+
+bool Settings::loadPluginState(std::vector<std::unique_ptr<PluginInstance>>& plugins,
+    juce::AudioPluginFormatManager& formatManager,
+    PluginScanCache& scanCache,
+    double sampleRate,
+    int bufferSize,
+    int strip,
+    int scene)
+{
+    std::vector<SavedPlugin> saved;
+    juce::uint32 epoch = 0;
+    if (!readPluginState(saved, strip, scene, &epoch))
+        return false;
+
+    DBG("Clearing existing plugins");
+    plugins.clear();
+
+    for (auto& entry : saved)
+    {
+        if (auto instance = createPlugin(entry, formatManager, scanCache, sampleRate, bufferSize))
+        {
+            instance->journalTag = ParameterJournal::makeTag(epoch, entry.slot);
+            plugins.push_back(std::move(instance));
         }
     }
 
     DBG("\nLoaded " << plugins.size() << " plugins");
     return true;
-}
\ No newline at end of file
+}
+
+bool Settings::saveScenes(const std::vector<StripScenes>& scenes)
+{
+    juce::XmlElement root("Scenes");
+
+    for (auto& strip : scenes)
+    {
+        auto* stripXml = root.createNewChildElement("Strip");
+        stripXml->setAttribute("active", strip.active);
+
+        for (int slot = 0; slot < strip.names.size(); ++slot)
+        {
+            if (strip.names[slot].isEmpty())
+                continue;
+
+            auto* sceneXml = stripXml->createNewChildElement("Scene");
+            sceneXml->setAttribute("slot", slot);
+            sceneXml->setAttribute("name", strip.names[slot]);
+        }
+    }
+
+    bool success = root.writeTo(getScenesFile());
+    if (!success)
+        DBG("Failed to write scenes file!");
+
+    return success;
+}
+
+bool Settings::loadScenes(std::vector<StripScenes>& scenes)
+{
+    auto scenesFile = getScenesFile();
+    if (!scenesFile.existsAsFile())
+        return false;
+
+    auto xml = juce::parseXML(scenesFile);
+    if (xml == nullptr || !xml->hasTagName("Scenes"))
+    {
+        DBG("Failed to parse scenes XML");
+        return false;
+    }
+
+    scenes.clear();
+    for (auto* stripXml : xml->getChildWithTagNameIterator("Strip"))
+    {
+        StripScenes strip;
+        strip.active = stripXml->getIntAttribute("active", 0);
+
+        for (auto* sceneXml : stripXml->getChildWithTagNameIterator("Scene"))
+        {
+            // Strips ignore slots beyond what they have; this only keeps a
+            // corrupt file from making the list huge
+            auto slot = sceneXml->getIntAttribute("slot", -1);
+            if (slot < 0 || slot >= 64)
+                continue;
+
+            while (strip.names.size() <= slot)
+                strip.names.add({});
+            strip.names.set(slot, sceneXml->getStringAttribute("name"));
+        }
+
+        scenes.push_back(strip);
+    }
+
+    return true;
+}
+
+bool Settings::saveEngineOptions(const EngineOptions& options)
+{
+    auto optionsFile = getEngineOptionsFile();
+    DBG("Saving engine options to: " << optionsFile.getFullPathName());
+
+    juce::XmlElement root("EngineOptions");
+    root.setAttribute("pipelineSegments", options.pipelineSegments);
+    root.setAttribute("fixedBlockSize", options.fixedBlockSize);
+    root.setAttribute("tileSize", options.tileSize);
+    root.setAttribute("numStrips", options.numStrips);
+    root.setAttribute("channelsPerStrip", options.channelsPerStrip);
+    root.setAttribute("realtimeScheduling", options.realtime.realtimeScheduling);
+    root.setAttribute("devicePriority", options.realtime.devicePriority);
+    root.setAttribute("workerPriority", options.realtime.workerPriority);
+    root.setAttribute("pinThreads", options.realtime.pinThreads);
+    root.setAttribute("holdCpuDmaLatency", options.realtime.holdCpuDmaLatency);
+    root.setAttribute("watchdogBudgetMultiple", options.watchdog.budgetMultiple);
+    root.setAttribute("watchdogStrikes", options.watchdog.strikes);
+    root.setAttribute("progressiveRestore", options.progressiveRestore);
+    root.setAttribute("compressPluginState", options.compressPluginState);
+    root.setAttribute("maxStandbyScenes", options.maxStandbyScenes);
+    root.setAttribute("warmupBlocks", options.warmupBlocks);
+
+    bool success = root.writeTo(optionsFile);
+    if (!success)
+        DBG("Failed to write engine options file!");
+
+    return success;
+}
+
+bool Settings::loadEngineOptions(EngineOptions& options)
+{
+    auto optionsFile = getEngineOptionsFile();
+    if (!optionsFile.existsAsFile())
+    {
+        DBG("No engine options file found, using defaults");
+        return false;
+    }
+
+    auto xml = juce::parseXML(optionsFile);
+    if (xml == nullptr || !xml->hasTagName("EngineOptions"))
+    {
+        DBG("Failed to parse engine options XML");
+        return false;
+    }
+
+    options.pipelineSegments = juce::jlimit(1, 8, xml->getIntAttribute("pipelineSegments", options.pipelineSegments));
+    options.fixedBlockSize = juce::jlimit(0, 4096, xml->getIntAttribute("fixedBlockSize", options.fixedBlockSize));
+    options.tileSize = juce::jlimit(-1, 4096, xml->getIntAttribute("tileSize", options.tileSize));
+    options.numStrips = juce::jlimit(1, 8, xml->getIntAttribute("numStrips", options.numStrips));
+    options.channelsPerStrip = juce::jlimit(1, 2, xml->getIntAttribute("channelsPerStrip", options.channelsPerStrip));
+
+    auto& realtime = options.realtime;
+    realtime.realtimeScheduling = xml->getBoolAttribute("realtimeScheduling", realtime.realtimeScheduling);
+    realtime.devicePriority = juce::jlimit(1, 99, xml->getIntAttribute("devicePriority", realtime.devicePriority));
+    realtime.workerPriority = juce::jlimit(1, 99, xml->getIntAttribute("workerPriority", realtime.workerPriority));
+    realtime.pinThreads = xml->getBoolAttribute("pinThreads", realtime.pinThreads);
+    realtime.holdCpuDmaLatency = xml->getBoolAttribute("holdCpuDmaLatency", realtime.holdCpuDmaLatency);
+
+    auto& watchdog = options.watchdog;
+    watchdog.budgetMultiple = juce::jlimit(0, 100, xml->getIntAttribute("watchdogBudgetMultiple", watchdog.budgetMultiple));
+    watchdog.strikes = juce::jlimit(1, 100, xml->getIntAttribute("watchdogStrikes", watchdog.strikes));
+    options.progressiveRestore = xml->getBoolAttribute("progressiveRestore", options.progressiveRestore);
+    options.compressPluginState = xml->getBoolAttribute("compressPluginState", options.compressPluginState);
+    options.maxStandbyScenes = juce::jlimit(0, 7, xml->getIntAttribute("maxStandbyScenes", options.maxStandbyScenes));
+    options.warmupBlocks = juce::jlimit(0, 256, xml->getIntAttribute("warmupBlocks", options.warmupBlocks));
+
+    DBG("Engine options loaded:");
+    DBG("Pipeline segments: " << options.pipelineSegments);
+    DBG("Fixed block size: " << options.fixedBlockSize);
+    DBG("Tile size: " << options.tileSize);
+    DBG("Channel strips: " << options.numStrips << " x " << options.channelsPerStrip << " inputs");
+    DBG("Real-time scheduling: " << (realtime.realtimeScheduling ? "SCHED_FIFO" : "off")
+        << ", priorities " << realtime.devicePriority << "/" << realtime.workerPriority
+        << (realtime.pinThreads ? ", pinned" : "")
+        << (realtime.holdCpuDmaLatency ? ", holding cpu_dma_latency" : ""));
+    DBG("Watchdog: " << (watchdog.budgetMultiple > 0 ? juce::String(watchdog.budgetMultiple) + "x budget, "
+        + juce::String(watchdog.strikes) + " strikes" : juce::String("off")));
+    DBG("Plugin warm-up: " << (options.warmupBlocks > 0 ? juce::String(options.warmupBlocks) + " blocks" : juce::String("off")));
+    return true;
+}
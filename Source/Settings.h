@@ -1,6 +1,75 @@
 #pragma once
 #include <JuceHeader.h>
 #include "PluginInstance.h"
+#include "RealtimePolicy.h"
+#include "PluginWatchdog.h"
+#include "PluginScanCache.h"
+#include "StateBlobStore.h"
+
+// Engine tuning that isn't part of the device setup
+struct EngineOptions
+{
+    int pipelineSegments = 1;
+
+    // Constant block size to drive the chain with; 0 passes device blocks through
+    int fixedBlockSize = 0;
+
+    // Sub-block size the chain runs over; 0 is off, -1 tunes it automatically
+    int tileSize = 0;
+
+    // Independent mic chains. With more than one, strip k reads
+    // channelsPerStrip device inputs starting at k * channelsPerStrip.
+    int numStrips = 1;
+    int channelsPerStrip = 1;
+
+    RealtimePolicy::Options realtime;
+    PluginWatchdog::Options watchdog;
+
+    // Restored plugins join the running chain one at a time as they load,
+    // rather than the output staying silent until the whole chain is ready
+    bool progressiveRestore = false;
+
+    // Large plugin states are deflated in the saved chains when it pays off
+    bool compressPluginState = true;
+
+    // Scenes per strip kept loaded besides the active one; the least recently
+    // used beyond that are unloaded and have to load again to play
+    int maxStandbyScenes = 2;
+
+    // Blocks of silence new plugins run through before they go live; 0 is off
+    int warmupBlocks = 16;
+};
+
+// A strip's scenes by slot; an empty name is a free slot
+struct StripScenes
+{
+    juce::StringArray names;
+    int active = 0;
+};
+
+// One saved plugin slot, read back but not instantiated
+struct SavedPlugin
+{
+    juce::PluginDescription description;
+    juce::MemoryBlock state;
+    bool parallelWithPrevious = false;
+    bool bypassed = false;
+    bool sandboxed = false;
+
+    // Position in the saved chain, which the parameter journal refers to
+    int slot = 0;
+
+    // Hash of the state in the blob store, if it's kept there. When read
+    // back, the blob is mapped rather than copied into state.
+    juce::String stateBlob;
+    std::shared_ptr<juce::MemoryMappedFile> stateMapping;
+
+    const void* getStateData() const { return stateMapping != nullptr ? stateMapping->getData() : state.getData(); }
+    size_t getStateSize() const { return stateMapping != nullptr ? stateMapping->getSize() : state.getSize(); }
+
+    // False if the state refers to a blob that has gone missing
+    bool isStateAvailable() const { return stateBlob.isEmpty() || stateMapping != nullptr || state.getSize() > 0; }
+};
 
 class Settings
 {
@@ -10,13 +79,55 @@ public:
     bool loadState(juce::AudioDeviceManager& deviceManager);
 
     // New methods for plugin state
-    bool savePluginState(const std::vector<std::unique_ptr<PluginInstance>>& plugins);
+    // Each channel strip keeps its chain in a file of its own, and so does
+    // each further scene of a strip
+    bool savePluginState(const std::vector<std::unique_ptr<PluginInstance>>& plugins, int strip = 0);
+
+    // Writes already captured state; safe on any thread. Large states are put
+    // in the blob store first and their hashes filled in.
+    bool writePluginState(std::vector<SavedPlugin>& saved, int strip = 0, int scene = 0, juce::uint32 epoch = 0);
+
+    // Journal tags of the loaded plugins are set from the file's epoch
     bool loadPluginState(std::vector<std::unique_ptr<PluginInstance>>& plugins,
         juce::AudioPluginFormatManager& formatManager,
+        PluginScanCache& scanCache,
+        double sampleRate,
+        int bufferSize,
+        int strip = 0,
+        int scene = 0);
+
+    // Loading in two steps: reading the file is safe on any thread, creating
+    // the plugin has to happen on the message thread.
+    bool readPluginState(std::vector<SavedPlugin>& saved, int strip = 0, int scene = 0, juce::uint32* epoch = nullptr);
+    bool deletePluginState(int strip, int scene);
+    static std::unique_ptr<PluginInstance> createPlugin(const SavedPlugin& saved,
+        juce::AudioPluginFormatManager& formatManager,
+        PluginScanCache& scanCache,
         double sampleRate,
         int bufferSize);
 
+    // Any thread. Deletes blobs that no saved chain refers to any more.
+    int collectStateBlobs();
+
+    // Scene names of every strip, in scenes.xml
+    bool saveScenes(const std::vector<StripScenes>& scenes);
+    bool loadScenes(std::vector<StripScenes>& scenes);
+
+    bool saveEngineOptions(const EngineOptions& options);
+    bool loadEngineOptions(EngineOptions& options);
+
+    // Whether large plugin states are deflated when saved
+    void setCompressPluginState(bool shouldCompress) { compressPluginState = shouldCompress; }
+
 private:
+    // Chains used to be saved as XML with base64 state; those files are
+    // converted the first time they're read
+    bool importLegacyPluginState(std::vector<SavedPlugin>& saved, int strip);
+    static bool readLegacyPluginState(const juce::File& stateFile, std::vector<SavedPlugin>& saved);
+
+    std::atomic<bool> compressPluginState { true };
+    StateBlobStore blobStore;
+
     juce::File getSettingsFile()
     {
         auto appDataDir = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
@@ -25,11 +136,42 @@ private:
         return appDataDir.getChildFile("settings.xml");
     }
 
-    juce::File getPluginStateFile()
+    juce::File getPluginStateFile(int strip, int scene = 0)
+    {
+        auto appDataDir = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+            .getChildFile("VSTMIC");
+        appDataDir.createDirectory();
+
+        juce::String name("chainstate");
+        if (strip > 0)
+            name << "-strip" << strip + 1;
+        if (scene > 0)
+            name << "-scene" << scene + 1;
+        return appDataDir.getChildFile(name + ".bin");
+    }
+
+    juce::File getLegacyPluginStateFile(int strip)
+    {
+        auto appDataDir = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+            .getChildFile("VSTMIC");
+        appDataDir.createDirectory();
+        return appDataDir.getChildFile(strip == 0 ? juce::String("pluginstate.xml")
+                                                  : "pluginstate-strip" + juce::String(strip + 1) + ".xml");
+    }
+
+    juce::File getScenesFile()
+    {
+        auto appDataDir = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+            .getChildFile("VSTMIC");
+        appDataDir.createDirectory();
+        return appDataDir.getChildFile("scenes.xml");
+    }
+
+    juce::File getEngineOptionsFile()
     {
         auto appDataDir = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
             .getChildFile("VSTMIC");
         appDataDir.createDirectory();
-        return appDataDir.getChildFile("pluginstate.xml");
+        return appDataDir.getChildFile("engine.xml");
     }
 };
\ No newline at end of file
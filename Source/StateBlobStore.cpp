@@ -0,0 +1,92 @@
+#include "StateBlobStore.h"
+
+StateBlobStore::StateBlobStore()
+{
+    directory = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("VSTMIC")
+        .getChildFile("blobs");
+    directory.createDirectory();
+}
+
+juce::String StateBlobStore::hashOf(const juce::MemoryBlock& state)
+{
+    return juce::SHA256(state.getData(), state.getSize()).toHexString();
+}
+
+bool StateBlobStore::store(const juce::String& hash, const juce::MemoryBlock& state)
+{
+    if (!isHash(hash))
+        return false;
+
+    const juce::ScopedLock sl(lock);
+    auto file = getBlobFile(hash);
+
+    // Same hash, same content; just keep it clear of the next collection
+    if (file.getSize() == (juce::int64)state.getSize())
+    {
+        file.setLastModificationTime(juce::Time::getCurrentTime());
+        return true;
+    }
+
+    juce::TemporaryFile temp(file);
+    if (!temp.getFile().replaceWithData(state.getData(), state.getSize()) || !temp.overwriteTargetFileWithTemporary())
+    {
+        DBG("Failed to store state blob " << hash);
+        return false;
+    }
+
+    DBG("Stored state blob " << hash << " (" << (int)state.getSize() << " bytes)");
+    return true;
+}
+
+std::shared_ptr<juce::MemoryMappedFile> StateBlobStore::map(const juce::String& hash) const
+{
+    if (!isHash(hash))
+        return nullptr;
+
+    auto mapped = std::make_shared<juce::MemoryMappedFile>(getBlobFile(hash), juce::MemoryMappedFile::readOnly, false);
+    if (mapped->getData() == nullptr)
+    {
+        DBG("State blob " << hash << " is missing");
+        return nullptr;
+    }
+
+    return mapped;
+}
+
+int StateBlobStore::collectGarbage(const std::set<juce::String>& referenced)
+{
+    const juce::ScopedLock sl(lock);
+    const auto cutoff = juce::Time::getCurrentTime() - juce::RelativeTime::minutes(gracePeriodMinutes);
+    int numDeleted = 0;
+
+    for (auto& file : directory.findChildFiles(juce::File::findFiles, false))
+    {
+        auto name = file.getFileName();
+
+        // Leftovers of a store that didn't finish are swept up as well
+        if (isHash(name) && referenced.count(name) > 0)
+            continue;
+
+        if (file.getLastModificationTime() > cutoff)
+            continue;
+
+        if (file.deleteFile())
+            ++numDeleted;
+    }
+
+    if (numDeleted > 0)
+        DBG("Deleted " << numDeleted << " unused state blobs");
+
+    return numDeleted;
+}
+
+juce::File StateBlobStore::getBlobFile(const juce::String& hash) const
+{
+    return directory.getChildFile(hash);
+}
+
+bool StateBlobStore::isHash(const juce::String& name)
+{
+    return name.length() == 64 && name.containsOnly("0123456789abcdef");
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Content-addressed store for large plugin states, so chains that share an
+// impulse response or a sample library's content keep a single copy on disk.
+// Each blob is a file in VSTMIC/blobs named by the SHA-256 of the state bytes;
+// chain files refer to blobs by that hash. Blobs are stored raw, so a restore
+// can map one and hand it to setStateInformation without copying it first.
+//
+// Blobs are only ever added, never changed. collectGarbage() removes the ones
+// no chain refers to any more.
+class StateBlobStore
+{
+public:
+    StateBlobStore();
+
+    // Smaller states stay inline in the chain file
+    static bool shouldStore(size_t stateSize) { return stateSize >= minBlobSize; }
+    static juce::String hashOf(const juce::MemoryBlock& state);
+
+    // Any thread. Writes the blob unless it's already there.
+    bool store(const juce::String& hash, const juce::MemoryBlock& state);
+
+    // Any thread. Maps the blob read-only, or returns nullptr if it's missing.
+    std::shared_ptr<juce::MemoryMappedFile> map(const juce::String& hash) const;
+
+    // Deletes blobs not in the referenced set, except ones written in the last
+    // few minutes, which a chain being saved right now may be about to use.
+    // Returns the number deleted.
+    int collectGarbage(const std::set<juce::String>& referenced);
+
+private:
+    juce::File getBlobFile(const juce::String& hash) const;
+    static bool isHash(const juce::String& name);
+
+    juce::File directory;
+
+    // Keeps a collection from deleting a blob that's being stored again
+    juce::CriticalSection lock;
+
+    static constexpr size_t minBlobSize = 64 * 1024;
+    static constexpr int gracePeriodMinutes = 10;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StateBlobStore)
+};
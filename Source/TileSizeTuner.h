@@ -0,0 +1,74 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Picks the tile size a chain runs fastest at from timed blocks. Blocks take
+// turns with each candidate, round robin, so that changes in the rest of the
+// machine's load fall on every candidate alike. Once enough rounds have been
+// timed, or time is up, the cheapest per sample wins.
+class TileSizeTuner
+{
+public:
+    static constexpr int numCandidates = 5;
+    static constexpr int roundsToTime = 8;
+
+    // 0 means the whole block in one go
+    static int getCandidate(int index) noexcept
+    {
+        const int sizes[numCandidates] { 0, 64, 128, 256, 512 };
+        return sizes[index];
+    }
+
+    void restart() noexcept
+    {
+        blocksTimed = 0;
+        chosen = -1;
+        ticks.fill(0);
+        samples.fill(0);
+    }
+
+    bool isTuning() const noexcept { return chosen < 0; }
+
+    // Tile size to use for the next block
+    int getTileSize() const noexcept
+    {
+        return isTuning() ? getCandidate(blocksTimed % numCandidates) : chosen;
+    }
+
+    // Reports how long the block just processed at getTileSize() took
+    void addMeasurement(juce::int64 elapsedTicks, int numSamples) noexcept
+    {
+        if (!isTuning())
+            return;
+
+        const auto index = (size_t)(blocksTimed % numCandidates);
+        ticks[index] += elapsedTicks;
+        samples[index] += numSamples;
+
+        if (++blocksTimed >= roundsToTime * numCandidates)
+            finish();
+    }
+
+    // Settles on the best of what has been timed so far
+    void finish() noexcept
+    {
+        int best = -1;
+        for (int i = 0; i < numCandidates; ++i)
+        {
+            const auto k = (size_t)i;
+            if (samples[k] == 0)
+                continue;
+
+            if (best < 0 || (double)ticks[k] / (double)samples[k]
+                    < (double)ticks[(size_t)best] / (double)samples[(size_t)best])
+                best = i;
+        }
+
+        chosen = best >= 0 ? getCandidate(best) : 0;
+    }
+
+private:
+    int blocksTimed = 0;
+    int chosen = -1;
+    std::array<juce::int64, (size_t)numCandidates> ticks {};
+    std::array<juce::int64, (size_t)numCandidates> samples {};
+};